@@ -0,0 +1,46 @@
+/*
+  ISC License
+
+  Copyright (c) 2024, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#pragma once
+
+#include "io.h"
+#include "item.h"
+#include "types.h"
+
+typedef i32 (*DriverCmd)(IOReq *ior);
+
+typedef struct Driver Driver;
+struct Driver
+{
+  ItemNode   drv;
+  i32        drv_OpenCnt;
+  i32        drv_MaxCommands;
+  DriverCmd *drv_CmdTable;
+  void     (*drv_AbortIO)(IOReq *ior);
+};
+
+typedef struct Device Device;
+struct Device
+{
+  ItemNode dev;
+  i32      dev_OpenCnt;
+  Driver  *dev_Driver;
+  i32      dev_MaxUnitNum;
+  i32    (*dev_Open)(Device *dev);
+  void   (*dev_Close)(Device *dev);
+};
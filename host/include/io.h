@@ -0,0 +1,80 @@
+/*
+  ISC License
+
+  Copyright (c) 2024, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#pragma once
+
+#include "item.h"
+#include "list.h"
+#include "operror.h"
+#include "types.h"
+
+#define CMD_WRITE  0
+#define CMD_READ   1
+#define CMD_STATUS 2
+
+#define IO_DONE  0x00000001
+#define IO_QUICK 0x00000002
+
+typedef struct IOBuf IOBuf;
+struct IOBuf
+{
+  void *iob_Buffer;
+  i32   iob_Len;
+};
+
+typedef struct IOInfo IOInfo;
+struct IOInfo
+{
+  u8    ioi_Command;
+  u8    ioi_Flags;
+  u8    ioi_Unit;
+  u8    ioi_Flags2;
+  u32   ioi_CmdOptions;
+  u32   ioi_User;
+  i32   ioi_Offset;
+  IOBuf ioi_Send;
+  IOBuf ioi_Recv;
+};
+
+struct Device;
+struct Task;
+
+typedef struct IOReq IOReq;
+struct IOReq
+{
+  ItemNode       io;
+  MinNode        io_Link;
+  struct Device *io_Dev;
+  IOInfo         io_Info;
+  i32            io_Actual;
+  u32            io_Flags;
+  i32            io_Error;
+  i32            io_Extension[2];
+  struct Task   *io_Owner;
+};
+
+Item CreateIOReq(const char *name, u8 pri, Item device, Item msgport);
+Err  DeleteIOReq(Item ioreq);
+Err  SendIO(Item ioreq, const IOInfo *ioi);
+Err  DoIO(Item ioreq, const IOInfo *ioi);
+Err  WaitIO(Item ioreq);
+i32  CheckIO(Item ioreq);
+Err  AbortIO(Item ioreq);
+
+Item OpenNamedDevice(const char *name, void *args);
+Err  CloseNamedDevice(Item device);
@@ -0,0 +1,56 @@
+/*
+  ISC License
+
+  Copyright (c) 2024, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#pragma once
+
+#include "list.h"
+#include "types.h"
+
+typedef struct ItemNode ItemNode;
+struct ItemNode
+{
+  Node n;
+  Item n_Item;
+};
+
+typedef struct TagArg TagArg;
+struct TagArg
+{
+  u32   ta_Tag;
+  void *ta_Arg;
+};
+
+#define TAG_END       0
+#define TAG_ITEM_NAME 1
+#define TAG_ITEM_PRI  2
+#define TAG_ITEM_LAST 9
+
+#define KERNELNODE 1
+
+#define DRIVERNODE 1
+#define DEVICENODE 2
+#define IOREQNODE  3
+#define TASKNODE   4
+
+#define MKNODEID(subsys_,type_) ((i32)(((subsys_) << 8) | (type_)))
+
+Item  CreateItem(i32 ctype, const TagArg *tags);
+Err   DeleteItem(Item item);
+Item  OpenItem(Item item, void *args);
+Err   CloseItem(Item item);
+void *LookupItem(Item item);
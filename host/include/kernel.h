@@ -0,0 +1,46 @@
+/*
+  ISC License
+
+  Copyright (c) 2024, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#pragma once
+
+#include "device.h"
+#include "io.h"
+#include "item.h"
+#include "list.h"
+#include "operror.h"
+#include "task.h"
+#include "types.h"
+
+#include <setjmp.h>
+
+/*
+  kb_CatchDataAborts is honoured by the simulated data abort handler.
+  CURRENTTASK is per thread since every task is a host thread.
+*/
+typedef struct KernelBase KernelBase_t;
+struct KernelBase
+{
+  jmp_buf *kb_CatchDataAborts;
+  u32      kb_QuietAborts;
+};
+
+extern KernelBase_t *KernelBase;
+
+Task *sim_current_task(void);
+
+#define CURRENTTASK (sim_current_task())
@@ -0,0 +1,63 @@
+/*
+  ISC License
+
+  Copyright (c) 2024, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#pragma once
+
+#include "types.h"
+
+typedef struct Node Node;
+struct Node
+{
+  Node       *n_Next;
+  Node       *n_Prev;
+  u8          n_SubsysType;
+  u8          n_Type;
+  u8          n_Priority;
+  u8          n_Flags;
+  i32         n_Size;
+  const char *n_Name;
+};
+
+typedef struct MinNode MinNode;
+struct MinNode
+{
+  MinNode *n_Next;
+  MinNode *n_Prev;
+};
+
+/*
+  Circular with the anchor as sentinel so RemNode needs no list.
+*/
+typedef struct List List;
+struct List
+{
+  Node    l;
+  MinNode l_Anchor;
+};
+
+#define ISEMPTYLIST(l_)  ((l_)->l_Anchor.n_Next == &(l_)->l_Anchor)
+#define FIRSTNODE(l_)    ((Node*)(l_)->l_Anchor.n_Next)
+#define LASTNODE(l_)     ((Node*)(l_)->l_Anchor.n_Prev)
+#define ISNODE(l_,n_)    ((MinNode*)(n_) != &(l_)->l_Anchor)
+#define NEXTNODE(n_)     (((Node*)(n_))->n_Next)
+
+void  InitList(List *l, const char *name);
+void  AddHead(List *l, Node *n);
+void  AddTail(List *l, Node *n);
+void  RemNode(Node *n);
+Node *RemHead(List *l);
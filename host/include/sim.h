@@ -0,0 +1,59 @@
+/*
+  ISC License
+
+  Copyright (c) 2024, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+  Host only. The simulated kernel backs the 3DO memory map with a
+  single reservation on the host. Unmapped parts of it, and pages
+  marked with sim_fault, data abort into kb_CatchDataAborts like they
+  would on hardware.
+*/
+
+#pragma once
+
+#include "types.h"
+
+#define SIM_PHYS_SIZE 0x03500000
+
+void *sim_phys(u32 addr);
+Err   sim_fault(u32 addr, u32 len, i32 on);
+// faults that go away after `hits` aborts, at most 255
+Err   sim_fault_hits(u32 addr, u32 len, i32 hits);
+
+// a word written to the SPORT, done on the simulated VRAM
+void  sim_sport_write(u32 addr, u32 v);
+
+// MEMTYPE_VRAM allocations, handed out from the top of VRAM
+void *sim_vram_alloc(i32 size);
+i32   sim_vram_owns(const void *p);
+
+void  sim_mem_init(void);
+
+// microseconds, CLOCK_MONOTONIC, stands in for the CLIO timers
+u32   sim_ticks(void);
+
+/*
+  LoadProgram starts tasks from this table, defined by the host build.
+*/
+typedef struct sim_program_s sim_program_t;
+struct sim_program_s
+{
+  const char *path;
+  int       (*entry)(void);
+};
+
+extern const sim_program_t g_SIM_PROGRAMS[];
@@ -0,0 +1,41 @@
+/*
+  ISC License
+
+  Copyright (c) 2024, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#pragma once
+
+#include "item.h"
+#include "types.h"
+
+#define SIGF_ABORT  0x00000001
+#define SIGF_IODONE 0x00000004
+
+typedef struct Task Task;
+struct Task
+{
+  ItemNode t;
+  u32      t_AllocatedSigs;
+  u32      t_SigBits;
+};
+
+#define GetCurrentSignals() (CURRENTTASK->t_SigBits)
+
+i32  AllocSignal(i32 sigmask);
+Err  FreeSignal(i32 sigmask);
+i32  WaitSignal(i32 sigmask);
+Err  SendSignal(Item task, i32 sigmask);
+void Yield(void);
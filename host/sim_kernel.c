@@ -0,0 +1,936 @@
+/*
+  ISC License
+
+  Copyright (c) 2024, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+  A minimal Portfolio for running svc_mem on the host. Every task is a
+  thread and all of them share one lock, held whenever a task runs, so
+  like on the 3DO only one runs at a time and driver code never races
+  user code. Tasks give the CPU up in WaitSignal, WaitIO and Yield.
+  Priorities are ignored.
+*/
+
+#define _GNU_SOURCE
+
+#include "sim.h"
+
+#include "device.h"
+#include "filefunctions.h"
+#include "graphics.h"
+#include "io.h"
+#include "item.h"
+#include "kernel.h"
+#include "list.h"
+#include "mem.h"
+#include "operror.h"
+#include "super.h"
+#include "task.h"
+#include "time.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SIM_ITEM_MAX 256
+
+enum sim_driver_tags_e
+  {
+    SIM_DRIVER_TAG_ABORTIO = TAG_ITEM_LAST+1,
+    SIM_DRIVER_TAG_MAXCMDS,
+    SIM_DRIVER_TAG_CMDTABLE,
+    SIM_DRIVER_TAG_MSGPORT,
+    SIM_DRIVER_TAG_INIT,
+    SIM_DRIVER_TAG_DISPATCH
+  };
+
+enum sim_device_tags_e
+  {
+    SIM_DEVICE_TAG_DRVR = TAG_ITEM_LAST+1,
+    SIM_DEVICE_TAG_CRIO,
+    SIM_DEVICE_TAG_DLIO,
+    SIM_DEVICE_TAG_OPEN,
+    SIM_DEVICE_TAG_CLOSE,
+    SIM_DEVICE_TAG_IOREQSZ,
+    SIM_DEVICE_TAG_INIT
+  };
+
+typedef struct sim_task_s sim_task_t;
+struct sim_task_s
+{
+  Task            task;
+  pthread_t       thread;
+  pthread_cond_t  cond;
+  int           (*entry)(void);
+  i32             starting;
+  i32             exited;
+};
+
+static pthread_mutex_t  g_SIM_LOCK    = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   g_SIM_STARTED = PTHREAD_COND_INITIALIZER;
+static ItemNode        *g_SIM_ITEMS[SIM_ITEM_MAX];
+static sim_task_t       g_SIM_MAIN_TASK;
+static __thread sim_task_t *t_SIM_CURRENT = NULL;
+
+/* lists */
+
+void
+InitList(List       *l_,
+         const char *name_)
+{
+  memset(l_,0,sizeof(*l_));
+  l_->l.n_Name         = name_;
+  l_->l_Anchor.n_Next = &l_->l_Anchor;
+  l_->l_Anchor.n_Prev = &l_->l_Anchor;
+}
+
+static
+void
+sim_insert(MinNode *prev_,
+           MinNode *n_)
+{
+  n_->n_Prev          = prev_;
+  n_->n_Next          = prev_->n_Next;
+  prev_->n_Next->n_Prev = n_;
+  prev_->n_Next       = n_;
+}
+
+void
+AddHead(List *l_,
+        Node *n_)
+{
+  sim_insert(&l_->l_Anchor,(MinNode*)n_);
+}
+
+void
+AddTail(List *l_,
+        Node *n_)
+{
+  sim_insert(l_->l_Anchor.n_Prev,(MinNode*)n_);
+}
+
+void
+RemNode(Node *n_)
+{
+  MinNode *n = (MinNode*)n_;
+
+  n->n_Prev->n_Next = n->n_Next;
+  n->n_Next->n_Prev = n->n_Prev;
+  n->n_Next = n->n_Prev = NULL;
+}
+
+Node*
+RemHead(List *l_)
+{
+  Node *n;
+
+  if(ISEMPTYLIST(l_))
+    return NULL;
+
+  n = FIRSTNODE(l_);
+  RemNode(n);
+
+  return n;
+}
+
+/* items */
+
+static
+Item
+sim_item_add(ItemNode   *n_,
+             u8          type_,
+             const char *name_)
+{
+  Item i;
+
+  for(i = 1; i < SIM_ITEM_MAX; i++)
+    {
+      if(g_SIM_ITEMS[i] != NULL)
+        continue;
+
+      n_->n.n_SubsysType = KERNELNODE;
+      n_->n.n_Type       = type_;
+      n_->n.n_Name       = name_;
+      n_->n_Item         = i;
+      g_SIM_ITEMS[i]     = n_;
+
+      return i;
+    }
+
+  return NOMEM;
+}
+
+static
+void*
+sim_item_get(Item item_,
+             u8   type_)
+{
+  if((item_ <= 0) || (item_ >= SIM_ITEM_MAX))
+    return NULL;
+  if(g_SIM_ITEMS[item_] == NULL)
+    return NULL;
+  if(g_SIM_ITEMS[item_]->n.n_Type != type_)
+    return NULL;
+
+  return g_SIM_ITEMS[item_];
+}
+
+void*
+LookupItem(Item item_)
+{
+  if((item_ <= 0) || (item_ >= SIM_ITEM_MAX))
+    return NULL;
+
+  return g_SIM_ITEMS[item_];
+}
+
+/* memory */
+
+void*
+AllocMem(i32 size_,
+         u32 type_)
+{
+  void *p;
+
+  if(type_ & MEMTYPE_VRAM)
+    {
+      p = sim_vram_alloc(size_);
+      if((p != NULL) && (type_ & MEMTYPE_FILL))
+        memset(p,0,size_);
+      return p;
+    }
+  if(type_ & MEMTYPE_FILL)
+    return calloc(1,size_);
+
+  return malloc(size_);
+}
+
+void
+FreeMem(void *p_,
+        i32   size_)
+{
+  (void)size_;
+
+  if(sim_vram_owns(p_))
+    return;
+
+  free(p_);
+}
+
+/* tasks and signals */
+
+Task*
+sim_current_task(void)
+{
+  return &t_SIM_CURRENT->task;
+}
+
+void
+SuperInternalSignal(Task *task_,
+                    i32   sigmask_)
+{
+  sim_task_t *t = (sim_task_t*)task_;
+
+  t->task.t_SigBits |= sigmask_;
+  pthread_cond_signal(&t->cond);
+}
+
+Err
+SendSignal(Item task_,
+           i32  sigmask_)
+{
+  Task *t;
+
+  t = sim_item_get(task_,TASKNODE);
+  if(t == NULL)
+    return BADITEM;
+
+  SuperInternalSignal(t,sigmask_);
+
+  return 0;
+}
+
+i32
+AllocSignal(i32 sigmask_)
+{
+  i32 bit;
+  Task *t = CURRENTTASK;
+
+  if(sigmask_ != 0)
+    {
+      if(t->t_AllocatedSigs & sigmask_)
+        return 0;
+      t->t_AllocatedSigs |= sigmask_;
+      return sigmask_;
+    }
+
+  for(bit = 8; bit < 31; bit++)
+    {
+      if(t->t_AllocatedSigs & (1 << bit))
+        continue;
+      t->t_AllocatedSigs |= (1 << bit);
+      return (1 << bit);
+    }
+
+  return 0;
+}
+
+Err
+FreeSignal(i32 sigmask_)
+{
+  CURRENTTASK->t_AllocatedSigs &= ~sigmask_;
+
+  return 0;
+}
+
+static
+void
+sim_task_blocking(sim_task_t *t_)
+{
+  if(!t_->starting)
+    return;
+
+  t_->starting = 0;
+  pthread_cond_broadcast(&g_SIM_STARTED);
+}
+
+static
+i32
+sim_wait(i32 sigmask_)
+{
+  i32 rv;
+  sim_task_t *t = t_SIM_CURRENT;
+
+  sim_task_blocking(t);
+  while(!(t->task.t_SigBits & sigmask_))
+    pthread_cond_wait(&t->cond,&g_SIM_LOCK);
+
+  rv = (t->task.t_SigBits & sigmask_);
+  t->task.t_SigBits &= ~rv;
+
+  return rv;
+}
+
+i32
+WaitSignal(i32 sigmask_)
+{
+  return sim_wait(sigmask_ | SIGF_ABORT);
+}
+
+void
+Yield(void)
+{
+  pthread_mutex_unlock(&g_SIM_LOCK);
+  sched_yield();
+  pthread_mutex_lock(&g_SIM_LOCK);
+}
+
+static
+void*
+sim_task_main(void *arg_)
+{
+  sim_task_t *t = (sim_task_t*)arg_;
+
+  pthread_mutex_lock(&g_SIM_LOCK);
+  t_SIM_CURRENT = t;
+  t->entry();
+  t->exited = 1;
+  sim_task_blocking(t);
+  pthread_cond_broadcast(&g_SIM_STARTED);
+  pthread_mutex_unlock(&g_SIM_LOCK);
+
+  return NULL;
+}
+
+/*
+  The new task runs until it first waits, as a higher priority task
+  would, so whatever it sets up exists when LoadProgram returns.
+*/
+Item
+LoadProgram(const char *path_)
+{
+  Item item;
+  sim_task_t *t;
+  const sim_program_t *p;
+
+  for(p = g_SIM_PROGRAMS; p->path != NULL; p++)
+    {
+      if(!strcmp(p->path,path_))
+        break;
+    }
+  if(p->path == NULL)
+    return NOTFOUND;
+
+  t = calloc(1,sizeof(sim_task_t));
+  if(t == NULL)
+    return NOMEM;
+
+  item = sim_item_add(&t->task.t,TASKNODE,p->path);
+  if(item < 0)
+    {
+      free(t);
+      return item;
+    }
+
+  t->entry    = p->entry;
+  t->starting = 1;
+  pthread_cond_init(&t->cond,NULL);
+  pthread_create(&t->thread,NULL,sim_task_main,t);
+  while(t->starting)
+    pthread_cond_wait(&g_SIM_STARTED,&g_SIM_LOCK);
+
+  return item;
+}
+
+static
+Err
+sim_task_delete(sim_task_t *t_)
+{
+  SuperInternalSignal(&t_->task,SIGF_ABORT);
+  while(!t_->exited)
+    pthread_cond_wait(&g_SIM_STARTED,&g_SIM_LOCK);
+  pthread_join(t_->thread,NULL);
+  pthread_cond_destroy(&t_->cond);
+
+  g_SIM_ITEMS[t_->task.t.n_Item] = NULL;
+  free(t_);
+
+  return 0;
+}
+
+/* drivers and devices */
+
+static
+Item
+sim_driver_create(const TagArg *tags_)
+{
+  Item item;
+  Driver *drv;
+  Item (*init)(Driver*) = NULL;
+
+  drv = calloc(1,sizeof(Driver));
+  if(drv == NULL)
+    return NOMEM;
+
+  for(; tags_->ta_Tag != TAG_END; tags_++)
+    {
+      switch(tags_->ta_Tag)
+        {
+        case TAG_ITEM_NAME:
+          drv->drv.n.n_Name = (const char*)tags_->ta_Arg;
+          break;
+        case SIM_DRIVER_TAG_ABORTIO:
+          drv->drv_AbortIO = (void(*)(IOReq*))tags_->ta_Arg;
+          break;
+        case SIM_DRIVER_TAG_MAXCMDS:
+          drv->drv_MaxCommands = (i32)(intptr_t)tags_->ta_Arg;
+          break;
+        case SIM_DRIVER_TAG_CMDTABLE:
+          drv->drv_CmdTable = (DriverCmd*)tags_->ta_Arg;
+          break;
+        case SIM_DRIVER_TAG_INIT:
+          init = (Item(*)(Driver*))tags_->ta_Arg;
+          break;
+        }
+    }
+
+  item = sim_item_add(&drv->drv,DRIVERNODE,drv->drv.n.n_Name);
+  if(item < 0)
+    {
+      free(drv);
+      return item;
+    }
+
+  if(init != NULL)
+    return init(drv);
+
+  return item;
+}
+
+static
+Item
+sim_device_create(const TagArg *tags_)
+{
+  Item item;
+  Device *dev;
+  i32 (*init)(Device*) = NULL;
+
+  dev = calloc(1,sizeof(Device));
+  if(dev == NULL)
+    return NOMEM;
+
+  for(; tags_->ta_Tag != TAG_END; tags_++)
+    {
+      switch(tags_->ta_Tag)
+        {
+        case TAG_ITEM_NAME:
+          dev->dev.n.n_Name = (const char*)tags_->ta_Arg;
+          break;
+        case SIM_DEVICE_TAG_DRVR:
+          dev->dev_Driver = sim_item_get((Item)(intptr_t)tags_->ta_Arg,DRIVERNODE);
+          break;
+        case SIM_DEVICE_TAG_OPEN:
+          dev->dev_Open = (i32(*)(Device*))tags_->ta_Arg;
+          break;
+        case SIM_DEVICE_TAG_CLOSE:
+          dev->dev_Close = (void(*)(Device*))tags_->ta_Arg;
+          break;
+        case SIM_DEVICE_TAG_INIT:
+          init = (i32(*)(Device*))tags_->ta_Arg;
+          break;
+        }
+    }
+
+  if(dev->dev_Driver == NULL)
+    {
+      free(dev);
+      return BADITEM;
+    }
+
+  item = sim_item_add(&dev->dev,DEVICENODE,dev->dev.n.n_Name);
+  if(item < 0)
+    {
+      free(dev);
+      return item;
+    }
+
+  if(init != NULL)
+    return init(dev);
+
+  return item;
+}
+
+Item
+CreateItem(i32           ctype_,
+           const TagArg *tags_)
+{
+  switch(ctype_)
+    {
+    case MKNODEID(KERNELNODE,DRIVERNODE):
+      return sim_driver_create(tags_);
+    case MKNODEID(KERNELNODE,DEVICENODE):
+      return sim_device_create(tags_);
+    default:
+      return BADTAG;
+    }
+}
+
+Item
+OpenItem(Item  item_,
+         void *args_)
+{
+  Device *dev;
+
+  (void)args_;
+
+  dev = sim_item_get(item_,DEVICENODE);
+  if(dev == NULL)
+    return BADITEM;
+
+  dev->dev_OpenCnt++;
+  dev->dev_Driver->drv_OpenCnt++;
+  if(dev->dev_Open != NULL)
+    return dev->dev_Open(dev);
+
+  return item_;
+}
+
+Err
+CloseItem(Item item_)
+{
+  Device *dev;
+
+  dev = sim_item_get(item_,DEVICENODE);
+  if(dev == NULL)
+    return BADITEM;
+
+  dev->dev_OpenCnt--;
+  dev->dev_Driver->drv_OpenCnt--;
+  if(dev->dev_Close != NULL)
+    dev->dev_Close(dev);
+
+  return 0;
+}
+
+Item
+OpenNamedDevice(const char *name_,
+                void       *args_)
+{
+  Item i;
+
+  for(i = 1; i < SIM_ITEM_MAX; i++)
+    {
+      if(sim_item_get(i,DEVICENODE) == NULL)
+        continue;
+      if(strcmp(g_SIM_ITEMS[i]->n.n_Name,name_))
+        continue;
+
+      return OpenItem(i,args_);
+    }
+
+  return NOTFOUND;
+}
+
+Err
+CloseNamedDevice(Item device_)
+{
+  return CloseItem(device_);
+}
+
+/* io */
+
+Item
+CreateIOReq(const char *name_,
+            u8          pri_,
+            Item        device_,
+            Item        msgport_)
+{
+  Item item;
+  IOReq *ior;
+  Device *dev;
+
+  (void)pri_;
+  (void)msgport_;
+
+  dev = sim_item_get(device_,DEVICENODE);
+  if(dev == NULL)
+    return BADITEM;
+
+  ior = calloc(1,sizeof(IOReq));
+  if(ior == NULL)
+    return NOMEM;
+
+  item = sim_item_add(&ior->io,IOREQNODE,name_);
+  if(item < 0)
+    {
+      free(ior);
+      return item;
+    }
+
+  ior->io_Dev   = dev;
+  ior->io_Owner = CURRENTTASK;
+  ior->io_Flags = IO_DONE;
+
+  return item;
+}
+
+Err
+DeleteIOReq(Item ioreq_)
+{
+  IOReq *ior;
+
+  ior = sim_item_get(ioreq_,IOREQNODE);
+  if(ior == NULL)
+    return BADITEM;
+
+  if(!(ior->io_Flags & IO_DONE))
+    {
+      AbortIO(ioreq_);
+      WaitIO(ioreq_);
+    }
+
+  g_SIM_ITEMS[ioreq_] = NULL;
+  free(ior);
+
+  return 0;
+}
+
+Err
+DeleteItem(Item item_)
+{
+  ItemNode *n;
+
+  n = LookupItem(item_);
+  if(n == NULL)
+    return BADITEM;
+
+  switch(n->n.n_Type)
+    {
+    case IOREQNODE:
+      return DeleteIOReq(item_);
+    case TASKNODE:
+      return sim_task_delete((sim_task_t*)n);
+    default:
+      g_SIM_ITEMS[item_] = NULL;
+      free(n);
+      return 0;
+    }
+}
+
+void
+SuperCompleteIO(IOReq *ior_)
+{
+  ior_->io_Flags |= IO_DONE;
+  if(!(ior_->io_Flags & IO_QUICK))
+    SuperInternalSignal(ior_->io_Owner,SIGF_IODONE);
+}
+
+Err
+SendIO(Item          ioreq_,
+       const IOInfo *ioi_)
+{
+  IOReq *ior;
+  Driver *drv;
+  DriverCmd cmd;
+
+  ior = sim_item_get(ioreq_,IOREQNODE);
+  if(ior == NULL)
+    return BADITEM;
+  if(!(ior->io_Flags & IO_DONE))
+    return BADITEM;
+
+  ior->io_Info   = *ioi_;
+  ior->io_Actual = 0;
+  ior->io_Error  = 0;
+  ior->io_Flags  = (ioi_->ioi_Flags & IO_QUICK);
+  ior->io_Owner  = CURRENTTASK;
+
+  drv = ior->io_Dev->dev_Driver;
+  cmd = NULL;
+  if(ioi_->ioi_Command < drv->drv_MaxCommands)
+    cmd = drv->drv_CmdTable[ioi_->ioi_Command];
+
+  if(cmd == NULL)
+    {
+      ior->io_Error = BADCOMMAND;
+      SuperCompleteIO(ior);
+    }
+  else if(cmd(ior))
+    {
+      SuperCompleteIO(ior);
+    }
+
+  return !!(ior->io_Flags & IO_DONE);
+}
+
+Err
+WaitIO(Item ioreq_)
+{
+  IOReq *ior;
+
+  ior = sim_item_get(ioreq_,IOREQNODE);
+  if(ior == NULL)
+    return BADITEM;
+
+  while(!(ior->io_Flags & IO_DONE))
+    sim_wait(SIGF_IODONE);
+
+  return ior->io_Error;
+}
+
+Err
+DoIO(Item          ioreq_,
+     const IOInfo *ioi_)
+{
+  Err err;
+  IOInfo ioi;
+
+  ioi = *ioi_;
+  ioi.ioi_Flags |= IO_QUICK;
+
+  err = SendIO(ioreq_,&ioi);
+  if(err < 0)
+    return err;
+
+  return WaitIO(ioreq_);
+}
+
+i32
+CheckIO(Item ioreq_)
+{
+  IOReq *ior;
+
+  ior = sim_item_get(ioreq_,IOREQNODE);
+  if(ior == NULL)
+    return BADITEM;
+
+  return !!(ior->io_Flags & IO_DONE);
+}
+
+Err
+AbortIO(Item ioreq_)
+{
+  IOReq *ior;
+  Driver *drv;
+
+  ior = sim_item_get(ioreq_,IOREQNODE);
+  if(ior == NULL)
+    return BADITEM;
+
+  drv = ior->io_Dev->dev_Driver;
+  if(!(ior->io_Flags & IO_DONE) && (drv->drv_AbortIO != NULL))
+    drv->drv_AbortIO(ior);
+
+  return 0;
+}
+
+/* misc */
+
+u32
+Disable(void)
+{
+  return 0;
+}
+
+void
+Enable(u32 state_)
+{
+  (void)state_;
+}
+
+void
+PrintfSysErr(Err err_)
+{
+  static const char *errs[] =
+    {
+      "no error", "bad item", "bad pointer", "bad size", "bad unit",
+      "bad command", "bad tag", "not supported", "no memory",
+      "not found", "aborted"
+    };
+
+  if((err_ <= 0) && (-err_ < (i32)(sizeof(errs) / sizeof(errs[0]))))
+    printf("%s\n",errs[-err_]);
+  else
+    printf("error %d\n",err_);
+}
+
+u32
+sim_ticks(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+
+  return (u32)((ts.tv_sec * 1000000) + (ts.tv_nsec / 1000));
+}
+
+/* timer device, microsecond unit only */
+
+static
+i32
+sim_timer_cmdread(IOReq *ior_)
+{
+  struct timespec ts;
+  struct timeval *tv;
+
+  if(ior_->io_Info.ioi_Unit != TIMER_UNIT_USEC)
+    {
+      ior_->io_Error = BADUNIT;
+      return 1;
+    }
+  if(ior_->io_Info.ioi_Recv.iob_Len < (i32)sizeof(struct timeval))
+    {
+      ior_->io_Error = BADSIZE;
+      return 1;
+    }
+
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  tv = (struct timeval*)ior_->io_Info.ioi_Recv.iob_Buffer;
+  tv->tv_sec  = ts.tv_sec;
+  tv->tv_usec = (ts.tv_nsec / 1000);
+  ior_->io_Actual = sizeof(struct timeval);
+
+  return 1;
+}
+
+static
+void
+sim_timer_init(void)
+{
+  static DriverCmd cmds[] = {NULL,sim_timer_cmdread};
+  TagArg drv_tags[] =
+    {
+      {TAG_ITEM_NAME,           (void*)"timer"},
+      {SIM_DRIVER_TAG_MAXCMDS,  (void*)2},
+      {SIM_DRIVER_TAG_CMDTABLE, (void*)cmds},
+      {TAG_END,                 NULL}
+    };
+  TagArg dev_tags[] =
+    {
+      {TAG_ITEM_NAME,       (void*)"timer"},
+      {SIM_DEVICE_TAG_DRVR, NULL},
+      {TAG_END,             NULL}
+    };
+
+  dev_tags[1].ta_Arg = (void*)(intptr_t)CreateItem(MKNODEID(KERNELNODE,DRIVERNODE),drv_tags);
+  CreateItem(MKNODEID(KERNELNODE,DEVICENODE),dev_tags);
+}
+
+/* graphics folio, vertical blank only */
+
+#define SIM_FIELD_USEC 16667
+
+Err
+OpenGraphicsFolio(void)
+{
+  return 0;
+}
+
+Item
+GetVBLIOReq(void)
+{
+  Item timer;
+
+  timer = OpenNamedDevice("timer",0);
+  if(timer < 0)
+    return timer;
+
+  return CreateIOReq(NULL,0,timer,0);
+}
+
+/*
+  Sleeps to the start of the numfields-th field from now with the
+  other tasks free to run.
+*/
+Err
+WaitVBL(Item ioreq_,
+        u32  numfields_)
+{
+  u32 now;
+
+  (void)ioreq_;
+
+  now = sim_ticks();
+  pthread_mutex_unlock(&g_SIM_LOCK);
+  usleep((SIM_FIELD_USEC * numfields_) - (now % SIM_FIELD_USEC));
+  pthread_mutex_lock(&g_SIM_LOCK);
+
+  return 0;
+}
+
+/*
+  The thread running main() becomes the first task and holds the
+  CPU from the start.
+*/
+__attribute__((constructor))
+static
+void
+sim_init(void)
+{
+  pthread_mutex_lock(&g_SIM_LOCK);
+
+  pthread_cond_init(&g_SIM_MAIN_TASK.cond,NULL);
+  g_SIM_MAIN_TASK.thread = pthread_self();
+  sim_item_add(&g_SIM_MAIN_TASK.task.t,TASKNODE,"main");
+  t_SIM_CURRENT = &g_SIM_MAIN_TASK;
+
+  sim_mem_init();
+  sim_timer_init();
+}
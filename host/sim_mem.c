@@ -0,0 +1,416 @@
+/*
+  ISC License
+
+  Copyright (c) 2024, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#define _GNU_SOURCE
+
+#include "sim.h"
+
+#include "kernel.h"
+#include "operror.h"
+#include "svc_funcs.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define ONEMEG (1024 * 1024)
+
+#define SIM_ROM_ADDR  0x03000000
+#define SIM_ROM_SIZE  (1 * ONEMEG)
+#define SIM_ROM_BANKS 2
+
+#define SIM_VRAM_ADDR  0x00200000
+#define SIM_VRAM_SIZE  (1 * ONEMEG)
+#define SIM_SPORT_ADDR 0x03200000
+#define SIM_SPORT_PAGE_WORDS 512
+
+#define SYSINFO_TAG_SETROMBANK 0x11006
+#define SYSINFO_TAG_CURROMBANK 0x10006
+#define SYSINFO_TAG_ROM2BASE   0x10007
+#define SYSINFO_ROM2FOUND      0
+#define SYSINFO_ROM2NOTFOUND   1
+
+typedef struct sim_region_s sim_region_t;
+struct sim_region_s
+{
+  u32 addr;
+  u32 size;
+  i32 prot;
+};
+
+/*
+  NVRAM holds one byte per word so takes four times its size. The
+  register blocks get a page each. Everything else in the reservation
+  aborts.
+*/
+static const sim_region_t g_SIM_REGIONS[] =
+  {
+    {0x00000000, 2 * ONEMEG,   PROT_READ|PROT_WRITE}, // DRAM
+    {0x00200000, 1 * ONEMEG,   PROT_READ|PROT_WRITE}, // VRAM
+    {SIM_ROM_ADDR, SIM_ROM_SIZE, PROT_READ},          // ROM window
+    {0x03140000, 128 * 1024,   PROT_READ|PROT_WRITE}, // NVRAM
+    {0x03200000, 1 * ONEMEG,   PROT_READ|PROT_WRITE}, // SPORT
+    {0x03300000, 4096,         PROT_READ|PROT_WRITE}, // MADAM
+    {0x03400000, 4096,         PROT_READ|PROT_WRITE}, // CLIO
+    {0,0,0}
+  };
+
+static u8  *g_SIM_PHYS     = NULL;
+static u8  *g_SIM_FAULTS   = NULL;
+static u8  *g_SIM_HITS     = NULL;
+static u32  g_SIM_PAGE     = 4096;
+static int  g_SIM_ROM_FD   = -1;
+static i32  g_SIM_ROM_BANK = 0;
+static u32  g_SIM_VRAM_TOP = (SIM_VRAM_ADDR + SIM_VRAM_SIZE);
+
+// SPORT page buffer and flash colour register
+static u32  g_SIM_SPORT_BUF[SIM_SPORT_PAGE_WORDS];
+static u32  g_SIM_SPORT_COLOUR = 0;
+
+static KernelBase_t g_SIM_KERNELBASE;
+KernelBase_t *KernelBase = &g_SIM_KERNELBASE;
+
+void*
+sim_phys(u32 addr_)
+{
+  return (g_SIM_PHYS + addr_);
+}
+
+static
+i32
+sim_mem_prot(u32 addr_)
+{
+  const sim_region_t *r;
+
+  for(r = g_SIM_REGIONS; r->size; r++)
+    {
+      if((addr_ >= r->addr) && (addr_ < (r->addr + r->size)))
+        return r->prot;
+    }
+
+  return PROT_NONE;
+}
+
+static
+void
+sim_mem_protect_page(u32 page_)
+{
+  u32 addr;
+  i32 prot;
+
+  addr = (page_ * g_SIM_PAGE);
+  prot = sim_mem_prot(addr);
+  if(g_SIM_FAULTS[page_ >> 3] & (1 << (page_ & 7)))
+    prot = PROT_NONE;
+
+  mprotect(g_SIM_PHYS + addr,g_SIM_PAGE,prot);
+}
+
+static
+Err
+sim_fault_pages(u32 addr_,
+                u32 len_,
+                i32 on_,
+                u8  hits_)
+{
+  u32 page;
+  u32 last;
+
+  if((len_ == 0) || (addr_ >= SIM_PHYS_SIZE) || (len_ > (SIM_PHYS_SIZE - addr_)))
+    return BADPTR;
+
+  last = ((addr_ + len_ - 1) / g_SIM_PAGE);
+  for(page = (addr_ / g_SIM_PAGE); page <= last; page++)
+    {
+      if(on_)
+        g_SIM_FAULTS[page >> 3] |= (1 << (page & 7));
+      else
+        g_SIM_FAULTS[page >> 3] &= ~(1 << (page & 7));
+      g_SIM_HITS[page] = hits_;
+      sim_mem_protect_page(page);
+    }
+
+  return 0;
+}
+
+Err
+sim_fault(u32 addr_,
+          u32 len_,
+          i32 on_)
+{
+  return sim_fault_pages(addr_,len_,on_,0);
+}
+
+Err
+sim_fault_hits(u32 addr_,
+               u32 len_,
+               i32 hits_)
+{
+  if((hits_ <= 0) || (hits_ > 0xFF))
+    return BADSIZE;
+
+  return sim_fault_pages(addr_,len_,1,(u8)hits_);
+}
+
+static
+void
+sim_rom_map(i32 bank_)
+{
+  u32 page;
+
+  mmap(g_SIM_PHYS + SIM_ROM_ADDR,
+       SIM_ROM_SIZE,
+       PROT_READ,
+       MAP_SHARED|MAP_FIXED,
+       g_SIM_ROM_FD,
+       (off_t)bank_ * SIM_ROM_SIZE);
+
+  g_SIM_ROM_BANK = bank_;
+  for(page = (SIM_ROM_ADDR / g_SIM_PAGE);
+      page < ((SIM_ROM_ADDR + SIM_ROM_SIZE) / g_SIM_PAGE);
+      page++)
+    {
+      if(g_SIM_FAULTS[page >> 3] & (1 << (page & 7)))
+        sim_mem_protect_page(page);
+    }
+}
+
+/*
+  ROM banks are filled with a fixed pattern unless SVC_MEM_SIM_ROM1 /
+  SVC_MEM_SIM_ROM2 name a dump to load instead.
+*/
+static
+void
+sim_rom_init(void)
+{
+  u8 *rom;
+  u32 i;
+  i32 bank;
+  FILE *f;
+  const char *path;
+  static const char *env[SIM_ROM_BANKS] = {"SVC_MEM_SIM_ROM1","SVC_MEM_SIM_ROM2"};
+
+  g_SIM_ROM_FD = memfd_create("svc-mem-sim-rom",0);
+  if((g_SIM_ROM_FD < 0) ||
+     (ftruncate(g_SIM_ROM_FD,SIM_ROM_BANKS * SIM_ROM_SIZE) < 0))
+    {
+      perror("svc-mem-sim: rom");
+      abort();
+    }
+
+  rom = mmap(NULL,SIM_ROM_BANKS * SIM_ROM_SIZE,PROT_READ|PROT_WRITE,MAP_SHARED,g_SIM_ROM_FD,0);
+  for(bank = 0; bank < SIM_ROM_BANKS; bank++)
+    {
+      for(i = 0; i < SIM_ROM_SIZE; i++)
+        rom[(bank * SIM_ROM_SIZE) + i] = (u8)((i ^ (i >> 8) ^ (i >> 16)) + bank);
+
+      path = getenv(env[bank]);
+      if(path == NULL)
+        continue;
+      f = fopen(path,"rb");
+      if(f == NULL)
+        {
+          perror(path);
+          continue;
+        }
+      fread(&rom[bank * SIM_ROM_SIZE],1,SIM_ROM_SIZE,f);
+      fclose(f);
+    }
+  munmap(rom,SIM_ROM_BANKS * SIM_ROM_SIZE);
+
+  sim_rom_map(0);
+}
+
+/*
+  The kernel clears kb_CatchDataAborts before jumping so the catcher
+  has to re-arm, same as on hardware. Aborts nobody catches, or
+  outside the memory map, crash as usual.
+*/
+static
+void
+sim_mem_abort(int       sig_,
+              siginfo_t *si_,
+              void      *uc_)
+{
+  u8 *addr;
+  u32 page;
+  jmp_buf *jb;
+
+  (void)uc_;
+
+  addr = (u8*)si_->si_addr;
+  jb   = KernelBase->kb_CatchDataAborts;
+  if((jb != NULL) &&
+     (addr >= g_SIM_PHYS) &&
+     (addr < (g_SIM_PHYS + SIM_PHYS_SIZE)))
+    {
+      page = ((u32)(addr - g_SIM_PHYS) / g_SIM_PAGE);
+      if(g_SIM_HITS[page] && (--g_SIM_HITS[page] == 0))
+        {
+          g_SIM_FAULTS[page >> 3] &= ~(1 << (page & 7));
+          sim_mem_protect_page(page);
+        }
+
+      KernelBase->kb_CatchDataAborts = NULL;
+      longjmp(*jb,1);
+    }
+
+  signal(sig_,SIG_DFL);
+}
+
+/*
+  Bits 15 to 17 of the address pick the operation, bits 2 to 10 the
+  VRAM page. The value is the mask of bits to change except for the
+  colour register and page loads.
+*/
+void
+sim_sport_write(u32 addr_,
+                u32 v_)
+{
+  u32 i;
+  u32 *page;
+
+  addr_ -= SIM_SPORT_ADDR;
+  page   = (u32*)sim_phys(SIM_VRAM_ADDR + (((addr_ >> 2) & 0x1FF) * (SIM_SPORT_PAGE_WORDS * 4)));
+  switch(addr_ & 0x38000)
+    {
+    case 0x00000:
+      memcpy(g_SIM_SPORT_BUF,page,sizeof(g_SIM_SPORT_BUF));
+      break;
+    case 0x08000:
+      g_SIM_SPORT_COLOUR = v_;
+      break;
+    case 0x10000:
+      for(i = 0; i < SIM_SPORT_PAGE_WORDS; i++)
+        page[i] = ((page[i] & ~v_) | (g_SIM_SPORT_COLOUR & v_));
+      break;
+    case 0x18000:
+      for(i = 0; i < SIM_SPORT_PAGE_WORDS; i++)
+        page[i] = ((page[i] & ~v_) | (g_SIM_SPORT_BUF[i] & v_));
+      break;
+    }
+}
+
+/*
+  Never reused, the host build only has short lived programs.
+*/
+void*
+sim_vram_alloc(i32 size_)
+{
+  u32 size;
+
+  size = ((size_ + 3) & ~3);
+  if((size_ <= 0) || (size > (g_SIM_VRAM_TOP - SIM_VRAM_ADDR)))
+    return NULL;
+
+  g_SIM_VRAM_TOP -= size;
+
+  return sim_phys(g_SIM_VRAM_TOP);
+}
+
+i32
+sim_vram_owns(const void *p_)
+{
+  return (((const u8*)p_ >= (g_SIM_PHYS + SIM_VRAM_ADDR)) &&
+          ((const u8*)p_ < (g_SIM_PHYS + SIM_VRAM_ADDR + SIM_VRAM_SIZE)));
+}
+
+void
+sim_mem_init(void)
+{
+  const sim_region_t *r;
+  struct sigaction sa;
+
+  g_SIM_PAGE   = (u32)sysconf(_SC_PAGESIZE);
+  g_SIM_FAULTS = calloc(((SIM_PHYS_SIZE / g_SIM_PAGE) + 7) / 8,1);
+  g_SIM_HITS   = calloc(SIM_PHYS_SIZE / g_SIM_PAGE,1);
+  g_SIM_PHYS   = mmap(NULL,
+                      SIM_PHYS_SIZE,
+                      PROT_NONE,
+                      MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE,
+                      -1,
+                      0);
+  if((g_SIM_PHYS == MAP_FAILED) || (g_SIM_FAULTS == NULL) || (g_SIM_HITS == NULL))
+    {
+      perror("svc-mem-sim: memory map");
+      abort();
+    }
+
+  for(r = g_SIM_REGIONS; r->size; r++)
+    {
+      if(r->addr != SIM_ROM_ADDR)
+        mprotect(g_SIM_PHYS + r->addr,r->size,r->prot);
+    }
+  sim_rom_init();
+
+  memset(&sa,0,sizeof(sa));
+  sa.sa_sigaction = sim_mem_abort;
+  sa.sa_flags     = (SA_SIGINFO|SA_NODEFER);
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGSEGV,&sa,NULL);
+  sigaction(SIGBUS,&sa,NULL);
+}
+
+Err
+svc_SetSysInfo(u32   tag_,
+               void *info_,
+               u32   size_)
+{
+  i32 bank;
+
+  (void)size_;
+
+  switch(tag_)
+    {
+    case SYSINFO_TAG_SETROMBANK:
+      bank = (i32)(intptr_t)info_;
+      if((bank < 0) || (bank >= SIM_ROM_BANKS))
+        return BADTAG;
+      if(bank != g_SIM_ROM_BANK)
+        sim_rom_map(bank);
+      return 0;
+    default:
+      return BADTAG;
+    }
+}
+
+Err
+svc_QuerySysInfo(u32   tag_,
+                 void *info_,
+                 u32   size_)
+{
+  switch(tag_)
+    {
+    case SYSINFO_TAG_CURROMBANK:
+      if(size_ < sizeof(u32))
+        return BADSIZE;
+      *(u32*)info_ = g_SIM_ROM_BANK;
+      return 0;
+    case SYSINFO_TAG_ROM2BASE:
+      if(size_ < sizeof(void*))
+        return BADSIZE;
+      *(void**)info_ = sim_phys(SIM_ROM_ADDR);
+      return SYSINFO_ROM2FOUND;
+    default:
+      return BADTAG;
+    }
+}
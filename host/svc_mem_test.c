@@ -0,0 +1,1017 @@
+/*
+  ISC License
+
+  Copyright (c) 2024, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+  Host regression tests. Every command is run through the simulated
+  kernel, along with the paths hardware can't be made to take on
+  demand: data aborts, retried aborts and the svc_mem task exiting.
+  Prints each failed check and exits non-zero if there were any.
+  `make host-test` builds and runs it.
+*/
+
+#include "sim.h"
+#include "svc_mem.h"
+
+#include "io.h"
+#include "operror.h"
+#include "task.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define ROM_ADDR   0x03000000
+#define NVRAM_ADDR 0x03140000
+#define VRAM_ADDR  0x00200000
+#define PAGE_SIZE  4096
+
+#define CHECK(x_) test_check((x_),#x_,__LINE__)
+
+static i32 g_TEST_CHECKS   = 0;
+static i32 g_TEST_FAILURES = 0;
+
+static
+void
+test_check(const i32   ok_,
+           const char *expr_,
+           const i32   line_)
+{
+  g_TEST_CHECKS++;
+  if(ok_)
+    return;
+
+  g_TEST_FAILURES++;
+  printf("svc_mem_test.c:%d: failed: %s\n",line_,expr_);
+}
+
+static
+i32
+test_map_count(const u32 *map_,
+               const i32  len_)
+{
+  i32 i;
+  i32 n;
+
+  n = 0;
+  for(i = 0; i < len_; i++)
+    {
+      if(map_[i >> 5] & (1U << (i & 31)))
+        n++;
+    }
+
+  return n;
+}
+
+/*
+  Unit statistics, zeroed when the driver is built without them so
+  the deltas checked come out as 0.
+*/
+static
+i32
+test_stats(Item                  dev_,
+           u8                    unit_,
+           svc_mem_unit_stats_t *stats_)
+{
+  svc_mem_stats_t st;
+
+  memset(stats_,0,sizeof(*stats_));
+  if(svc_mem_stats_get(dev_,&st) < 0)
+    return 0;
+
+  *stats_ = st.units[unit_];
+
+  return 1;
+}
+
+/*
+  A page of ROM1 that always aborts is filled with the pattern and
+  marked in the map, element by element, and nothing else is. NVRAM
+  goes through the reader for one byte per word.
+*/
+static
+void
+test_faults(Item dev_)
+{
+  i32 i;
+  i32 bad;
+  i32 stats;
+  Err err;
+  u8 *nv;
+  const u32 *rom;
+  svc_mem_unit_stats_t st0;
+  svc_mem_unit_stats_t st1;
+  static u32 dst32[8192];
+  static u8  dst8[2048];
+  static u32 map[SVC_MEM_FAULTMAP_WORDS(8192)];
+
+  rom = (const u32*)sim_phys(ROM_ADDR);
+
+  stats = test_stats(dev_,SVC_MEM_UNIT_ROM1,&st0);
+  sim_fault(ROM_ADDR + (2 * PAGE_SIZE),PAGE_SIZE,1);
+  err = svc_mem_r_u32_faultmap(dev_,SVC_MEM_UNIT_ROM1,0,dst32,8192,0xDEADBEEF,map);
+  sim_fault(ROM_ADDR + (2 * PAGE_SIZE),PAGE_SIZE,0);
+  test_stats(dev_,SVC_MEM_UNIT_ROM1,&st1);
+
+  bad = 0;
+  for(i = 0; i < 8192; i++)
+    {
+      if((i >= 2048) && (i < 3072))
+        bad += ((dst32[i] != 0xDEADBEEF) || !(map[i >> 5] & (1U << (i & 31))));
+      else
+        bad += (dst32[i] != rom[i]);
+    }
+
+  CHECK(err == 0);
+  CHECK(test_map_count(map,8192) == 1024);
+  CHECK(bad == 0);
+  // a block abort per 256 elements then each element aborting twice
+  CHECK(!stats || ((st1.aborts - st0.aborts) == ((1024 / 256) + (1024 * 2))));
+  CHECK(!stats || ((st1.bytes_read - st0.bytes_read) == (8192 * 4)));
+
+  nv = (u8*)sim_phys(NVRAM_ADDR);
+  for(i = 0; i < (2048 * 4); i++)
+    nv[i] = (u8)(i * 7);
+
+  sim_fault(NVRAM_ADDR + PAGE_SIZE,PAGE_SIZE,1);
+  err = svc_mem_r_u8_faultmap(dev_,SVC_MEM_UNIT_NVRAM,0,dst8,2048,0x5A,map);
+  sim_fault(NVRAM_ADDR + PAGE_SIZE,PAGE_SIZE,0);
+
+  bad = 0;
+  for(i = 0; i < 2048; i++)
+    {
+      if(i >= 1024)
+        bad += ((dst8[i] != 0x5A) || !(map[i >> 5] & (1U << (i & 31))));
+      else
+        bad += (dst8[i] != (((const u32*)nv)[i] & 0xFF));
+    }
+
+  CHECK(err == 0);
+  CHECK(test_map_count(map,2048) == 1024);
+  CHECK(bad == 0);
+}
+
+/*
+  Neighbouring elements on two pages that each abort once. Both
+  succeed on their retry, the first element's retry isn't charged to
+  the second. The first ROM1 page aborts twice, once for the block
+  copy and once for the element read.
+*/
+static
+void
+test_retries(Item dev_)
+{
+  i32 i;
+  i32 stats;
+  Err err;
+  u8 dst8[2];
+  u32 dst32[2];
+  const u32 *rom;
+  const u32 *nv;
+  svc_mem_unit_stats_t st0;
+  svc_mem_unit_stats_t st1;
+  u32 map[1];
+
+  rom = (const u32*)sim_phys(ROM_ADDR);
+  nv  = (const u32*)sim_phys(NVRAM_ADDR);
+
+  stats = test_stats(dev_,SVC_MEM_UNIT_NVRAM,&st0);
+  sim_fault_hits(NVRAM_ADDR,PAGE_SIZE,1);
+  sim_fault_hits(NVRAM_ADDR + PAGE_SIZE,PAGE_SIZE,1);
+  err = svc_mem_r_u8_faultmap(dev_,SVC_MEM_UNIT_NVRAM,1023,dst8,2,0x5A,map);
+  test_stats(dev_,SVC_MEM_UNIT_NVRAM,&st1);
+
+  CHECK(err == 0);
+  CHECK(test_map_count(map,2) == 0);
+  CHECK((dst8[0] == (nv[1023] & 0xFF)) && (dst8[1] == (nv[1024] & 0xFF)));
+  CHECK(!stats || ((st1.aborts - st0.aborts) == 2));
+
+  stats = test_stats(dev_,SVC_MEM_UNIT_ROM1,&st0);
+  sim_fault_hits(ROM_ADDR,PAGE_SIZE,2);
+  sim_fault_hits(ROM_ADDR + PAGE_SIZE,PAGE_SIZE,1);
+  err = svc_mem_r_u32_faultmap(dev_,SVC_MEM_UNIT_ROM1,1023,dst32,2,0xDEADBEEF,map);
+  test_stats(dev_,SVC_MEM_UNIT_ROM1,&st1);
+
+  CHECK(err == 0);
+  CHECK(test_map_count(map,2) == 0);
+  CHECK((dst32[0] == rom[1023]) && (dst32[1] == rom[1024]));
+  CHECK(!stats || ((st1.aborts - st0.aborts) == 3));
+
+  // a fault that outlasts the retries is still given up on
+  sim_fault_hits(ROM_ADDR,PAGE_SIZE,3);
+  err = svc_mem_r_u32_faultmap(dev_,SVC_MEM_UNIT_ROM1,1023,dst32,2,0xDEADBEEF,map);
+  for(i = 0; i < 2; i++)
+    CHECK(dst32[i] == ((i == 0) ? 0xDEADBEEF : rom[1024]));
+  CHECK(err == 0);
+  CHECK(test_map_count(map,2) == 1);
+}
+
+static
+Err
+test_capture_io(Item        dev_,
+                u8          unit_,
+                const void *src_,
+                u32         size_,
+                u16        *dst_,
+                i32         len_)
+{
+  Err err;
+  Item ioreq;
+  IOInfo ioi = {0};
+
+  ioi.ioi_Command         = SVC_MEM_CMD_CAPTURE;
+  ioi.ioi_Unit            = unit_;
+  ioi.ioi_User            = size_;
+  ioi.ioi_Send.iob_Buffer = (void*)src_;
+  ioi.ioi_Recv.iob_Buffer = dst_;
+  ioi.ioi_Recv.iob_Len    = len_;
+
+  ioreq = svc_mem_ioreq_get(dev_);
+  if(ioreq < 0)
+    return ioreq;
+
+  err = DoIO(ioreq,&ioi);
+
+  svc_mem_ioreq_put(dev_,ioreq);
+
+  return err;
+}
+
+/*
+  Raw requests get past the library's checks. Dimensions whose
+  product doesn't fit an i32 must not wrap into a small enough
+  buffer.
+*/
+static
+void
+test_capture_bounds(Item dev_)
+{
+  i32 i;
+  Err err;
+  u32 src[4 * 2];
+  u16 img[4 * 3];
+
+  CHECK(test_capture_io(dev_,SVC_MEM_UNIT_VRAM,NULL,SVC_MEM_CAPTURE_SIZE(0xFFFF,0xFFFF),img,0x7FFFFFFF) == BADSIZE);
+  CHECK(test_capture_io(dev_,SVC_MEM_UNIT_VRAM,NULL,SVC_MEM_CAPTURE_SIZE(0,240),img,12) == BADSIZE);
+  CHECK(test_capture_io(dev_,SVC_MEM_UNIT_VRAM,NULL,SVC_MEM_CAPTURE_SIZE(320,0),img,12) == BADSIZE);
+  CHECK(test_capture_io(dev_,SVC_MEM_UNIT_VRAM,NULL,SVC_MEM_CAPTURE_SIZE(4,3),img,-1) == BADSIZE);
+  CHECK(test_capture_io(dev_,SVC_MEM_UNIT_VRAM,NULL,SVC_MEM_CAPTURE_SIZE(4,3),NULL,12) == BADPTR);
+  CHECK(svc_mem_capture_vram(dev_,0,0x10000,1,img,0) == BADSIZE);
+  CHECK(svc_mem_capture_vram(dev_,0,0xFFFF,0xFFFF,img,0) == BADSIZE);
+  CHECK(svc_mem_capture_vram(dev_,0,4,0,img,0) == BADSIZE);
+
+  for(i = 0; i < 8; i++)
+    src[i] = (((u32)(i + 0x8000) << 16) | (u32)(i + 0x100));
+
+  CHECK(test_capture_io(dev_,SVC_MEM_UNIT_NONE,src,SVC_MEM_CAPTURE_SIZE(4,3),img,11) == BADSIZE);
+
+  memset(img,0,sizeof(img));
+  err = test_capture_io(dev_,SVC_MEM_UNIT_NONE,src,SVC_MEM_CAPTURE_SIZE(4,3),img,12);
+  CHECK(err == 0);
+  for(i = 0; i < 4; i++)
+    {
+      CHECK(img[i] == (u16)(i + 0x8000));
+      CHECK(img[4 + i] == (u16)(i + 0x100));
+      CHECK(img[8 + i] == (u16)(i + 4 + 0x8000));
+    }
+}
+
+/*
+  A CAS that matches writes the word, one that doesn't only reads it.
+*/
+static
+void
+test_cas(Item dev_)
+{
+  u32 old;
+  u32 *d;
+  i32 stats;
+  Err err;
+  svc_mem_unit_stats_t st0;
+  svc_mem_unit_stats_t st1;
+
+  d = (u32*)sim_phys(0x8000);
+  d[0] = 5;
+
+  stats = test_stats(dev_,SVC_MEM_UNIT_DRAM,&st0);
+  err = svc_mem_cas_u32(dev_,SVC_MEM_UNIT_DRAM,0x8000 / 4,6,7,&old);
+  test_stats(dev_,SVC_MEM_UNIT_DRAM,&st1);
+
+  CHECK(err == 0);
+  CHECK((old == 5) && (d[0] == 5));
+  CHECK(!stats || ((st1.bytes_written - st0.bytes_written) == 0));
+  CHECK(!stats || ((st1.bytes_read - st0.bytes_read) == 4));
+
+  st0 = st1;
+  err = svc_mem_cas_u32(dev_,SVC_MEM_UNIT_DRAM,0x8000 / 4,5,7,&old);
+  test_stats(dev_,SVC_MEM_UNIT_DRAM,&st1);
+
+  CHECK(err == 0);
+  CHECK((old == 5) && (d[0] == 7));
+  CHECK(!stats || ((st1.bytes_written - st0.bytes_written) == 4));
+  CHECK(!stats || ((st1.bytes_read - st0.bytes_read) == 0));
+
+  CHECK(svc_mem_cas_u32(dev_,SVC_MEM_UNIT_ROM1,0,0,0,&old) < 0);
+}
+
+/*
+  Requests that are partly out of bounds fail before anything is
+  moved, rather than part way through on the svc_mem task.
+*/
+static
+void
+test_validation(Item dev_)
+{
+  u8 *v;
+  Item dev2;
+  static u8 src[64 * 60];
+  svc_mem_rect_t rc = {(1024 * 1024) - (64 * 50),64,1024,60};
+
+  v = (u8*)sim_phys(VRAM_ADDR);
+  v[rc.offset] = 0x11;
+  memset(src,0xEE,sizeof(src));
+
+  CHECK(svc_mem_w_u8_rect(dev_,src,SVC_MEM_UNIT_VRAM,&rc) == BADPTR);
+  CHECK(v[rc.offset] == 0x11);
+  rc.offset = 0;
+  rc.stride = 0xFFFF;
+  v[0] = 0x11;
+  CHECK(svc_mem_w_u8_rect(dev_,src,SVC_MEM_UNIT_VRAM,&rc) == BADPTR);
+  CHECK(v[0] == 0x11);
+
+  CHECK(svc_mem_vram_flash(dev_,100,0,1,0) == BADPTR);
+  CHECK(svc_mem_vram_copy_pages(dev_,0,SVC_MEM_SPORT_PAGE_SIZE * 505,10,0) == BADPTR);
+  CHECK(svc_mem_vram_copy_pages(dev_,SVC_MEM_SPORT_PAGE_SIZE * 510,0,10,0) == BADPTR);
+
+  // closing a second open keeps the first one's pool
+  dev2 = svc_mem_open_device();
+  CHECK(dev2 >= 0);
+  svc_mem_close_device(dev2);
+  CHECK(svc_mem_r_u8_unit(dev_,SVC_MEM_UNIT_DRAM,0,src,16) == 0);
+}
+
+/*
+  Negative lengths are refused before anything is touched, for the
+  caller's memory as much as for a unit, and zero lengths do nothing.
+  The guard bytes around `buf` catch a kernel running off either end.
+*/
+static
+void
+test_lengths(Item dev_)
+{
+  i32 i;
+  i32 n;
+  i32 ov;
+  i32 hits[4];
+  u32 digest;
+  u8 *d;
+  svc_mem_diff_run_t runs[4];
+  static u8 guard[256];
+  static u8 buf[256];
+  static u8 src[256];
+
+  d = (u8*)sim_phys(0x10000);
+  memset(d,0x33,256);
+  memset(buf,0x55,sizeof(buf));
+  memset(src,0xAA,sizeof(src));
+  memset(guard,0x55,sizeof(guard));
+
+  CHECK(svc_mem_r_u8(dev_,src,0,&buf[64],-5) == BADPTR);
+  CHECK(svc_mem_r_u8(dev_,src,0,&buf[64],-100) == BADPTR);
+  CHECK(svc_mem_w_u8(dev_,src,-100,&buf[64],0) == BADPTR);
+  CHECK(svc_mem_r_u8_unit(dev_,SVC_MEM_UNIT_DRAM,0x10000,&buf[64],-1) == BADPTR);
+  CHECK(svc_mem_w_u8_unit(dev_,src,-1,SVC_MEM_UNIT_DRAM,0x10000) == BADPTR);
+  CHECK(svc_mem_fill_u8(dev_,buf,64,0xFF,-100) == BADPTR);
+  CHECK(svc_mem_fill_u32(dev_,(u32*)buf,16,0xFFFFFFFF,-1) == BADPTR);
+  CHECK(svc_mem_copy_u8(dev_,SVC_MEM_UNIT_DRAM,0x10000,SVC_MEM_UNIT_DRAM,0x10004,-100) < 0);
+  CHECK(memcmp(buf,guard,sizeof(buf)) == 0);
+
+  digest = 0;
+  CHECK(svc_mem_checksum_u8(dev_,SVC_MEM_UNIT_DRAM,0x10000,-1,SVC_MEM_CHECKSUM_CRC32,&digest) < 0);
+  CHECK(svc_mem_search_u8(dev_,SVC_MEM_UNIT_DRAM,0x10000,-1,src,NULL,1,hits,4,&n) < 0);
+  CHECK(svc_mem_diff_u8(dev_,SVC_MEM_UNIT_DRAM,0x10000,-1,src,runs,4,&n,&ov) < 0);
+
+  CHECK(svc_mem_r_u8(dev_,src,0,&buf[64],0) == 0);
+  CHECK(svc_mem_w_u8_unit(dev_,src,0,SVC_MEM_UNIT_DRAM,0x10000) == 0);
+  CHECK(svc_mem_fill_u8(dev_,buf,64,0xFF,0) == 0);
+  CHECK(svc_mem_copy_u8(dev_,SVC_MEM_UNIT_DRAM,0x10000,SVC_MEM_UNIT_DRAM,0x10004,0) == 0);
+  CHECK(memcmp(buf,guard,sizeof(buf)) == 0);
+  for(i = 0; i < 256; i++)
+    CHECK(d[i] == 0x33);
+
+  digest = 0x1234;
+  CHECK(svc_mem_checksum_u8(dev_,SVC_MEM_UNIT_DRAM,0x10000,0,SVC_MEM_CHECKSUM_CRC32,&digest) == 0);
+  CHECK(digest == 0x1234);
+  CHECK(svc_mem_search_u8(dev_,SVC_MEM_UNIT_DRAM,0x10000,0,src,NULL,1,hits,4,&n) == 0);
+  CHECK(n == 0);
+  CHECK(svc_mem_diff_u8(dev_,SVC_MEM_UNIT_DRAM,0x10000,0,src,runs,4,&n,&ov) == 0);
+  CHECK((n == 0) && (ov == 0));
+}
+
+/*
+  By default a batch stops at the first failure and `done` is where to
+  resume, with SVC_MEM_CMD_FLAG_CONTINUE every entry runs and `done`
+  only counts the successes.
+*/
+static
+void
+test_batch(Item dev_)
+{
+  i32 done;
+  Err err;
+  Item ioreq;
+  u8 a[16];
+  u8 b[16];
+  u8 c[16];
+  Err errs[4];
+  IOInfo ioi = {0};
+  svc_mem_batch_t batch;
+  svc_mem_batch_entry_t ents[4];
+  static u8 big[64 * 1024];
+
+  memset(sim_phys(0x11000),0x42,16);
+  memset(a,0,sizeof(a));
+  memset(b,0,sizeof(b));
+  memset(c,0,sizeof(c));
+
+  svc_mem_batch_init(&batch,ents,errs,4);
+  svc_mem_batch_r_u8(&batch,SVC_MEM_UNIT_DRAM,0x11000,a,16);
+  svc_mem_batch_r_u8(&batch,SVC_MEM_UNIT_DRAM,0x11000,b,16);
+  svc_mem_batch_r_u8(&batch,SVC_MEM_UNIT_DRAM,0x7FFFFFF,c,16);
+  svc_mem_batch_r_u8(&batch,SVC_MEM_UNIT_DRAM,0x11000,c,16);
+
+  batch.options = SVC_MEM_CMD_FLAG_CONTINUE;
+  err = svc_mem_batch_exec(dev_,&batch,0,&done);
+  CHECK(err == BADPTR);
+  CHECK(done == 3);
+  CHECK((errs[0] == 0) && (errs[1] == 0) && (errs[2] == BADPTR) && (errs[3] == 0));
+  CHECK((a[15] == 0x42) && (b[15] == 0x42) && (c[15] == 0x42));
+
+  batch.options = 0;
+  err = svc_mem_batch_exec(dev_,&batch,0,&done);
+  CHECK(err == BADPTR);
+  CHECK(done == 2);
+  CHECK(svc_mem_batch_exec(dev_,&batch,done + 1,&done) == 0);
+  CHECK(done == 4);
+
+  svc_mem_batch_reset(&batch);
+  svc_mem_batch_r_u8(&batch,SVC_MEM_UNIT_DRAM,0,big,sizeof(big));
+  CHECK(svc_mem_batch_exec(dev_,&batch,0,&done) == BADSIZE);
+  CHECK(done == 0);
+
+  ioi.ioi_Command      = SVC_MEM_CMD_BATCH;
+  ioi.ioi_Send.iob_Len = 3;
+  ioreq = svc_mem_ioreq_get(dev_);
+  CHECK(DoIO(ioreq,&ioi) == BADPTR);
+  svc_mem_ioreq_put(dev_,ioreq);
+}
+
+/*
+  Odd offsets and lengths put the aligned body of the fill between
+  byte sized head and tail, 0xFF being the byte that used to overflow
+  when spread over a word.
+*/
+static
+void
+test_fill(Item dev_)
+{
+  i32 i;
+  i32 bad;
+  u8 *d;
+  static u8  b8[1000];
+  static u16 b16[1000];
+  static u32 b32[1000];
+
+  memset(b8,0,sizeof(b8));
+  CHECK(svc_mem_fill_u8(dev_,b8,3,0xFF,990) == 0);
+  for(i = bad = 0; i < 1000; i++)
+    bad += (b8[i] != (((i >= 3) && (i < 993)) ? 0xFF : 0));
+  CHECK(bad == 0);
+
+  memset(b16,0,sizeof(b16));
+  CHECK(svc_mem_fill_u16(dev_,b16,1,0xBEEF,997) == 0);
+  for(i = bad = 0; i < 1000; i++)
+    bad += (b16[i] != (((i >= 1) && (i < 998)) ? 0xBEEF : 0));
+  CHECK(bad == 0);
+
+  memset(b32,0,sizeof(b32));
+  CHECK(svc_mem_fill_u32(dev_,b32,5,0x11223344,990) == 0);
+  for(i = bad = 0; i < 1000; i++)
+    bad += (b32[i] != (((i >= 5) && (i < 995)) ? 0x11223344 : 0));
+  CHECK(bad == 0);
+
+  // large enough to be chunked by the svc_mem task
+  d = (u8*)sim_phys(0x20000);
+  memset(d,0,300002);
+  CHECK(svc_mem_fill_u8_dram(dev_,0x20001,0x7E,300000) == 0);
+  for(i = bad = 0; i < 300002; i++)
+    bad += (d[i] != (((i >= 1) && (i <= 300000)) ? 0x7E : 0));
+  CHECK(bad == 0);
+
+  CHECK(svc_mem_fill_u32_unit(dev_,SVC_MEM_UNIT_ROM1,0,0,4) < 0);
+  CHECK(svc_mem_fill_u32_dram(dev_,(2 * 1024 * 1024 / 4) - 2,0,4) == BADPTR);
+}
+
+/*
+  Overlapping copies in both directions, in bytes and words, behave
+  like memmove. The byte copies are chunked.
+*/
+static
+void
+test_copy(Item dev_)
+{
+  i32 i;
+  u8 *d;
+  static u8 ref[300016];
+
+  d = (u8*)sim_phys(0x80000);
+  for(i = 0; i < 300016; i++)
+    ref[i] = d[i] = (u8)((i * 7) + (i / 251));
+
+  memmove(&ref[3],&ref[0],300000);
+  CHECK(svc_mem_copy_u8(dev_,SVC_MEM_UNIT_DRAM,0x80000,SVC_MEM_UNIT_DRAM,0x80003,300000) == 0);
+  CHECK(memcmp(d,ref,300016) == 0);
+
+  memmove(&ref[0],&ref[5],300000);
+  CHECK(svc_mem_copy_u8(dev_,SVC_MEM_UNIT_DRAM,0x80005,SVC_MEM_UNIT_DRAM,0x80000,300000) == 0);
+  CHECK(memcmp(d,ref,300016) == 0);
+
+  memmove(&ref[4 * 3],&ref[0],4 * 70000);
+  CHECK(svc_mem_copy_u32(dev_,SVC_MEM_UNIT_DRAM,0x80000 / 4,SVC_MEM_UNIT_DRAM,(0x80000 / 4) + 3,70000) == 0);
+  CHECK(memcmp(d,ref,300016) == 0);
+
+  memmove(&ref[0],&ref[4],4 * 70000);
+  CHECK(svc_mem_copy_u32(dev_,SVC_MEM_UNIT_DRAM,(0x80000 / 4) + 1,SVC_MEM_UNIT_DRAM,0x80000 / 4,70000) == 0);
+  CHECK(memcmp(d,ref,300016) == 0);
+
+  CHECK(svc_mem_copy_u8(dev_,SVC_MEM_UNIT_DRAM,0,SVC_MEM_UNIT_ROM1,0,4) < 0);
+  CHECK(svc_mem_copy_u8(dev_,SVC_MEM_UNIT_DRAM,(2 * 1024 * 1024) - 4,SVC_MEM_UNIT_VRAM,0,8) == BADPTR);
+}
+
+/*
+  Known vectors, and continuing a digest across a chunked range gives
+  the same result as hashing it in one go.
+*/
+static
+void
+test_checksum(Item dev_)
+{
+  u8 *d;
+  i32 i;
+  u32 one;
+  u32 two;
+
+  d = (u8*)sim_phys(0x12000);
+  memcpy(d,"123456789",9);
+  memcpy(&d[16],"Wikipedia",9);
+
+  one = SVC_MEM_CHECKSUM_INIT(SVC_MEM_CHECKSUM_CRC32);
+  CHECK(svc_mem_checksum_u8(dev_,SVC_MEM_UNIT_DRAM,0x12000,9,SVC_MEM_CHECKSUM_CRC32,&one) == 0);
+  CHECK(one == 0xCBF43926);
+  one = SVC_MEM_CHECKSUM_INIT(SVC_MEM_CHECKSUM_ADLER32);
+  CHECK(svc_mem_checksum_u8(dev_,SVC_MEM_UNIT_DRAM,0x12000,9,SVC_MEM_CHECKSUM_ADLER32,&one) == 0);
+  CHECK(one == 0x091E01DE);
+  one = SVC_MEM_CHECKSUM_INIT(SVC_MEM_CHECKSUM_ADLER32);
+  CHECK(svc_mem_checksum_u8(dev_,SVC_MEM_UNIT_DRAM,0x12010,9,SVC_MEM_CHECKSUM_ADLER32,&one) == 0);
+  CHECK(one == 0x11E60398);
+
+  d = (u8*)sim_phys(0x100000);
+  for(i = 0; i < 500000; i++)
+    d[i] = (u8)((i * 13) + (i / 97));
+
+  one = two = 0;
+  CHECK(svc_mem_checksum_u8(dev_,SVC_MEM_UNIT_DRAM,0x100001,499999,SVC_MEM_CHECKSUM_CRC32,&one) == 0);
+  CHECK(svc_mem_checksum_u8(dev_,SVC_MEM_UNIT_DRAM,0x100001,1000,SVC_MEM_CHECKSUM_CRC32,&two) == 0);
+  CHECK(svc_mem_checksum_u8(dev_,SVC_MEM_UNIT_DRAM,0x100001 + 1000,498999,SVC_MEM_CHECKSUM_CRC32,&two) == 0);
+  CHECK(one == two);
+
+  one = two = 1;
+  CHECK(svc_mem_checksum_u8(dev_,SVC_MEM_UNIT_DRAM,0x100001,499999,SVC_MEM_CHECKSUM_ADLER32,&one) == 0);
+  CHECK(svc_mem_checksum_u8(dev_,SVC_MEM_UNIT_DRAM,0x100001,7777,SVC_MEM_CHECKSUM_ADLER32,&two) == 0);
+  CHECK(svc_mem_checksum_u8(dev_,SVC_MEM_UNIT_DRAM,0x100001 + 7777,492222,SVC_MEM_CHECKSUM_ADLER32,&two) == 0);
+  CHECK(one == two);
+
+  one = 0;
+  CHECK(svc_mem_checksum_u8(dev_,SVC_MEM_UNIT_DRAM,0,4,SVC_MEM_CHECKSUM_MAX + 1,&one) < 0);
+}
+
+/*
+  Hits come back in order, under the mask, and stop at `max`.
+*/
+static
+void
+test_search(Item dev_)
+{
+  u8 *d;
+  i32 i;
+  i32 n;
+  i32 bad;
+  u32 w[2];
+  i32 hits[64];
+  static const u8 pat[3] = {0x12,0x34,0x56};
+  static const u8 msk[3] = {0xFF,0xF0,0xFF};
+  static const i32 at[5] = {1,100,4093,4096,59997};
+
+  d = (u8*)sim_phys(0x13000);
+  memset(d,0,60000);
+  for(i = 0; i < 5; i++)
+    {
+      d[at[i] + 0] = 0x12;
+      d[at[i] + 1] = (u8)(0x30 + i);
+      d[at[i] + 2] = 0x56;
+    }
+
+  CHECK(svc_mem_search_u8(dev_,SVC_MEM_UNIT_DRAM,0x13000,60000,pat,msk,3,hits,64,&n) == 0);
+  CHECK(n == 5);
+  for(i = bad = 0; (i < n) && (i < 5); i++)
+    bad += (hits[i] != (0x13000 + at[i]));
+  CHECK(bad == 0);
+
+  CHECK(svc_mem_search_u8(dev_,SVC_MEM_UNIT_DRAM,0x13000,60000,pat,NULL,3,hits,64,&n) == 0);
+  CHECK((n == 1) && (hits[0] == (0x13000 + at[4])));
+
+  CHECK(svc_mem_search_u8(dev_,SVC_MEM_UNIT_DRAM,0x13000,60000,pat,msk,3,hits,2,&n) == 0);
+  CHECK((n == 2) && (hits[1] == (0x13000 + at[1])));
+
+  w[0] = ((const u32*)sim_phys(0x03000000))[100];
+  w[1] = ((const u32*)sim_phys(0x03000000))[101];
+  CHECK(svc_mem_search_u32(dev_,SVC_MEM_UNIT_ROM1,0,8192,w,NULL,2,hits,64,&n) == 0);
+  CHECK((n >= 1) && (hits[0] == 100));
+}
+
+/*
+  Changed elements come back as runs, with `overflow` set once `max`
+  runs are not enough.
+*/
+static
+void
+test_diff(Item dev_)
+{
+  u8 *d;
+  i32 n;
+  i32 ov;
+  svc_mem_diff_run_t runs[8];
+  static u8 ref[100000];
+
+  d = (u8*)sim_phys(0x14000);
+  memset(d,0,100000);
+  memset(ref,0,sizeof(ref));
+  d[5] = d[6] = 1;
+  memset(&d[50000],0xFF,40000);
+  d[99999] = 1;
+
+  CHECK(svc_mem_diff_u8(dev_,SVC_MEM_UNIT_DRAM,0x14000,100000,ref,runs,8,&n,&ov) == 0);
+  CHECK((n == 3) && (ov == 0));
+  CHECK((runs[0].offset == 0x14000 + 5) && (runs[0].len == 2));
+  CHECK((runs[1].offset == 0x14000 + 50000) && (runs[1].len == 40000));
+  CHECK((runs[2].offset == 0x14000 + 99999) && (runs[2].len == 1));
+
+  CHECK(svc_mem_diff_u8(dev_,SVC_MEM_UNIT_DRAM,0x14000,100000,ref,runs,2,&n,&ov) == 0);
+  CHECK((n == 2) && (ov != 0));
+}
+
+/*
+  Only the words that differ from `prev` are written, across chunks,
+  and rectangles limit the writes to themselves.
+*/
+static
+void
+test_delta(Item dev_)
+{
+  i32 i;
+  i32 w;
+  i32 bad;
+  u32 *v;
+  static u32 next[38400];
+  static u32 prev[38400];
+  svc_mem_rect_t rc[2] = {{(160 * 10) + 5,20,160,30},{0,3,1,2}};
+
+  v = (u32*)sim_phys(VRAM_ADDR);
+  for(i = 0; i < 38400; i++)
+    next[i] = prev[i] = (u32)(i * 3);
+  memcpy(&v[1000],prev,sizeof(prev));
+  next[5]++;
+  next[7]++;
+  next[20000]++;
+  next[38399]++;
+
+  CHECK(svc_mem_w_u32_delta(dev_,SVC_MEM_UNIT_VRAM,1000,next,prev,38400,&w) == 0);
+  // 5 to 7 goes as one run, the unchanged word between included
+  CHECK(w == 5);
+  for(i = bad = 0; i < 38400; i++)
+    bad += (v[1000 + i] != next[i]);
+  CHECK(bad == 0);
+
+  CHECK(svc_mem_w_u32_delta(dev_,SVC_MEM_UNIT_VRAM,1000,next,NULL,38400,&w) == 0);
+  CHECK(w == 38400);
+
+  for(i = 0; i < 38400; i++)
+    next[i] = (u32)(i * 5);
+  CHECK(svc_mem_w_u32_rects(dev_,SVC_MEM_UNIT_VRAM,1000,next,NULL,38400,rc,2,&w) == 0);
+  CHECK(w == ((20 * 30) + (3 * 2)));
+  CHECK(v[1000 + 1605] == next[1605]);
+  CHECK(v[1000 + 1604] != next[1604]);
+
+  rc[0].rows = 1000;
+  CHECK(svc_mem_w_u32_rects(dev_,SVC_MEM_UNIT_VRAM,1000,next,NULL,38400,rc,2,&w) < 0);
+  CHECK(svc_mem_w_u32_delta(dev_,SVC_MEM_UNIT_VRAM,1000,next,prev,-1,&w) < 0);
+}
+
+/*
+  A rectangle written then read back, with everything around it left
+  alone.
+*/
+static
+void
+test_rect(Item dev_)
+{
+  i32 x;
+  i32 y;
+  i32 bad;
+  u8 *v;
+  static u8 img[640 * 240];
+  static u8 out[200 * 150];
+  svc_mem_rect_t rc = {(640 * 30) + 11,200,640,150};
+
+  v = (u8*)sim_phys(VRAM_ADDR);
+  for(x = 0; x < (640 * 240); x++)
+    img[x] = v[x] = (u8)((x * 7) + (x / 640));
+  for(x = 0; x < (200 * 150); x++)
+    out[x] = (u8)~x;
+
+  CHECK(svc_mem_w_u8_rect(dev_,out,SVC_MEM_UNIT_VRAM,&rc) == 0);
+  for(y = bad = 0; y < 240; y++)
+    for(x = 0; x < 640; x++)
+      {
+        if((y >= 30) && (y < 180) && (x >= 11) && (x < 211))
+          bad += (v[(y * 640) + x] != out[((y - 30) * 200) + (x - 11)]);
+        else
+          bad += (v[(y * 640) + x] != img[(y * 640) + x]);
+      }
+  CHECK(bad == 0);
+
+  memset(out,0,sizeof(out));
+  CHECK(svc_mem_r_u8_rect(dev_,SVC_MEM_UNIT_VRAM,&rc,out) == 0);
+  for(y = bad = 0; y < 150; y++)
+    for(x = 0; x < 200; x++)
+      bad += (out[(y * 200) + x] != v[rc.offset + (y * 640) + x]);
+  CHECK(bad == 0);
+
+  rc.rows = -1;
+  CHECK(svc_mem_r_u8_rect(dev_,SVC_MEM_UNIT_VRAM,&rc,out) < 0);
+}
+
+/*
+  Waits that hold at once, time out, complete once the word changes
+  and are aborted.
+*/
+static
+void
+test_wait(Item dev_)
+{
+  i32 n;
+  u32 *clio;
+  Item ioreq;
+  svc_mem_wait_t w = {0x80,0x80,10,5,0,0};
+
+  clio = (u32*)sim_phys(0x03400000);
+
+  clio[8] = 0x81;
+  CHECK(svc_mem_wait_u32(dev_,SVC_MEM_UNIT_CLIO,8,&w) == 1);
+  CHECK(w.word == 0x81);
+
+  clio[8] = 0;
+  CHECK(svc_mem_wait_u32(dev_,SVC_MEM_UNIT_CLIO,8,&w) == 0);
+  CHECK(w.waited == 5);
+
+  w.timeout = 100;
+  ioreq = svc_mem_wait_u32_async(dev_,SVC_MEM_UNIT_CLIO,8,&w);
+  CHECK(ioreq >= 0);
+  clio[8] = 0x80;
+  CHECK(svc_mem_io_wait(dev_,ioreq,&n) == 0);
+  CHECK(n == 1);
+
+  clio[8] = 0;
+  ioreq = svc_mem_wait_u32_async(dev_,SVC_MEM_UNIT_CLIO,8,&w);
+  svc_mem_io_abort(ioreq);
+  CHECK(svc_mem_io_wait(dev_,ioreq,&n) == ABORTED);
+  CHECK(n == 0);
+
+  CHECK(svc_mem_wait_u32(dev_,SVC_MEM_UNIT_ROM1,8,&w) < 0);
+}
+
+/*
+  Sleeps for a few vertical blanks the way a client would, in a wait
+  that can't hold.
+*/
+static
+void
+test_vbls(Item dev_,
+          i32  n_)
+{
+  svc_mem_wait_t w = {1,1,1,0,0,0};
+
+  ((u32*)sim_phys(0x03400000))[9] = 0;
+  w.timeout = n_;
+  svc_mem_wait_u32(dev_,SVC_MEM_UNIT_CLIO,9,&w);
+}
+
+/*
+  Records carry the time and the sampled words, in order, and stop
+  reports how many were taken.
+*/
+static
+void
+test_sample(Item dev_)
+{
+  i32 i;
+  i32 n;
+  i32 total;
+  u32 *clio;
+  Item ioreq;
+  Err err;
+  svc_mem_ring_t ring;
+  static u32 data[8 * 2];
+  static u32 out[64 * 2];
+  svc_mem_sample_word_t ws[1] = {{SVC_MEM_UNIT_CLIO,{0},8}};
+  svc_mem_sample_t desc = {ws,1,1,&ring};
+
+  clio = (u32*)sim_phys(0x03400000);
+
+  CHECK(svc_mem_ring_init(&ring,data,8,2) == 0);
+  ioreq = svc_mem_sample_start(dev_,&desc);
+  CHECK(ioreq >= 0);
+
+  total = 0;
+  for(i = 0; i < 10; i++)
+    {
+      clio[8] = (u32)i;
+      test_vbls(dev_,1);
+      n = svc_mem_ring_read(&ring,out,64);
+      if(n > 0)
+        CHECK(out[((n - 1) * 2) + 1] <= (u32)i);
+      total += n;
+    }
+
+  err = svc_mem_sample_stop(dev_,ioreq);
+  CHECK(err >= total);
+  CHECK(total > 0);
+
+  desc.count = 0;
+  ioreq = svc_mem_sample_start(dev_,&desc);
+  CHECK(svc_mem_io_wait(dev_,ioreq,&n) < 0);
+}
+
+/*
+  A change in any range raises the signal and its bit once.
+*/
+static
+void
+test_watch(Item dev_)
+{
+  u8 *d;
+  i32 sig;
+  Item ioreq;
+  svc_mem_watch_range_t rs[2] = {{SVC_MEM_UNIT_DRAM,{0},0x15000,256,0},
+                                 {SVC_MEM_UNIT_VRAM,{0},0x4000,64,0}};
+  svc_mem_watch_t w = {rs,2,1,0,0,0};
+
+  d = (u8*)sim_phys(0x15000);
+
+  sig      = AllocSignal(0);
+  w.signal = sig;
+  ioreq    = svc_mem_watch_start(dev_,&w);
+  CHECK(ioreq >= 0);
+
+  d[200] ^= 0x55;
+  CHECK(WaitSignal(sig) & sig);
+  CHECK(svc_mem_watch_changed(&w) == 0x1);
+  CHECK(svc_mem_watch_changed(&w) == 0);
+
+  ((u8*)sim_phys(VRAM_ADDR + 0x4000))[3] ^= 1;
+  CHECK(WaitSignal(sig) & sig);
+  CHECK(svc_mem_watch_changed(&w) == 0x2);
+
+  CHECK(svc_mem_watch_stop(dev_,ioreq) == 2);
+  FreeSignal(sig);
+
+  rs[1].unit = SVC_MEM_UNIT_CLIO;
+  CHECK(svc_mem_io_wait(dev_,svc_mem_watch_start(dev_,&w),NULL) < 0);
+}
+
+/*
+  Async requests report every byte when they finish, and what was
+  moved before an abort, in whole chunks, when they don't.
+*/
+static
+void
+test_async(Item dev_)
+{
+  i32 n;
+  Item ioreq;
+  svc_mem_config_t cfg;
+  static u8 dst[256 * 1024];
+
+  memset(sim_phys(0),0x5C,sizeof(dst));
+  CHECK(svc_mem_config_get(dev_,&cfg) == 0);
+
+  ioreq = svc_mem_r_u8_unit_async(dev_,SVC_MEM_UNIT_DRAM,0,dst,sizeof(dst));
+  CHECK(ioreq >= 0);
+  CHECK(svc_mem_io_wait(dev_,ioreq,&n) == 0);
+  CHECK(n == (i32)sizeof(dst));
+  CHECK(dst[sizeof(dst) - 1] == 0x5C);
+
+  ioreq = svc_mem_r_u8_unit_async(dev_,SVC_MEM_UNIT_DRAM,0,dst,sizeof(dst));
+  CHECK(svc_mem_io_poll(ioreq) == 0);
+  svc_mem_io_abort(ioreq);
+  CHECK(svc_mem_io_wait(dev_,ioreq,&n) == ABORTED);
+  CHECK((n >= 0) && (n < (i32)sizeof(dst)) && ((n % cfg.chunk_size) == 0));
+
+  ioreq = svc_mem_r_u8_unit_async(dev_,SVC_MEM_UNIT_DRAM,-1,dst,16);
+  CHECK(svc_mem_io_wait(dev_,ioreq,&n) == BADPTR);
+  CHECK(n == 0);
+}
+
+/*
+  Run last, it takes the svc_mem task down. What was left with it
+  completes with ABORTED and the driver goes on without it.
+*/
+static
+void
+test_drain(Item dev_)
+{
+  i32 n;
+  u8 b[16];
+  Item ioreq;
+  svc_mem_wait_t w = {1,1,1,100000,0,0};
+
+  ((u32*)sim_phys(0x03400000))[9] = 0;
+  ioreq = svc_mem_wait_u32_async(dev_,SVC_MEM_UNIT_CLIO,9,&w);
+  CHECK(ioreq >= 0);
+
+  CHECK(svc_mem_destroy() == 0);
+  CHECK(svc_mem_io_wait(dev_,ioreq,&n) == ABORTED);
+  CHECK(n == 0);
+  CHECK(svc_mem_r_u8_unit(dev_,SVC_MEM_UNIT_DRAM,0,b,sizeof(b)) == 0);
+}
+
+int
+main()
+{
+  Err err;
+  Item dev;
+
+  err = svc_mem_init();
+  if(err < 0)
+    goto error;
+
+  dev = svc_mem_open_device();
+  if(dev < 0)
+    {
+      err = dev;
+      goto error;
+    }
+
+  test_faults(dev);
+  test_retries(dev);
+  test_capture_bounds(dev);
+  test_cas(dev);
+  test_validation(dev);
+  test_lengths(dev);
+  test_batch(dev);
+  test_fill(dev);
+  test_copy(dev);
+  test_checksum(dev);
+  test_search(dev);
+  test_diff(dev);
+  test_delta(dev);
+  test_rect(dev);
+  test_wait(dev);
+  test_sample(dev);
+  test_watch(dev);
+  test_async(dev);
+  test_drain(dev);
+
+  svc_mem_close_device(dev);
+
+  printf("%d checks, %d failed\n",g_TEST_CHECKS,g_TEST_FAILURES);
+
+  return !!g_TEST_FAILURES;
+
+ error:
+  PrintfSysErr(err);
+  return 1;
+}
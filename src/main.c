@@ -20,17 +20,90 @@
 #include "svc_mem_dev.h"
 
 #include "debug.h"
+#include "graphics.h"
+#include "io.h"
+#include "item.h"
+#include "kernel.h"
 #include "operror.h"
 #include "task.h"
+#include "time.h"
 
 #define NAME "svc-mem"
 static const char VERSION[] = "1.0.0 " __DATE__ " " __TIME__;
 
+static
+u32
+usec_now(Item timer_)
+{
+  IOInfo ioi = {0};
+  struct timeval tv;
+
+  ioi.ioi_Command         = CMD_READ;
+  ioi.ioi_Unit            = TIMER_UNIT_USEC;
+  ioi.ioi_Recv.iob_Buffer = &tv;
+  ioi.ioi_Recv.iob_Len    = sizeof(tv);
+
+  DoIO(timer_,&ioi);
+
+  return (((u32)tv.tv_sec * 1000000) + (u32)tv.tv_usec);
+}
+
+/*
+  Requests queued by the driver are moved one chunk per
+  SVC_MEM_CMD_WORK until the driver reports the queue empty. Higher
+  priority tasks get the CPU back as each chunk returns from the
+  driver, Yield lets tasks of equal priority in as well. Chunks that
+  have to start in a vertical blank, samplers and waits wait for one
+  instead, the time read right after it stamping the samples. Samplers
+  and watches keep the loop going indefinitely so SIGF_ABORT is looked
+  for on every pass, returning non-zero once it is pending.
+*/
+static
+i32
+run_work(Item ioreq_,
+         Item vbl_,
+         Item timer_)
+{
+  IOReq *ior;
+  IOInfo ioi = {0};
+
+  ioi.ioi_Command = SVC_MEM_CMD_WORK;
+
+  ior = (IOReq*)LookupItem(ioreq_);
+  for(;;)
+    {
+      if(GetCurrentSignals() & SIGF_ABORT)
+        return 1;
+
+      DoIO(ioreq_,&ioi);
+      if(ior->io_Actual == 0)
+        break;
+
+      ioi.ioi_CmdOptions = 0;
+      if(ior->io_Actual & SVC_MEM_WORK_VBL)
+        {
+          WaitVBL(vbl_,1);
+          ioi.ioi_CmdOptions = SVC_MEM_WORK_VBL;
+          ioi.ioi_Offset     = (i32)usec_now(timer_);
+        }
+      else
+        {
+          Yield();
+        }
+    }
+
+  return 0;
+}
+
 int
 main()
 {
   Item drv;
   Item dev;
+  Item vbl;
+  Item work;
+  Item timer;
+  Item timerdev;
   i32 signal;
   i32 rxsignal;
 
@@ -68,6 +141,45 @@ main()
       return 0;
     }
 
+  dev = OpenItem(dev,0);
+  if(dev < 0)
+    {
+      kprintf(NAME ": unable to open device - ");
+      PrintfSysErr(dev);
+      return 0;
+    }
+
+  work = CreateIOReq(NULL,0,dev,0);
+  if(work < 0)
+    {
+      kprintf(NAME ": unable to create work ioreq - ");
+      PrintfSysErr(work);
+      return 0;
+    }
+
+  vbl = OpenGraphicsFolio();
+  if(vbl >= 0)
+    vbl = GetVBLIOReq();
+  if(vbl < 0)
+    {
+      kprintf(NAME ": unable to get vbl ioreq - ");
+      PrintfSysErr(vbl);
+      return 0;
+    }
+
+  timerdev = OpenNamedDevice("timer",0);
+  timer    = timerdev;
+  if(timer >= 0)
+    timer = CreateIOReq(NULL,0,timerdev,0);
+  if(timer < 0)
+    {
+      kprintf(NAME ": unable to create timer ioreq - ");
+      PrintfSysErr(timer);
+      return 0;
+    }
+
+  svc_mem_drv_set_worker(CURRENTTASK,signal);
+
   kprintf(NAME ": entering wait signal loop - drv_item=%x; dev_item=%x\n",
           drv,
           dev);
@@ -75,9 +187,11 @@ main()
     {
       rxsignal = WaitSignal(signal);
       if(rxsignal & SIGF_ABORT)
+        break;
+      else if(rxsignal & signal)
         {
-          kprintf(NAME ": SIGF_ABORT received\n");
-          return 0;
+          if(run_work(work,vbl,timer))
+            break;
         }
       else
         {
@@ -85,6 +199,17 @@ main()
         }
     }
 
+  kprintf(NAME ": SIGF_ABORT received\n");
+
+  // the driver falls back to running requests in the dispatch and
+  // what was left for this task to move or poll is aborted
+  svc_mem_drv_drain(work);
+
+  DeleteIOReq(timer);
+  CloseNamedDevice(timerdev);
+  DeleteIOReq(work);
+  CloseItem(dev);
+
   kprintf(NAME ": exited main loop - drv_item=%x; dev_item=%x\n",
           drv,
           dev);
@@ -23,8 +23,47 @@
 #include "io.h"
 #include "filefunctions.h"
 #include "device.h"
+#include "item.h"
+#include "kernel.h"
+#include "mem.h"
+
+/*
+  Start of VRAM in the address space, the host build keeps the memory
+  map in its own reservation.
+*/
+#ifdef SVC_MEM_HOST
+#include "sim.h"
+#define SVC_MEM_VRAM_BASE ((const u8*)sim_phys(0x00200000))
+#else
+#define SVC_MEM_VRAM_BASE ((const u8*)0x00200000)
+#endif
+
+/*
+  IOReqs are kept per opened device and thread and reused. An IOReq
+  belongs to the thread that created it so a thread only ever takes
+  from its own pool, which is also what keeps the pool free of locks.
+  A pool grows when every IOReq it owns is checked out and is torn
+  down when svc_mem_close_device closes the last open of its device
+  in that thread. Devices opened some other way, used from another
+  thread, or more than SVC_MEM_POOL_MAX at once fall back to create /
+  delete per call.
+*/
+#define SVC_MEM_POOL_MAX 4
+
+typedef struct svc_mem_pool_s svc_mem_pool_t;
+struct svc_mem_pool_s
+{
+  Item  device;
+  Item  task;
+  i32   opens;
+  i32   created;
+  i32   nfree;
+  i32   cap;
+  Item *free;
+};
 
 static volatile Item g_SVC_MEM_DRIVER = 0;
+static svc_mem_pool_t g_SVC_MEM_POOLS[SVC_MEM_POOL_MAX];
 
 Err
 svc_mem_init(void)
@@ -43,15 +82,105 @@ svc_mem_destroy(void)
   return DeleteItem(g_SVC_MEM_DRIVER);
 }
 
+/*
+  A free slot has a device and task of 0.
+*/
+static
+svc_mem_pool_t*
+svc_mem_pool_find(Item device_,
+                  Item task_)
+{
+  i32 i;
+
+  for(i = 0; i < SVC_MEM_POOL_MAX; i++)
+    {
+      if((g_SVC_MEM_POOLS[i].device == device_) &&
+         (g_SVC_MEM_POOLS[i].task == task_))
+        return &g_SVC_MEM_POOLS[i];
+    }
+
+  return NULL;
+}
+
+static
+Err
+svc_mem_pool_grow(svc_mem_pool_t *pool_)
+{
+  i32   i;
+  i32   cap;
+  Item *items;
+
+  if(pool_->created < pool_->cap)
+    return 0;
+
+  cap   = ((pool_->cap == 0) ? 2 : (pool_->cap * 2));
+  items = (Item*)AllocMem(cap * sizeof(Item),MEMTYPE_ANY);
+  if(items == NULL)
+    return NOMEM;
+
+  for(i = 0; i < pool_->nfree; i++)
+    items[i] = pool_->free[i];
+  if(pool_->free != NULL)
+    FreeMem(pool_->free,pool_->cap * sizeof(Item));
+
+  pool_->free = items;
+  pool_->cap  = cap;
+
+  return 0;
+}
+
+static
+void
+svc_mem_pool_destroy(svc_mem_pool_t *pool_)
+{
+  i32 i;
+
+  for(i = 0; i < pool_->nfree; i++)
+    DeleteIOReq(pool_->free[i]);
+  if(pool_->free != NULL)
+    FreeMem(pool_->free,pool_->cap * sizeof(Item));
+
+  pool_->device  = 0;
+  pool_->task    = 0;
+  pool_->opens   = 0;
+  pool_->created = 0;
+  pool_->nfree   = 0;
+  pool_->cap     = 0;
+  pool_->free    = NULL;
+}
+
 Item
 svc_mem_open_device(void)
 {
-  return OpenNamedDevice("svc-mem-dev",0);
+  Item device;
+  svc_mem_pool_t *pool;
+
+  device = OpenNamedDevice("svc-mem-dev",0);
+  if(device < 0)
+    return device;
+
+  pool = svc_mem_pool_find(device,CURRENTTASK->t.n_Item);
+  if(pool == NULL)
+    pool = svc_mem_pool_find(0,0);
+  if(pool != NULL)
+    {
+      pool->device = device;
+      pool->task   = CURRENTTASK->t.n_Item;
+      pool->opens++;
+    }
+
+  return device;
 }
 
 Err
 svc_mem_close_device(Item device_)
 {
+  svc_mem_pool_t *pool;
+
+  pool = svc_mem_pool_find(device_,CURRENTTASK->t.n_Item);
+  if((pool != NULL) && (--pool->opens <= 0))
+    svc_mem_pool_destroy(pool);
+
   return CloseNamedDevice(device_);
 }
 
@@ -61,228 +190,610 @@ svc_mem_create_ioreq(Item device_)
   return CreateIOReq(NULL,0,device_,0);
 }
 
-Err
-svc_mem_r_u8_unit(Item  device_,
-                  u8    unit_,
-                  i32   offset_,
-                  u8   *dst_,
-                  i32   len_)
+Item
+svc_mem_ioreq_get(Item device_)
 {
-  Err rv;
+  Err err;
   Item ioreq;
-  IOInfo ioi = {0};
+  svc_mem_pool_t *pool;
+
+  pool = svc_mem_pool_find(device_,CURRENTTASK->t.n_Item);
+  if(pool == NULL)
+    return svc_mem_create_ioreq(device_);
+  if(pool->nfree > 0)
+    return pool->free[--pool->nfree];
+
+  err = svc_mem_pool_grow(pool);
+  if(err < 0)
+    return err;
 
   ioreq = svc_mem_create_ioreq(device_);
   if(ioreq < 0)
     return ioreq;
 
-  ioi.ioi_Command         = CMD_READ;
-  ioi.ioi_Unit            = unit_;
-  ioi.ioi_Offset          = offset_;
-  ioi.ioi_Recv.iob_Buffer = (void*)dst_;
-  ioi.ioi_Recv.iob_Len    = len_;
+  pool->created++;
 
-  rv = DoIO(ioreq,&ioi);
+  return ioreq;
+}
 
-  DeleteIOReq(ioreq);
+Err
+svc_mem_ioreq_put(Item device_,
+                  Item ioreq_)
+{
+  svc_mem_pool_t *pool;
 
-  return rv;
+  pool = svc_mem_pool_find(device_,CURRENTTASK->t.n_Item);
+  if((pool == NULL) || (pool->nfree >= pool->cap))
+    return DeleteIOReq(ioreq_);
+
+  pool->free[pool->nfree++] = ioreq_;
+
+  return 0;
 }
 
+static
 Err
-svc_mem_r_u32_unit(Item  device_,
-                   u8    unit_,
-                   i32   offset_,
-                   u32   *dst_,
-                   i32   len_)
+svc_mem_doio(Item          device_,
+             const IOInfo *ioi_)
 {
   Err rv;
   Item ioreq;
-  IOInfo ioi = {0};
 
-  ioreq = svc_mem_create_ioreq(device_);
+  ioreq = svc_mem_ioreq_get(device_);
   if(ioreq < 0)
     return ioreq;
 
+  rv = DoIO(ioreq,ioi_);
+
+  svc_mem_ioreq_put(device_,ioreq);
+
+  return rv;
+}
+
+Err
+svc_mem_ior_r_u8_unit(Item  ioreq_,
+                      u8    unit_,
+                      i32   offset_,
+                      u8   *dst_,
+                      i32   len_)
+{
+  IOInfo ioi = {0};
+
   ioi.ioi_Command         = CMD_READ;
-  ioi.ioi_CmdOptions     |= SVC_MEM_CMD_FLAG_WORDS;
   ioi.ioi_Unit            = unit_;
   ioi.ioi_Offset          = offset_;
   ioi.ioi_Recv.iob_Buffer = (void*)dst_;
   ioi.ioi_Recv.iob_Len    = len_;
 
-  rv = DoIO(ioreq,&ioi);
-
-  DeleteIOReq(ioreq);
-
-  return rv;
+  return DoIO(ioreq_,&ioi);
 }
 
 Err
-svc_mem_r_u8(Item  device_,
-             u8   *src_,
-             i32   offset_,
-             u8   *dst_,
-             i32   len_)
+svc_mem_ior_r_u32_unit(Item  ioreq_,
+                       u8    unit_,
+                       i32   offset_,
+                       u32  *dst_,
+                       i32   len_)
 {
-  Err rv;
-  Item ioreq;
   IOInfo ioi = {0};
 
-  ioreq = svc_mem_create_ioreq(device_);
-  if(ioreq < 0)
-    return ioreq;
-
   ioi.ioi_Command         = CMD_READ;
-  ioi.ioi_Unit            = SVC_MEM_UNIT_NONE;
+  ioi.ioi_CmdOptions     |= SVC_MEM_CMD_FLAG_WORDS;
+  ioi.ioi_Unit            = unit_;
   ioi.ioi_Offset          = offset_;
-  ioi.ioi_Send.iob_Buffer = (void*)src_;
   ioi.ioi_Recv.iob_Buffer = (void*)dst_;
   ioi.ioi_Recv.iob_Len    = len_;
 
-  rv = DoIO(ioreq,&ioi);
+  return DoIO(ioreq_,&ioi);
+}
 
-  DeleteIOReq(ioreq);
+Err
+svc_mem_ior_w_u8_unit(Item  ioreq_,
+                      u8   *src_,
+                      i32   len_,
+                      u8    unit_,
+                      i32   offset_)
+{
+  IOInfo ioi = {0};
 
-  return rv;
+  ioi.ioi_Command         = CMD_WRITE;
+  ioi.ioi_Send.iob_Buffer = src_;
+  ioi.ioi_Send.iob_Len    = len_;
+  ioi.ioi_Unit            = unit_;
+  ioi.ioi_Offset          = offset_;
+
+  return DoIO(ioreq_,&ioi);
 }
 
 Err
-svc_mem_r_u32(Item  device_,
-              u32  *src_,
-              i32   offset_,
-              u32  *dst_,
-              i32   len_)
+svc_mem_ior_w_u32_unit(Item  ioreq_,
+                       u32  *src_,
+                       i32   len_,
+                       u8    unit_,
+                       i32   offset_)
 {
-  Err rv;
-  Item ioreq;
   IOInfo ioi = {0};
 
-  ioreq = svc_mem_create_ioreq(device_);
+  ioi.ioi_Command         = CMD_WRITE;
+  ioi.ioi_CmdOptions     |= SVC_MEM_CMD_FLAG_WORDS;
+  ioi.ioi_Send.iob_Buffer = src_;
+  ioi.ioi_Send.iob_Len    = len_;
+  ioi.ioi_Unit            = unit_;
+  ioi.ioi_Offset          = offset_;
+
+  return DoIO(ioreq_,&ioi);
+}
+
+static
+Item
+svc_mem_sendio(Item          device_,
+               const IOInfo *ioi_)
+{
+  Err err;
+  Item ioreq;
+
+  ioreq = svc_mem_ioreq_get(device_);
   if(ioreq < 0)
     return ioreq;
 
+  err = SendIO(ioreq,ioi_);
+  if(err < 0)
+    {
+      svc_mem_ioreq_put(device_,ioreq);
+      return err;
+    }
+
+  return ioreq;
+}
+
+Item
+svc_mem_r_u8_unit_async(Item  device_,
+                        u8    unit_,
+                        i32   offset_,
+                        u8   *dst_,
+                        i32   len_)
+{
+  IOInfo ioi = {0};
+
+  ioi.ioi_Command         = CMD_READ;
+  ioi.ioi_Unit            = unit_;
+  ioi.ioi_Offset          = offset_;
+  ioi.ioi_Recv.iob_Buffer = (void*)dst_;
+  ioi.ioi_Recv.iob_Len    = len_;
+
+  return svc_mem_sendio(device_,&ioi);
+}
+
+Item
+svc_mem_r_u32_unit_async(Item  device_,
+                         u8    unit_,
+                         i32   offset_,
+                         u32  *dst_,
+                         i32   len_)
+{
+  IOInfo ioi = {0};
+
   ioi.ioi_Command         = CMD_READ;
   ioi.ioi_CmdOptions     |= SVC_MEM_CMD_FLAG_WORDS;
-  ioi.ioi_Unit            = SVC_MEM_UNIT_NONE;
+  ioi.ioi_Unit            = unit_;
   ioi.ioi_Offset          = offset_;
-  ioi.ioi_Send.iob_Buffer = (void*)src_;
   ioi.ioi_Recv.iob_Buffer = (void*)dst_;
   ioi.ioi_Recv.iob_Len    = len_;
 
-  rv = DoIO(ioreq,&ioi);
+  return svc_mem_sendio(device_,&ioi);
+}
 
-  DeleteIOReq(ioreq);
+Item
+svc_mem_w_u8_unit_async(Item  device_,
+                        u8   *src_,
+                        i32   len_,
+                        u8    unit_,
+                        i32   offset_)
+{
+  IOInfo ioi = {0};
 
-  return rv;
+  ioi.ioi_Command         = CMD_WRITE;
+  ioi.ioi_Send.iob_Buffer = src_;
+  ioi.ioi_Send.iob_Len    = len_;
+  ioi.ioi_Unit            = unit_;
+  ioi.ioi_Offset          = offset_;
+
+  return svc_mem_sendio(device_,&ioi);
 }
 
-Err
-svc_mem_r_u8_dram(Item  device_,
-                  i32   offset_,
-                  u8   *dst_,
-                  i32   len_)
+Item
+svc_mem_w_u32_unit_async(Item  device_,
+                         u32  *src_,
+                         i32   len_,
+                         u8    unit_,
+                         i32   offset_)
 {
-  return svc_mem_r_u8_unit(device_,
-                           SVC_MEM_UNIT_DRAM,
-                           offset_,
-                           dst_,
-                           len_);
+  IOInfo ioi = {0};
+
+  ioi.ioi_Command         = CMD_WRITE;
+  ioi.ioi_CmdOptions     |= SVC_MEM_CMD_FLAG_WORDS;
+  ioi.ioi_Send.iob_Buffer = src_;
+  ioi.ioi_Send.iob_Len    = len_;
+  ioi.ioi_Unit            = unit_;
+  ioi.ioi_Offset          = offset_;
+
+  return svc_mem_sendio(device_,&ioi);
 }
 
-Err
-svc_mem_r_u32_dram(Item  device_,
-                   i32   offset_,
-                   u32  *dst_,
-                   i32   len_)
+Item
+svc_mem_r_u8_dram_async(Item  device_,
+                        i32   offset_,
+                        u8   *dst_,
+                        i32   len_)
 {
-  return svc_mem_r_u32_unit(device_,
-                            SVC_MEM_UNIT_DRAM,
-                            offset_,
-                            dst_,
-                            len_);
+  return svc_mem_r_u8_unit_async(device_,
+                                 SVC_MEM_UNIT_DRAM,
+                                 offset_,
+                                 dst_,
+                                 len_);
 }
 
-Err
-svc_mem_r_u8_vram(Item  device_,
-                  i32   offset_,
-                  u8   *dst_,
-                  i32   len_)
+Item
+svc_mem_r_u32_dram_async(Item  device_,
+                         i32   offset_,
+                         u32  *dst_,
+                         i32   len_)
 {
-  return svc_mem_r_u8_unit(device_,
-                           SVC_MEM_UNIT_VRAM,
-                           offset_,
-                           dst_,
-                           len_);
+  return svc_mem_r_u32_unit_async(device_,
+                                  SVC_MEM_UNIT_DRAM,
+                                  offset_,
+                                  dst_,
+                                  len_);
 }
 
-Err
-svc_mem_r_u32_vram(Item  device_,
-                   i32   offset_,
-                   u32  *dst_,
-                   i32   len_)
+Item
+svc_mem_r_u8_vram_async(Item  device_,
+                        i32   offset_,
+                        u8   *dst_,
+                        i32   len_)
 {
-  return svc_mem_r_u32_unit(device_,
-                            SVC_MEM_UNIT_VRAM,
-                            offset_,
-                            dst_,
-                            len_);
+  return svc_mem_r_u8_unit_async(device_,
+                                 SVC_MEM_UNIT_VRAM,
+                                 offset_,
+                                 dst_,
+                                 len_);
 }
 
-Err
-svc_mem_r_u8_rom1(Item  device_,
-                  i32   offset_,
-                  u8   *dst_,
-                  i32   len_)
+Item
+svc_mem_r_u32_vram_async(Item  device_,
+                         i32   offset_,
+                         u32  *dst_,
+                         i32   len_)
 {
-  return svc_mem_r_u8_unit(device_,
-                           SVC_MEM_UNIT_ROM1,
-                           offset_,
-                           dst_,
-                           len_);
+  return svc_mem_r_u32_unit_async(device_,
+                                  SVC_MEM_UNIT_VRAM,
+                                  offset_,
+                                  dst_,
+                                  len_);
 }
 
-Err
-svc_mem_r_u32_rom1(Item  device_,
-                   i32   offset_,
-                   u32   *dst_,
-                   i32   len_)
+Item
+svc_mem_r_u8_rom1_async(Item  device_,
+                        i32   offset_,
+                        u8   *dst_,
+                        i32   len_)
 {
-  return svc_mem_r_u32_unit(device_,
-                            SVC_MEM_UNIT_ROM1,
-                            offset_,
-                            dst_,
-                            len_);
+  return svc_mem_r_u8_unit_async(device_,
+                                 SVC_MEM_UNIT_ROM1,
+                                 offset_,
+                                 dst_,
+                                 len_);
 }
 
-Err
-svc_mem_r_u8_rom2(Item  device_,
-                  i32   offset_,
-                  u8   *dst_,
-                  i32   len_)
+Item
+svc_mem_r_u32_rom1_async(Item  device_,
+                         i32   offset_,
+                         u32  *dst_,
+                         i32   len_)
 {
-  return svc_mem_r_u8_unit(device_,
-                           SVC_MEM_UNIT_ROM2,
-                           offset_,
-                           dst_,
-                           len_);
+  return svc_mem_r_u32_unit_async(device_,
+                                  SVC_MEM_UNIT_ROM1,
+                                  offset_,
+                                  dst_,
+                                  len_);
 }
 
-Err
-svc_mem_r_u32_rom2(Item  device_,
-                   i32   offset_,
-                   u32   *dst_,
-                   i32   len_)
+Item
+svc_mem_r_u8_rom2_async(Item  device_,
+                        i32   offset_,
+                        u8   *dst_,
+                        i32   len_)
 {
-  return svc_mem_r_u32_unit(device_,
-                            SVC_MEM_UNIT_ROM2,
-                            offset_,
-                            dst_,
-                            len_);
+  return svc_mem_r_u8_unit_async(device_,
+                                 SVC_MEM_UNIT_ROM2,
+                                 offset_,
+                                 dst_,
+                                 len_);
 }
 
-Err
-svc_mem_r_u8_nvram(Item  device_,
+Item
+svc_mem_r_u32_rom2_async(Item  device_,
+                         i32   offset_,
+                         u32  *dst_,
+                         i32   len_)
+{
+  return svc_mem_r_u32_unit_async(device_,
+                                  SVC_MEM_UNIT_ROM2,
+                                  offset_,
+                                  dst_,
+                                  len_);
+}
+
+i32
+svc_mem_io_poll(Item ioreq_)
+{
+  return CheckIO(ioreq_);
+}
+
+Err
+svc_mem_io_abort(Item ioreq_)
+{
+  return AbortIO(ioreq_);
+}
+
+Err
+svc_mem_io_wait(Item  device_,
+                Item  ioreq_,
+                i32  *bytes_)
+{
+  Err rv;
+  IOReq *ior;
+
+  rv = WaitIO(ioreq_);
+
+  if(bytes_ != NULL)
+    {
+      ior = (IOReq*)LookupItem(ioreq_);
+      *bytes_ = ior->io_Actual;
+      if(ior->io_Info.ioi_CmdOptions & SVC_MEM_CMD_FLAG_WORDS)
+        *bytes_ *= sizeof(u32);
+    }
+
+  svc_mem_ioreq_put(device_,ioreq_);
+
+  return rv;
+}
+
+Err
+svc_mem_r_u8_unit(Item  device_,
+                  u8    unit_,
+                  i32   offset_,
+                  u8   *dst_,
+                  i32   len_)
+{
+  Err rv;
+  Item ioreq;
+
+  ioreq = svc_mem_ioreq_get(device_);
+  if(ioreq < 0)
+    return ioreq;
+
+  rv = svc_mem_ior_r_u8_unit(ioreq,unit_,offset_,dst_,len_);
+
+  svc_mem_ioreq_put(device_,ioreq);
+
+  return rv;
+}
+
+Err
+svc_mem_r_u32_unit(Item  device_,
+                   u8    unit_,
+                   i32   offset_,
+                   u32   *dst_,
+                   i32   len_)
+{
+  Err rv;
+  Item ioreq;
+
+  ioreq = svc_mem_ioreq_get(device_);
+  if(ioreq < 0)
+    return ioreq;
+
+  rv = svc_mem_ior_r_u32_unit(ioreq,unit_,offset_,dst_,len_);
+
+  svc_mem_ioreq_put(device_,ioreq);
+
+  return rv;
+}
+
+Err
+svc_mem_r_u8(Item  device_,
+             u8   *src_,
+             i32   offset_,
+             u8   *dst_,
+             i32   len_)
+{
+  IOInfo ioi = {0};
+
+  ioi.ioi_Command         = CMD_READ;
+  ioi.ioi_Unit            = SVC_MEM_UNIT_NONE;
+  ioi.ioi_Offset          = offset_;
+  ioi.ioi_Send.iob_Buffer = (void*)src_;
+  ioi.ioi_Recv.iob_Buffer = (void*)dst_;
+  ioi.ioi_Recv.iob_Len    = len_;
+
+  return svc_mem_doio(device_,&ioi);
+}
+
+Err
+svc_mem_r_u32(Item  device_,
+              u32  *src_,
+              i32   offset_,
+              u32  *dst_,
+              i32   len_)
+{
+  IOInfo ioi = {0};
+
+  ioi.ioi_Command         = CMD_READ;
+  ioi.ioi_CmdOptions     |= SVC_MEM_CMD_FLAG_WORDS;
+  ioi.ioi_Unit            = SVC_MEM_UNIT_NONE;
+  ioi.ioi_Offset          = offset_;
+  ioi.ioi_Send.iob_Buffer = (void*)src_;
+  ioi.ioi_Recv.iob_Buffer = (void*)dst_;
+  ioi.ioi_Recv.iob_Len    = len_;
+
+  return svc_mem_doio(device_,&ioi);
+}
+
+Err
+svc_mem_r_u8_faultmap(Item  device_,
+                      u8    unit_,
+                      i32   offset_,
+                      u8   *dst_,
+                      i32   len_,
+                      u8    pattern_,
+                      u32  *map_)
+{
+  IOInfo ioi = {0};
+
+  ioi.ioi_Command         = CMD_READ;
+  ioi.ioi_CmdOptions     |= SVC_MEM_CMD_FLAG_FAULTMAP;
+  ioi.ioi_Unit            = unit_;
+  ioi.ioi_Offset          = offset_;
+  ioi.ioi_User            = pattern_;
+  ioi.ioi_Send.iob_Buffer = map_;
+  ioi.ioi_Send.iob_Len    = SVC_MEM_FAULTMAP_WORDS(len_);
+  ioi.ioi_Recv.iob_Buffer = (void*)dst_;
+  ioi.ioi_Recv.iob_Len    = len_;
+
+  return svc_mem_doio(device_,&ioi);
+}
+
+Err
+svc_mem_r_u32_faultmap(Item  device_,
+                       u8    unit_,
+                       i32   offset_,
+                       u32  *dst_,
+                       i32   len_,
+                       u32   pattern_,
+                       u32  *map_)
+{
+  IOInfo ioi = {0};
+
+  ioi.ioi_Command         = CMD_READ;
+  ioi.ioi_CmdOptions     |= (SVC_MEM_CMD_FLAG_WORDS|SVC_MEM_CMD_FLAG_FAULTMAP);
+  ioi.ioi_Unit            = unit_;
+  ioi.ioi_Offset          = offset_;
+  ioi.ioi_User            = pattern_;
+  ioi.ioi_Send.iob_Buffer = map_;
+  ioi.ioi_Send.iob_Len    = SVC_MEM_FAULTMAP_WORDS(len_);
+  ioi.ioi_Recv.iob_Buffer = (void*)dst_;
+  ioi.ioi_Recv.iob_Len    = len_;
+
+  return svc_mem_doio(device_,&ioi);
+}
+
+Err
+svc_mem_r_u8_dram(Item  device_,
+                  i32   offset_,
+                  u8   *dst_,
+                  i32   len_)
+{
+  return svc_mem_r_u8_unit(device_,
+                           SVC_MEM_UNIT_DRAM,
+                           offset_,
+                           dst_,
+                           len_);
+}
+
+Err
+svc_mem_r_u32_dram(Item  device_,
+                   i32   offset_,
+                   u32  *dst_,
+                   i32   len_)
+{
+  return svc_mem_r_u32_unit(device_,
+                            SVC_MEM_UNIT_DRAM,
+                            offset_,
+                            dst_,
+                            len_);
+}
+
+Err
+svc_mem_r_u8_vram(Item  device_,
+                  i32   offset_,
+                  u8   *dst_,
+                  i32   len_)
+{
+  return svc_mem_r_u8_unit(device_,
+                           SVC_MEM_UNIT_VRAM,
+                           offset_,
+                           dst_,
+                           len_);
+}
+
+Err
+svc_mem_r_u32_vram(Item  device_,
+                   i32   offset_,
+                   u32  *dst_,
+                   i32   len_)
+{
+  return svc_mem_r_u32_unit(device_,
+                            SVC_MEM_UNIT_VRAM,
+                            offset_,
+                            dst_,
+                            len_);
+}
+
+Err
+svc_mem_r_u8_rom1(Item  device_,
+                  i32   offset_,
+                  u8   *dst_,
+                  i32   len_)
+{
+  return svc_mem_r_u8_unit(device_,
+                           SVC_MEM_UNIT_ROM1,
+                           offset_,
+                           dst_,
+                           len_);
+}
+
+Err
+svc_mem_r_u32_rom1(Item  device_,
+                   i32   offset_,
+                   u32   *dst_,
+                   i32   len_)
+{
+  return svc_mem_r_u32_unit(device_,
+                            SVC_MEM_UNIT_ROM1,
+                            offset_,
+                            dst_,
+                            len_);
+}
+
+Err
+svc_mem_r_u8_rom2(Item  device_,
+                  i32   offset_,
+                  u8   *dst_,
+                  i32   len_)
+{
+  return svc_mem_r_u8_unit(device_,
+                           SVC_MEM_UNIT_ROM2,
+                           offset_,
+                           dst_,
+                           len_);
+}
+
+Err
+svc_mem_r_u32_rom2(Item  device_,
+                   i32   offset_,
+                   u32   *dst_,
+                   i32   len_)
+{
+  return svc_mem_r_u32_unit(device_,
+                            SVC_MEM_UNIT_ROM2,
+                            offset_,
+                            dst_,
+                            len_);
+}
+
+Err
+svc_mem_r_u8_nvram(Item  device_,
                 i32   offset_,
                 u8   *dst_,
                 i32   len_)
@@ -341,14 +852,8 @@ svc_mem_w_u8(Item  device_,
              u8   *dst_,
              i32   offset_)
 {
-  Err rv;
-  Item ioreq;
   IOInfo ioi = {0};
 
-  ioreq = svc_mem_create_ioreq(device_);
-  if(ioreq < 0)
-    return ioreq;
-
   ioi.ioi_Command         = CMD_WRITE;
   ioi.ioi_Unit            = SVC_MEM_UNIT_NONE;
   ioi.ioi_Send.iob_Buffer = src_;
@@ -356,11 +861,7 @@ svc_mem_w_u8(Item  device_,
   ioi.ioi_Recv.iob_Buffer = dst_;
   ioi.ioi_Offset          = offset_;
 
-  rv = DoIO(ioreq,&ioi);
-
-  DeleteIOReq(ioreq);
-
-  return rv;
+  return svc_mem_doio(device_,&ioi);
 }
 
 Err
@@ -370,14 +871,8 @@ svc_mem_w_u32(Item  device_,
               u32  *dst_,
               i32   offset_)
 {
-  Err rv;
-  Item ioreq;
   IOInfo ioi = {0};
 
-  ioreq = svc_mem_create_ioreq(device_);
-  if(ioreq < 0)
-    return ioreq;
-
   ioi.ioi_Command         = CMD_WRITE;
   ioi.ioi_CmdOptions     |= SVC_MEM_CMD_FLAG_WORDS;
   ioi.ioi_Unit            = SVC_MEM_UNIT_NONE;
@@ -386,11 +881,7 @@ svc_mem_w_u32(Item  device_,
   ioi.ioi_Recv.iob_Buffer = dst_;
   ioi.ioi_Offset          = offset_;
 
-  rv = DoIO(ioreq,&ioi);
-
-  DeleteIOReq(ioreq);
-
-  return rv;
+  return svc_mem_doio(device_,&ioi);
 }
 
 Err
@@ -411,21 +902,14 @@ svc_mem_w_u8_unit(Item  device_,
 {
   Err rv;
   Item ioreq;
-  IOInfo ioi = {0};
 
-  ioreq = svc_mem_create_ioreq(device_);
+  ioreq = svc_mem_ioreq_get(device_);
   if(ioreq < 0)
     return ioreq;
 
-  ioi.ioi_Command         = CMD_WRITE;
-  ioi.ioi_Send.iob_Buffer = src_;
-  ioi.ioi_Send.iob_Len    = len_;
-  ioi.ioi_Unit            = unit_;
-  ioi.ioi_Offset          = offset_;
-
-  rv = DoIO(ioreq,&ioi);
+  rv = svc_mem_ior_w_u8_unit(ioreq,src_,len_,unit_,offset_);
 
-  DeleteIOReq(ioreq);
+  svc_mem_ioreq_put(device_,ioreq);
 
   return rv;
 }
@@ -439,22 +923,14 @@ svc_mem_w_u32_unit(Item  device_,
 {
   Err rv;
   Item ioreq;
-  IOInfo ioi = {0};
 
-  ioreq = svc_mem_create_ioreq(device_);
+  ioreq = svc_mem_ioreq_get(device_);
   if(ioreq < 0)
     return ioreq;
 
-  ioi.ioi_Command         = CMD_WRITE;
-  ioi.ioi_CmdOptions     |= SVC_MEM_CMD_FLAG_WORDS;
-  ioi.ioi_Send.iob_Buffer = src_;
-  ioi.ioi_Send.iob_Len    = len_;
-  ioi.ioi_Unit            = unit_;
-  ioi.ioi_Offset          = offset_;
-
-  rv = DoIO(ioreq,&ioi);
+  rv = svc_mem_ior_w_u32_unit(ioreq,src_,len_,unit_,offset_);
 
-  DeleteIOReq(ioreq);
+  svc_mem_ioreq_put(device_,ioreq);
 
   return rv;
 }
@@ -562,3 +1038,1009 @@ svc_mem_w_u32_sport(Item  device_,
                             SVC_MEM_UNIT_SPORT,
                             offset_);
 }
+
+void
+svc_mem_batch_init(svc_mem_batch_t       *batch_,
+                   svc_mem_batch_entry_t *entries_,
+                   Err                   *errors_,
+                   i32                    max_)
+{
+  batch_->entries = entries_;
+  batch_->errors  = errors_;
+  batch_->count   = 0;
+  batch_->max     = max_;
+  batch_->options = 0;
+}
+
+void
+svc_mem_batch_reset(svc_mem_batch_t *batch_)
+{
+  batch_->count = 0;
+}
+
+static
+Err
+svc_mem_batch_add(svc_mem_batch_t *batch_,
+                  u8               op_,
+                  u8               unit_,
+                  u8               width_,
+                  i32              offset_,
+                  void            *buffer_,
+                  i32              count_)
+{
+  svc_mem_batch_entry_t *ent;
+
+  if(batch_->count >= batch_->max)
+    return NOMEM;
+
+  ent = &batch_->entries[batch_->count++];
+
+  ent->op       = op_;
+  ent->unit     = unit_;
+  ent->width    = width_;
+  ent->reserved = 0;
+  ent->offset   = offset_;
+  ent->count    = count_;
+  ent->buffer   = buffer_;
+
+  return 0;
+}
+
+Err
+svc_mem_batch_r_u8(svc_mem_batch_t *batch_,
+                   u8               unit_,
+                   i32              offset_,
+                   u8              *dst_,
+                   i32              len_)
+{
+  return svc_mem_batch_add(batch_,
+                           SVC_MEM_BATCH_OP_READ,
+                           unit_,
+                           sizeof(u8),
+                           offset_,
+                           dst_,
+                           len_);
+}
+
+Err
+svc_mem_batch_r_u32(svc_mem_batch_t *batch_,
+                    u8               unit_,
+                    i32              offset_,
+                    u32             *dst_,
+                    i32              len_)
+{
+  return svc_mem_batch_add(batch_,
+                           SVC_MEM_BATCH_OP_READ,
+                           unit_,
+                           sizeof(u32),
+                           offset_,
+                           dst_,
+                           len_);
+}
+
+Err
+svc_mem_batch_w_u8(svc_mem_batch_t *batch_,
+                   u8              *src_,
+                   i32              len_,
+                   u8               unit_,
+                   i32              offset_)
+{
+  return svc_mem_batch_add(batch_,
+                           SVC_MEM_BATCH_OP_WRITE,
+                           unit_,
+                           sizeof(u8),
+                           offset_,
+                           src_,
+                           len_);
+}
+
+Err
+svc_mem_batch_w_u32(svc_mem_batch_t *batch_,
+                    u32             *src_,
+                    i32              len_,
+                    u8               unit_,
+                    i32              offset_)
+{
+  return svc_mem_batch_add(batch_,
+                           SVC_MEM_BATCH_OP_WRITE,
+                           unit_,
+                           sizeof(u32),
+                           offset_,
+                           src_,
+                           len_);
+}
+
+Err
+svc_mem_batch_exec(Item             device_,
+                   svc_mem_batch_t *batch_,
+                   i32              first_,
+                   i32             *done_)
+{
+  Err rv;
+  Item ioreq;
+  IOReq *ior;
+  IOInfo ioi = {0};
+
+  if((first_ < 0) || (first_ > batch_->count))
+    return BADPTR;
+
+  ioreq = svc_mem_ioreq_get(device_);
+  if(ioreq < 0)
+    return ioreq;
+
+  ioi.ioi_Command         = SVC_MEM_CMD_BATCH;
+  ioi.ioi_CmdOptions      = batch_->options;
+  ioi.ioi_Send.iob_Buffer = &batch_->entries[first_];
+  ioi.ioi_Send.iob_Len    = (batch_->count - first_);
+  if(batch_->errors != NULL)
+    {
+      ioi.ioi_Recv.iob_Buffer = &batch_->errors[first_];
+      ioi.ioi_Recv.iob_Len    = (batch_->count - first_);
+    }
+
+  rv = DoIO(ioreq,&ioi);
+
+  if(done_ != NULL)
+    {
+      ior = (IOReq*)LookupItem(ioreq);
+      *done_ = (first_ + ior->io_Actual);
+    }
+
+  svc_mem_ioreq_put(device_,ioreq);
+
+  return rv;
+}
+
+Err
+svc_mem_config_get(Item              device_,
+                   svc_mem_config_t *cfg_)
+{
+  IOInfo ioi = {0};
+
+  ioi.ioi_Command         = SVC_MEM_CMD_CONFIG;
+  ioi.ioi_Recv.iob_Buffer = cfg_;
+  ioi.ioi_Recv.iob_Len    = sizeof(svc_mem_config_t);
+
+  return svc_mem_doio(device_,&ioi);
+}
+
+Err
+svc_mem_config_set(Item                    device_,
+                   const svc_mem_config_t *cfg_)
+{
+  IOInfo ioi = {0};
+
+  ioi.ioi_Command         = SVC_MEM_CMD_CONFIG;
+  ioi.ioi_Send.iob_Buffer = (void*)cfg_;
+  ioi.ioi_Send.iob_Len    = sizeof(svc_mem_config_t);
+
+  return svc_mem_doio(device_,&ioi);
+}
+
+Err
+svc_mem_stats_get(Item             device_,
+                  svc_mem_stats_t *stats_)
+{
+  IOInfo ioi = {0};
+
+  ioi.ioi_Command         = CMD_STATUS;
+  ioi.ioi_Recv.iob_Buffer = stats_;
+  ioi.ioi_Recv.iob_Len    = sizeof(svc_mem_stats_t);
+
+  return svc_mem_doio(device_,&ioi);
+}
+
+Err
+svc_mem_stats_reset(Item device_)
+{
+  IOInfo ioi = {0};
+
+  ioi.ioi_Command = SVC_MEM_CMD_STATS_RESET;
+
+  return svc_mem_doio(device_,&ioi);
+}
+
+static
+Err
+svc_mem_fill(Item  device_,
+             u8    unit_,
+             u32   options_,
+             void *dst_,
+             i32   offset_,
+             u32   pattern_,
+             i32   len_)
+{
+  IOInfo ioi = {0};
+
+  ioi.ioi_Command         = SVC_MEM_CMD_FILL;
+  ioi.ioi_CmdOptions      = options_;
+  ioi.ioi_Unit            = unit_;
+  ioi.ioi_Offset          = offset_;
+  ioi.ioi_User            = pattern_;
+  ioi.ioi_Recv.iob_Buffer = dst_;
+  ioi.ioi_Recv.iob_Len    = len_;
+
+  return svc_mem_doio(device_,&ioi);
+}
+
+Err
+svc_mem_fill_u8(Item  device_,
+                u8   *dst_,
+                i32   offset_,
+                u8    pattern_,
+                i32   len_)
+{
+  return svc_mem_fill(device_,SVC_MEM_UNIT_NONE,0,dst_,offset_,pattern_,len_);
+}
+
+Err
+svc_mem_fill_u16(Item  device_,
+                 u16  *dst_,
+                 i32   offset_,
+                 u16   pattern_,
+                 i32   len_)
+{
+  return svc_mem_fill(device_,SVC_MEM_UNIT_NONE,SVC_MEM_CMD_FLAG_HALFWORDS,dst_,offset_,pattern_,len_);
+}
+
+Err
+svc_mem_fill_u32(Item  device_,
+                 u32  *dst_,
+                 i32   offset_,
+                 u32   pattern_,
+                 i32   len_)
+{
+  return svc_mem_fill(device_,SVC_MEM_UNIT_NONE,SVC_MEM_CMD_FLAG_WORDS,dst_,offset_,pattern_,len_);
+}
+
+Err
+svc_mem_fill_u8_unit(Item device_,
+                     u8   unit_,
+                     i32  offset_,
+                     u8   pattern_,
+                     i32  len_)
+{
+  return svc_mem_fill(device_,unit_,0,NULL,offset_,pattern_,len_);
+}
+
+Err
+svc_mem_fill_u16_unit(Item device_,
+                      u8   unit_,
+                      i32  offset_,
+                      u16  pattern_,
+                      i32  len_)
+{
+  return svc_mem_fill(device_,unit_,SVC_MEM_CMD_FLAG_HALFWORDS,NULL,offset_,pattern_,len_);
+}
+
+Err
+svc_mem_fill_u32_unit(Item device_,
+                      u8   unit_,
+                      i32  offset_,
+                      u32  pattern_,
+                      i32  len_)
+{
+  return svc_mem_fill(device_,unit_,SVC_MEM_CMD_FLAG_WORDS,NULL,offset_,pattern_,len_);
+}
+
+Err
+svc_mem_fill_u8_dram(Item device_,
+                     i32  offset_,
+                     u8   pattern_,
+                     i32  len_)
+{
+  return svc_mem_fill_u8_unit(device_,SVC_MEM_UNIT_DRAM,offset_,pattern_,len_);
+}
+
+Err
+svc_mem_fill_u16_dram(Item device_,
+                      i32  offset_,
+                      u16  pattern_,
+                      i32  len_)
+{
+  return svc_mem_fill_u16_unit(device_,SVC_MEM_UNIT_DRAM,offset_,pattern_,len_);
+}
+
+Err
+svc_mem_fill_u32_dram(Item device_,
+                      i32  offset_,
+                      u32  pattern_,
+                      i32  len_)
+{
+  return svc_mem_fill_u32_unit(device_,SVC_MEM_UNIT_DRAM,offset_,pattern_,len_);
+}
+
+Err
+svc_mem_fill_u8_vram(Item device_,
+                     i32  offset_,
+                     u8   pattern_,
+                     i32  len_)
+{
+  return svc_mem_fill_u8_unit(device_,SVC_MEM_UNIT_VRAM,offset_,pattern_,len_);
+}
+
+Err
+svc_mem_fill_u16_vram(Item device_,
+                      i32  offset_,
+                      u16  pattern_,
+                      i32  len_)
+{
+  return svc_mem_fill_u16_unit(device_,SVC_MEM_UNIT_VRAM,offset_,pattern_,len_);
+}
+
+Err
+svc_mem_fill_u32_vram(Item device_,
+                      i32  offset_,
+                      u32  pattern_,
+                      i32  len_)
+{
+  return svc_mem_fill_u32_unit(device_,SVC_MEM_UNIT_VRAM,offset_,pattern_,len_);
+}
+
+static
+Err
+svc_mem_copy(Item device_,
+             u32  options_,
+             u8   src_unit_,
+             i32  src_offset_,
+             u8   dst_unit_,
+             i32  dst_offset_,
+             i32  len_)
+{
+  IOInfo ioi = {0};
+
+  ioi.ioi_Command      = SVC_MEM_CMD_COPY;
+  ioi.ioi_CmdOptions   = (options_ | SVC_MEM_CMD_COPY_SRC(src_unit_));
+  ioi.ioi_User         = src_offset_;
+  ioi.ioi_Unit         = dst_unit_;
+  ioi.ioi_Offset       = dst_offset_;
+  ioi.ioi_Send.iob_Len = len_;
+
+  return svc_mem_doio(device_,&ioi);
+}
+
+Err
+svc_mem_copy_u8(Item device_,
+                u8   src_unit_,
+                i32  src_offset_,
+                u8   dst_unit_,
+                i32  dst_offset_,
+                i32  len_)
+{
+  return svc_mem_copy(device_,0,src_unit_,src_offset_,dst_unit_,dst_offset_,len_);
+}
+
+Err
+svc_mem_copy_u32(Item device_,
+                 u8   src_unit_,
+                 i32  src_offset_,
+                 u8   dst_unit_,
+                 i32  dst_offset_,
+                 i32  len_)
+{
+  return svc_mem_copy(device_,SVC_MEM_CMD_FLAG_WORDS,src_unit_,src_offset_,dst_unit_,dst_offset_,len_);
+}
+
+static
+Err
+svc_mem_checksum(Item  device_,
+                 u32   options_,
+                 u8    unit_,
+                 i32   offset_,
+                 i32   len_,
+                 u8    algo_,
+                 u32  *digest_)
+{
+  IOInfo ioi = {0};
+
+  ioi.ioi_Command         = SVC_MEM_CMD_CHECKSUM;
+  ioi.ioi_CmdOptions      = (options_ | SVC_MEM_CMD_CHECKSUM_ALGO(algo_));
+  ioi.ioi_User            = *digest_;
+  ioi.ioi_Unit            = unit_;
+  ioi.ioi_Offset          = offset_;
+  ioi.ioi_Send.iob_Len    = len_;
+  ioi.ioi_Recv.iob_Buffer = digest_;
+  ioi.ioi_Recv.iob_Len    = sizeof(u32);
+
+  return svc_mem_doio(device_,&ioi);
+}
+
+Err
+svc_mem_checksum_u8(Item  device_,
+                    u8    unit_,
+                    i32   offset_,
+                    i32   len_,
+                    u8    algo_,
+                    u32  *digest_)
+{
+  return svc_mem_checksum(device_,0,unit_,offset_,len_,algo_,digest_);
+}
+
+Err
+svc_mem_checksum_u32(Item  device_,
+                     u8    unit_,
+                     i32   offset_,
+                     i32   len_,
+                     u8    algo_,
+                     u32  *digest_)
+{
+  return svc_mem_checksum(device_,SVC_MEM_CMD_FLAG_WORDS,unit_,offset_,len_,algo_,digest_);
+}
+
+static
+Err
+svc_mem_search(Item        device_,
+               u32         options_,
+               u8          unit_,
+               i32         offset_,
+               i32         len_,
+               const void *pattern_,
+               const void *mask_,
+               i32         pattern_len_,
+               i32        *hits_,
+               i32         max_,
+               i32        *nhits_)
+{
+  Err rv;
+  IOInfo ioi = {0};
+  svc_mem_search_t desc;
+
+  desc.pattern     = pattern_;
+  desc.mask        = mask_;
+  desc.pattern_len = pattern_len_;
+  desc.len         = len_;
+  desc.src         = NULL;
+  desc.hits        = 0;
+
+  ioi.ioi_Command         = SVC_MEM_CMD_SEARCH;
+  ioi.ioi_CmdOptions      = options_;
+  ioi.ioi_Unit            = unit_;
+  ioi.ioi_Offset          = offset_;
+  ioi.ioi_Send.iob_Buffer = &desc;
+  ioi.ioi_Send.iob_Len    = sizeof(desc);
+  ioi.ioi_Recv.iob_Buffer = hits_;
+  ioi.ioi_Recv.iob_Len    = max_;
+
+  rv = svc_mem_doio(device_,&ioi);
+  if(nhits_ != NULL)
+    *nhits_ = desc.hits;
+
+  return rv;
+}
+
+Err
+svc_mem_search_u8(Item      device_,
+                  u8        unit_,
+                  i32       offset_,
+                  i32       len_,
+                  const u8 *pattern_,
+                  const u8 *mask_,
+                  i32       pattern_len_,
+                  i32      *hits_,
+                  i32       max_,
+                  i32      *nhits_)
+{
+  return svc_mem_search(device_,0,unit_,offset_,len_,
+                        pattern_,mask_,pattern_len_,
+                        hits_,max_,nhits_);
+}
+
+Err
+svc_mem_search_u32(Item       device_,
+                   u8         unit_,
+                   i32        offset_,
+                   i32        len_,
+                   const u32 *pattern_,
+                   const u32 *mask_,
+                   i32        pattern_len_,
+                   i32       *hits_,
+                   i32        max_,
+                   i32       *nhits_)
+{
+  return svc_mem_search(device_,SVC_MEM_CMD_FLAG_WORDS,unit_,offset_,len_,
+                        pattern_,mask_,pattern_len_,
+                        hits_,max_,nhits_);
+}
+
+static
+Err
+svc_mem_diff(Item                device_,
+             u32                 options_,
+             u8                  unit_,
+             i32                 offset_,
+             i32                 len_,
+             const void         *ref_,
+             svc_mem_diff_run_t *runs_,
+             i32                 max_,
+             i32                *nruns_,
+             i32                *overflow_)
+{
+  Err rv;
+  IOInfo ioi = {0};
+  svc_mem_diff_t desc;
+
+  desc.ref      = ref_;
+  desc.len      = len_;
+  desc.src      = NULL;
+  desc.runs     = 0;
+  desc.overflow = 0;
+
+  ioi.ioi_Command         = SVC_MEM_CMD_DIFF;
+  ioi.ioi_CmdOptions      = options_;
+  ioi.ioi_Unit            = unit_;
+  ioi.ioi_Offset          = offset_;
+  ioi.ioi_Send.iob_Buffer = &desc;
+  ioi.ioi_Send.iob_Len    = sizeof(desc);
+  ioi.ioi_Recv.iob_Buffer = runs_;
+  ioi.ioi_Recv.iob_Len    = max_;
+
+  rv = svc_mem_doio(device_,&ioi);
+  if(nruns_ != NULL)
+    *nruns_ = desc.runs;
+  if(overflow_ != NULL)
+    *overflow_ = desc.overflow;
+
+  return rv;
+}
+
+Err
+svc_mem_diff_u8(Item                device_,
+                u8                  unit_,
+                i32                 offset_,
+                i32                 len_,
+                const u8           *ref_,
+                svc_mem_diff_run_t *runs_,
+                i32                 max_,
+                i32                *nruns_,
+                i32                *overflow_)
+{
+  return svc_mem_diff(device_,0,unit_,offset_,len_,ref_,runs_,max_,nruns_,overflow_);
+}
+
+Err
+svc_mem_diff_u32(Item                device_,
+                 u8                  unit_,
+                 i32                 offset_,
+                 i32                 len_,
+                 const u32          *ref_,
+                 svc_mem_diff_run_t *runs_,
+                 i32                 max_,
+                 i32                *nruns_,
+                 i32                *overflow_)
+{
+  return svc_mem_diff(device_,SVC_MEM_CMD_FLAG_WORDS,unit_,offset_,len_,ref_,runs_,max_,nruns_,overflow_);
+}
+
+static
+Err
+svc_mem_delta(Item                  device_,
+              u8                    unit_,
+              i32                   offset_,
+              const u32            *next_,
+              const u32            *prev_,
+              i32                   len_,
+              const svc_mem_rect_t *rects_,
+              i32                   nrects_,
+              i32                  *written_)
+{
+  Err rv;
+  IOInfo ioi = {0};
+  svc_mem_delta_t desc;
+
+  desc.next    = next_;
+  desc.prev    = prev_;
+  desc.len     = len_;
+  desc.rects   = rects_;
+  desc.nrects  = nrects_;
+  desc.written = 0;
+
+  ioi.ioi_Command         = SVC_MEM_CMD_DELTA;
+  ioi.ioi_CmdOptions      = SVC_MEM_CMD_FLAG_WORDS;
+  ioi.ioi_Unit            = unit_;
+  ioi.ioi_Offset          = offset_;
+  ioi.ioi_Send.iob_Buffer = &desc;
+  ioi.ioi_Send.iob_Len    = sizeof(desc);
+
+  rv = svc_mem_doio(device_,&ioi);
+  if(written_ != NULL)
+    *written_ = desc.written;
+
+  return rv;
+}
+
+Err
+svc_mem_w_u32_delta(Item       device_,
+                    u8         unit_,
+                    i32        offset_,
+                    const u32 *next_,
+                    const u32 *prev_,
+                    i32        len_,
+                    i32       *written_)
+{
+  return svc_mem_delta(device_,unit_,offset_,next_,prev_,len_,NULL,0,written_);
+}
+
+Err
+svc_mem_w_u32_rects(Item                  device_,
+                    u8                    unit_,
+                    i32                   offset_,
+                    const u32            *next_,
+                    const u32            *prev_,
+                    i32                   len_,
+                    const svc_mem_rect_t *rects_,
+                    i32                   nrects_,
+                    i32                  *written_)
+{
+  return svc_mem_delta(device_,unit_,offset_,next_,prev_,len_,rects_,nrects_,written_);
+}
+
+Err
+svc_mem_w_u32_vram_delta(Item       device_,
+                         const u32 *next_,
+                         const u32 *prev_,
+                         i32        len_,
+                         i32        offset_)
+{
+  return svc_mem_w_u32_delta(device_,SVC_MEM_UNIT_VRAM,offset_,next_,prev_,len_,NULL);
+}
+
+static
+Err
+svc_mem_rect(Item                  device_,
+             u8                    cmd_,
+             u32                   options_,
+             u8                    unit_,
+             const svc_mem_rect_t *rect_,
+             void                 *buf_)
+{
+  IOInfo ioi = {0};
+
+  if((rect_->row_len > 0xFFFF) || (rect_->stride > 0xFFFF) ||
+     (rect_->row_len < 0) || (rect_->stride < 0) || (rect_->rows < 0))
+    return BADSIZE;
+
+  ioi.ioi_Command    = cmd_;
+  ioi.ioi_CmdOptions = (options_ | SVC_MEM_CMD_FLAG_RECT);
+  ioi.ioi_Unit       = unit_;
+  ioi.ioi_Offset     = rect_->offset;
+  ioi.ioi_User       = SVC_MEM_RECT(rect_->row_len,rect_->stride);
+  if(cmd_ == CMD_READ)
+    {
+      ioi.ioi_Recv.iob_Buffer = buf_;
+      ioi.ioi_Recv.iob_Len    = (rect_->row_len * rect_->rows);
+    }
+  else
+    {
+      ioi.ioi_Send.iob_Buffer = buf_;
+      ioi.ioi_Send.iob_Len    = (rect_->row_len * rect_->rows);
+    }
+
+  return svc_mem_doio(device_,&ioi);
+}
+
+Err
+svc_mem_r_u8_rect(Item                  device_,
+                  u8                    unit_,
+                  const svc_mem_rect_t *rect_,
+                  u8                   *dst_)
+{
+  return svc_mem_rect(device_,CMD_READ,0,unit_,rect_,dst_);
+}
+
+Err
+svc_mem_r_u32_rect(Item                  device_,
+                   u8                    unit_,
+                   const svc_mem_rect_t *rect_,
+                   u32                  *dst_)
+{
+  return svc_mem_rect(device_,CMD_READ,SVC_MEM_CMD_FLAG_WORDS,unit_,rect_,dst_);
+}
+
+Err
+svc_mem_w_u8_rect(Item                  device_,
+                  u8                   *src_,
+                  u8                    unit_,
+                  const svc_mem_rect_t *rect_)
+{
+  return svc_mem_rect(device_,CMD_WRITE,0,unit_,rect_,src_);
+}
+
+Err
+svc_mem_w_u32_rect(Item                  device_,
+                   u32                  *src_,
+                   u8                    unit_,
+                   const svc_mem_rect_t *rect_)
+{
+  return svc_mem_rect(device_,CMD_WRITE,SVC_MEM_CMD_FLAG_WORDS,unit_,rect_,src_);
+}
+
+Err
+svc_mem_capture(Item  device_,
+                u8    unit_,
+                i32   offset_,
+                i32   width_,
+                i32   height_,
+                u16  *dst_,
+                u32   options_)
+{
+  IOInfo ioi = {0};
+
+  if((width_ <= 0) || (height_ <= 0) || (width_ > 0xFFFF) || (height_ > 0xFFFF))
+    return BADSIZE;
+  if(width_ > (0x7FFFFFFF / height_))
+    return BADSIZE;
+
+  ioi.ioi_Command         = SVC_MEM_CMD_CAPTURE;
+  ioi.ioi_CmdOptions      = options_;
+  ioi.ioi_Unit            = unit_;
+  ioi.ioi_Offset          = offset_;
+  ioi.ioi_User            = SVC_MEM_CAPTURE_SIZE(width_,height_);
+  ioi.ioi_Recv.iob_Buffer = dst_;
+  ioi.ioi_Recv.iob_Len    = (width_ * height_);
+
+  return svc_mem_doio(device_,&ioi);
+}
+
+Err
+svc_mem_capture_vram(Item  device_,
+                     i32   offset_,
+                     i32   width_,
+                     i32   height_,
+                     u16  *dst_,
+                     u32   options_)
+{
+  return svc_mem_capture(device_,SVC_MEM_UNIT_VRAM,offset_,width_,height_,dst_,options_);
+}
+
+i32
+svc_mem_vram_offset(const void *p_)
+{
+  return ((const u8*)p_ - SVC_MEM_VRAM_BASE);
+}
+
+static
+Err
+svc_mem_sport(Item device_,
+              u8   op_,
+              i32  offset_,
+              u32  arg_,
+              i32  pages_,
+              u32  options_)
+{
+  IOInfo ioi = {0};
+
+  ioi.ioi_Command      = SVC_MEM_CMD_SPORT;
+  ioi.ioi_CmdOptions   = (options_ | SVC_MEM_CMD_SPORT_OP(op_));
+  ioi.ioi_Unit         = SVC_MEM_UNIT_VRAM;
+  ioi.ioi_Offset       = offset_;
+  ioi.ioi_User         = arg_;
+  ioi.ioi_Recv.iob_Len = pages_;
+
+  return svc_mem_doio(device_,&ioi);
+}
+
+Err
+svc_mem_vram_flash(Item device_,
+                   i32  offset_,
+                   u32  colour_,
+                   i32  pages_,
+                   u32  options_)
+{
+  return svc_mem_sport(device_,SVC_MEM_SPORT_OP_FLASH,offset_,colour_,pages_,options_);
+}
+
+Err
+svc_mem_vram_copy_pages(Item device_,
+                        i32  src_offset_,
+                        i32  dst_offset_,
+                        i32  pages_,
+                        u32  options_)
+{
+  return svc_mem_sport(device_,SVC_MEM_SPORT_OP_COPY,dst_offset_,src_offset_,pages_,options_);
+}
+
+Err
+svc_mem_rmw(Item                 device_,
+            const svc_mem_rmw_t *ents_,
+            i32                  count_,
+            u32                 *old_)
+{
+  IOInfo ioi = {0};
+
+  ioi.ioi_Command         = SVC_MEM_CMD_RMW;
+  ioi.ioi_Send.iob_Buffer = (void*)ents_;
+  ioi.ioi_Send.iob_Len    = count_;
+  ioi.ioi_Recv.iob_Buffer = old_;
+  ioi.ioi_Recv.iob_Len    = ((old_ == NULL) ? 0 : count_);
+
+  return svc_mem_doio(device_,&ioi);
+}
+
+Err
+svc_mem_rmw_u32(Item  device_,
+                u8    unit_,
+                i32   offset_,
+                u8    op_,
+                u32   value_,
+                u32   mask_,
+                u32  *old_)
+{
+  svc_mem_rmw_t ent = {0};
+
+  ent.op     = op_;
+  ent.unit   = unit_;
+  ent.offset = offset_;
+  ent.value  = value_;
+  ent.mask   = mask_;
+
+  return svc_mem_rmw(device_,&ent,1,old_);
+}
+
+Err
+svc_mem_cas_u32(Item  device_,
+                u8    unit_,
+                i32   offset_,
+                u32   expected_,
+                u32   value_,
+                u32  *old_)
+{
+  return svc_mem_rmw_u32(device_,unit_,offset_,SVC_MEM_RMW_OP_CAS,value_,expected_,old_);
+}
+
+Item
+svc_mem_wait_u32_async(Item            device_,
+                       u8              unit_,
+                       i32             offset_,
+                       svc_mem_wait_t *desc_)
+{
+  IOInfo ioi = {0};
+
+  ioi.ioi_Command         = SVC_MEM_CMD_WAIT;
+  ioi.ioi_Unit            = unit_;
+  ioi.ioi_Offset          = offset_;
+  ioi.ioi_Send.iob_Buffer = desc_;
+  ioi.ioi_Send.iob_Len    = sizeof(svc_mem_wait_t);
+
+  return svc_mem_sendio(device_,&ioi);
+}
+
+Err
+svc_mem_wait_u32(Item            device_,
+                 u8              unit_,
+                 i32             offset_,
+                 svc_mem_wait_t *desc_)
+{
+  Err rv;
+  i32 met;
+  Item ioreq;
+
+  ioreq = svc_mem_wait_u32_async(device_,unit_,offset_,desc_);
+  if(ioreq < 0)
+    return ioreq;
+
+  rv = svc_mem_io_wait(device_,ioreq,&met);
+
+  return ((rv < 0) ? rv : met);
+}
+
+Err
+svc_mem_ring_init(svc_mem_ring_t *ring_,
+                  u32            *data_,
+                  u32             size_,
+                  u32             record_words_)
+{
+  if((ring_ == NULL) || (data_ == NULL))
+    return BADPTR;
+  if((size_ == 0) || (size_ & (size_ - 1)) || (record_words_ == 0))
+    return BADSIZE;
+
+  ring_->head         = 0;
+  ring_->tail         = 0;
+  ring_->size         = size_;
+  ring_->record_words = record_words_;
+  ring_->dropped      = 0;
+  ring_->data         = data_;
+
+  return 0;
+}
+
+/*
+  `head` is read once, records before it are complete. `tail` moves
+  only after they are copied out so the producer can't reuse them
+  early.
+*/
+i32
+svc_mem_ring_read(svc_mem_ring_t *ring_,
+                  u32            *dst_,
+                  i32             max_)
+{
+  u32 i;
+  u32 n;
+  u32 len;
+  u32 tail;
+  const u32 *src;
+
+  tail = ring_->tail;
+  n    = (ring_->head - tail);
+  if(n > (u32)max_)
+    n = (u32)max_;
+
+  for(i = 0; i < n; i++)
+    {
+      src = &ring_->data[((tail + i) & (ring_->size - 1)) * ring_->record_words];
+      for(len = 0; len < ring_->record_words; len++)
+        *dst_++ = src[len];
+    }
+
+  ring_->tail = (tail + n);
+
+  return (i32)n;
+}
+
+Item
+svc_mem_sample_start(Item              device_,
+                     svc_mem_sample_t *desc_)
+{
+  IOInfo ioi = {0};
+
+  ioi.ioi_Command         = SVC_MEM_CMD_SAMPLE;
+  ioi.ioi_Send.iob_Buffer = desc_;
+  ioi.ioi_Send.iob_Len    = sizeof(svc_mem_sample_t);
+
+  return svc_mem_sendio(device_,&ioi);
+}
+
+Err
+svc_mem_sample_stop(Item device_,
+                    Item ioreq_)
+{
+  Err rv;
+  i32 records;
+
+  svc_mem_io_abort(ioreq_);
+
+  rv = svc_mem_io_wait(device_,ioreq_,&records);
+
+  return (((rv < 0) && (rv != ABORTED)) ? rv : records);
+}
+
+Item
+svc_mem_watch_start(Item             device_,
+                    svc_mem_watch_t *desc_)
+{
+  IOInfo ioi = {0};
+
+  desc_->changed = 0;
+  desc_->acked   = 0;
+
+  ioi.ioi_Command         = SVC_MEM_CMD_WATCH;
+  ioi.ioi_Send.iob_Buffer = desc_;
+  ioi.ioi_Send.iob_Len    = sizeof(svc_mem_watch_t);
+
+  return svc_mem_sendio(device_,&ioi);
+}
+
+/*
+  `changed` is read once and `acked` set to it, bits the driver flips
+  in between stay reported for the next call.
+*/
+u32
+svc_mem_watch_changed(svc_mem_watch_t *desc_)
+{
+  u32 changed;
+  u32 ids;
+
+  changed = desc_->changed;
+  ids     = (changed ^ desc_->acked);
+
+  desc_->acked = changed;
+
+  return ids;
+}
+
+Err
+svc_mem_watch_stop(Item device_,
+                   Item ioreq_)
+{
+  return svc_mem_sample_stop(device_,ioreq_);
+}
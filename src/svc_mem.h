@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include "svc_mem_drv_opts.h"
+
 #include "types.h"
 
 #ifdef __cplusplus
@@ -32,12 +34,63 @@ Err  svc_mem_close_device(Item device);
 
 Item svc_mem_create_ioreq(Item device);
 
+/*
+  IOReqs are pooled per device opened with svc_mem_open_device and
+  per thread, an IOReq belonging to the thread that created it. A
+  thread calling with a device it didn't open itself gets an IOReq
+  created and deleted for the call. An IOReq from svc_mem_ioreq_get,
+  or an *_async call, has to be put back, or waited on, by the same
+  thread. The svc_mem_ior_* variants take an IOReq checked out with
+  svc_mem_ioreq_get so tight loops can skip the pool entirely.
+*/
+Item svc_mem_ioreq_get(Item device);
+Err  svc_mem_ioreq_put(Item device, Item ioreq);
+
+Err svc_mem_ior_r_u8_unit(Item ioreq, u8 unit, i32 offset, u8 *dst, i32 len);
+Err svc_mem_ior_r_u32_unit(Item ioreq, u8 unit, i32 offset, u32 *dst, i32 len);
+Err svc_mem_ior_w_u8_unit(Item ioreq, u8 *src, i32 len, u8 unit, i32 offset);
+Err svc_mem_ior_w_u32_unit(Item ioreq, u32 *src, i32 len, u8 unit, i32 offset);
+
+/*
+  The *_async variants start the transfer with SendIO and return the
+  IOReq. Memory transfers above the configured chunk threshold are
+  moved by the driver in chunks and can be cancelled with
+  svc_mem_io_abort. svc_mem_io_wait must be called for every IOReq
+  returned: it waits, reports in `bytes` how much was actually moved,
+  even if aborted, and returns the IOReq to the device's pool.
+*/
+Item svc_mem_r_u8_unit_async(Item device, u8 unit, i32 offset, u8 *dst, i32 len);
+Item svc_mem_r_u32_unit_async(Item device, u8 unit, i32 offset, u32 *dst, i32 len);
+Item svc_mem_w_u8_unit_async(Item device, u8 *src, i32 len, u8 unit, i32 offset);
+Item svc_mem_w_u32_unit_async(Item device, u32 *src, i32 len, u8 unit, i32 offset);
+
+Item svc_mem_r_u8_dram_async(Item device, i32 offset, u8 *dst, i32 len);
+Item svc_mem_r_u32_dram_async(Item device, i32 offset, u32 *dst, i32 len);
+Item svc_mem_r_u8_vram_async(Item device, i32 offset, u8 *dst, i32 len);
+Item svc_mem_r_u32_vram_async(Item device, i32 offset, u32 *dst, i32 len);
+Item svc_mem_r_u8_rom1_async(Item device, i32 offset, u8 *dst, i32 len);
+Item svc_mem_r_u32_rom1_async(Item device, i32 offset, u32 *dst, i32 len);
+Item svc_mem_r_u8_rom2_async(Item device, i32 offset, u8 *dst, i32 len);
+Item svc_mem_r_u32_rom2_async(Item device, i32 offset, u32 *dst, i32 len);
+
+i32 svc_mem_io_poll(Item ioreq);
+Err svc_mem_io_abort(Item ioreq);
+Err svc_mem_io_wait(Item device, Item ioreq, i32 *bytes);
+
 Err svc_mem_r_u8(Item device, u8 *src, i32 offset, u8 *dst, i32 len);
 Err svc_mem_r_u32(Item device, u32 *src, i32 offset, u32 *dst, i32 len);
 
 Err svc_mem_r_u8_unit(Item device, u8 unit, i32 offset, u8 *dst, i32 len);
 Err svc_mem_r_u32_unit(Item device, u8 unit, i32 offset, u32 *dst, i32 len);
 
+/*
+  Fault tolerant reads of ROM1, ROM2 or NVRAM. Elements that data
+  abort read as `pattern` and are flagged in `map`, if not NULL,
+  which must hold SVC_MEM_FAULTMAP_WORDS(len) words.
+*/
+Err svc_mem_r_u8_faultmap(Item device, u8 unit, i32 offset, u8 *dst, i32 len, u8 pattern, u32 *map);
+Err svc_mem_r_u32_faultmap(Item device, u8 unit, i32 offset, u32 *dst, i32 len, u32 pattern, u32 *map);
+
 Err svc_mem_r_u8_dram(Item device, i32 offset, u8 *dst, i32 len);
 Err svc_mem_r_u32_dram(Item device, i32 offset, u32 *dst, i32 len);
 Err svc_mem_r_u8_vram(Item device, i32 offset, u8 *dst, i32 len);
@@ -68,6 +121,177 @@ Err svc_mem_w_u32_madam(Item device, u32 *src, i32 len, i32 offset);
 Err svc_mem_w_u32_clio(Item device, u32 *src, i32 len, i32 offset);
 Err svc_mem_w_u32_sport(Item device, u32 *src, i32 len, i32 offset);
 
+Err svc_mem_config_get(Item device, svc_mem_config_t *cfg);
+Err svc_mem_config_set(Item device, const svc_mem_config_t *cfg);
+
+Err svc_mem_stats_get(Item device, svc_mem_stats_t *stats);
+Err svc_mem_stats_reset(Item device);
+
+/*
+  Fill `len` elements with `pattern`. The destination must be aligned
+  to the element size.
+*/
+Err svc_mem_fill_u8(Item device, u8 *dst, i32 offset, u8 pattern, i32 len);
+Err svc_mem_fill_u16(Item device, u16 *dst, i32 offset, u16 pattern, i32 len);
+Err svc_mem_fill_u32(Item device, u32 *dst, i32 offset, u32 pattern, i32 len);
+
+Err svc_mem_fill_u8_unit(Item device, u8 unit, i32 offset, u8 pattern, i32 len);
+Err svc_mem_fill_u16_unit(Item device, u8 unit, i32 offset, u16 pattern, i32 len);
+Err svc_mem_fill_u32_unit(Item device, u8 unit, i32 offset, u32 pattern, i32 len);
+
+Err svc_mem_fill_u8_dram(Item device, i32 offset, u8 pattern, i32 len);
+Err svc_mem_fill_u16_dram(Item device, i32 offset, u16 pattern, i32 len);
+Err svc_mem_fill_u32_dram(Item device, i32 offset, u32 pattern, i32 len);
+Err svc_mem_fill_u8_vram(Item device, i32 offset, u8 pattern, i32 len);
+Err svc_mem_fill_u16_vram(Item device, i32 offset, u16 pattern, i32 len);
+Err svc_mem_fill_u32_vram(Item device, i32 offset, u32 pattern, i32 len);
+
+/*
+  Unit to unit copies done entirely in the driver. Offsets and `len`
+  are in elements. Overlapping copies behave like memmove.
+*/
+Err svc_mem_copy_u8(Item device, u8 src_unit, i32 src_offset, u8 dst_unit, i32 dst_offset, i32 len);
+Err svc_mem_copy_u32(Item device, u8 src_unit, i32 src_offset, u8 dst_unit, i32 dst_offset, i32 len);
+
+/*
+  Hash `len` elements of a unit in the driver. `digest` is the digest
+  to continue from, SVC_MEM_CHECKSUM_INIT(algo) for a new one, and
+  receives the result.
+*/
+Err svc_mem_checksum_u8(Item device, u8 unit, i32 offset, i32 len, u8 algo, u32 *digest);
+Err svc_mem_checksum_u32(Item device, u8 unit, i32 offset, i32 len, u8 algo, u32 *digest);
+
+/*
+  Find `pattern`, under `mask` if not NULL, in `len` elements of a
+  unit. Up to `max` match offsets are stored in `hits` and their
+  number in `nhits`.
+*/
+Err svc_mem_search_u8(Item device, u8 unit, i32 offset, i32 len, const u8 *pattern, const u8 *mask,
+                      i32 pattern_len, i32 *hits, i32 max, i32 *nhits);
+Err svc_mem_search_u32(Item device, u8 unit, i32 offset, i32 len, const u32 *pattern, const u32 *mask,
+                       i32 pattern_len, i32 *hits, i32 max, i32 *nhits);
+
+/*
+  Compare `len` elements of a unit with `ref`. Up to `max` runs of
+  changed elements are stored in `runs` and their number in `nruns`.
+  `overflow`, if not NULL, is set when there were more.
+*/
+Err svc_mem_diff_u8(Item device, u8 unit, i32 offset, i32 len, const u8 *ref,
+                    svc_mem_diff_run_t *runs, i32 max, i32 *nruns, i32 *overflow);
+Err svc_mem_diff_u32(Item device, u8 unit, i32 offset, i32 len, const u32 *ref,
+                     svc_mem_diff_run_t *runs, i32 max, i32 *nruns, i32 *overflow);
+
+/*
+  Write the words of frame `next` that differ from `prev`, the frame
+  the destination currently holds, or all of them if `prev` is NULL.
+  The _rects variant only looks within the dirty rectangles. `len` is
+  the frame size in words and `written` receives the words written.
+*/
+Err svc_mem_w_u32_delta(Item device, u8 unit, i32 offset, const u32 *next, const u32 *prev,
+                        i32 len, i32 *written);
+Err svc_mem_w_u32_rects(Item device, u8 unit, i32 offset, const u32 *next, const u32 *prev,
+                        i32 len, const svc_mem_rect_t *rects, i32 nrects, i32 *written);
+Err svc_mem_w_u32_vram_delta(Item device, const u32 *next, const u32 *prev, i32 len, i32 offset);
+
+/*
+  Move a rectangle of a unit, the caller's buffer holding the rows
+  packed. Row length and stride are limited to 65535 elements.
+*/
+Err svc_mem_r_u8_rect(Item device, u8 unit, const svc_mem_rect_t *rect, u8 *dst);
+Err svc_mem_r_u32_rect(Item device, u8 unit, const svc_mem_rect_t *rect, u32 *dst);
+Err svc_mem_w_u8_rect(Item device, u8 *src, u8 unit, const svc_mem_rect_t *rect);
+Err svc_mem_w_u32_rect(Item device, u32 *src, u8 unit, const svc_mem_rect_t *rect);
+
+/*
+  Capture a line paired bitmap, `offset` in words, into the linear
+  `width` x `height` image `dst`. `options` takes
+  SVC_MEM_CMD_FLAG_RGB15 and SVC_MEM_CMD_FLAG_SWAP.
+*/
+Err svc_mem_capture(Item device, u8 unit, i32 offset, i32 width, i32 height, u16 *dst, u32 options);
+Err svc_mem_capture_vram(Item device, i32 offset, i32 width, i32 height, u16 *dst, u32 options);
+
+/*
+  Whole VRAM pages through the SPORT. Offsets are bytes from the start
+  of VRAM, svc_mem_vram_offset gives the one of a pointer such as a
+  bitmap's buffer, and multiples of SVC_MEM_SPORT_PAGE_SIZE. `options` takes
+  SVC_MEM_CMD_FLAG_CPU to do the same with the CPU.
+*/
+i32 svc_mem_vram_offset(const void *p);
+Err svc_mem_vram_flash(Item device, i32 offset, u32 colour, i32 pages, u32 options);
+Err svc_mem_vram_copy_pages(Item device, i32 src_offset, i32 dst_offset, i32 pages, u32 options);
+
+/*
+  Read-modify-write of words with interrupts disabled, `offset` in
+  words. `old` may be NULL. svc_mem_rmw applies up to SVC_MEM_RMW_MAX
+  entries as one, `old` holding `count` words. svc_mem_cas_u32 stores
+  `value` if the word equals `expected`, which it did if *old does.
+*/
+Err svc_mem_rmw(Item device, const svc_mem_rmw_t *ents, i32 count, u32 *old);
+Err svc_mem_rmw_u32(Item device, u8 unit, i32 offset, u8 op, u32 value, u32 mask, u32 *old);
+Err svc_mem_cas_u32(Item device, u8 unit, i32 offset, u32 expected, u32 value, u32 *old);
+
+/*
+  Wait for (word & desc->mask) == desc->expected, `offset` in words.
+  svc_mem_wait_u32 returns 1 if it held, 0 on timeout. The async form
+  returns the IOReq, svc_mem_io_wait reporting 1 or 0 in `bytes`;
+  `desc` must stay valid until then.
+*/
+Err  svc_mem_wait_u32(Item device, u8 unit, i32 offset, svc_mem_wait_t *desc);
+Item svc_mem_wait_u32_async(Item device, u8 unit, i32 offset, svc_mem_wait_t *desc);
+
+/*
+  Register sampling. svc_mem_ring_init sets up a ring of `size`
+  records, a power of 2, of `record_words` words in `data`.
+  svc_mem_sample_start returns the IOReq of a running sampler and
+  svc_mem_sample_stop ends it, returning the number of records taken.
+  svc_mem_ring_read moves up to `max` records into `dst` while the
+  sampler runs and returns how many.
+*/
+Err  svc_mem_ring_init(svc_mem_ring_t *ring, u32 *data, u32 size, u32 record_words);
+i32  svc_mem_ring_read(svc_mem_ring_t *ring, u32 *dst, i32 max);
+Item svc_mem_sample_start(Item device, svc_mem_sample_t *desc);
+Err  svc_mem_sample_stop(Item device, Item ioreq);
+
+/*
+  Memory change watches. svc_mem_watch_start returns the IOReq of a
+  running watch, the task receiving desc->signal after each pass that
+  found changes. svc_mem_watch_changed returns the IDs, bit n for
+  desc->ranges[n], changed since the last call. svc_mem_watch_stop
+  ends the watch, returning the number of passes that found changes.
+*/
+Item svc_mem_watch_start(Item device, svc_mem_watch_t *desc);
+u32  svc_mem_watch_changed(svc_mem_watch_t *desc);
+Err  svc_mem_watch_stop(Item device, Item ioreq);
+
+/*
+  Batches are built into caller supplied storage: `entries` holds up
+  to `max` descriptors and `errors`, if not NULL, receives one error
+  code per entry. Set SVC_MEM_CMD_FLAG_CONTINUE in `options` to run
+  past failing entries. svc_mem_batch_exec runs entries from `first`
+  and reports in `done` `first` plus the number that succeeded. When
+  stopping on error that is the index to resume from. With
+  SVC_MEM_CMD_FLAG_CONTINUE it isn't, `errors` says which failed.
+*/
+typedef struct svc_mem_batch_s svc_mem_batch_t;
+struct svc_mem_batch_s
+{
+  svc_mem_batch_entry_t *entries;
+  Err                   *errors;
+  i32                    count;
+  i32                    max;
+  u32                    options;
+};
+
+void svc_mem_batch_init(svc_mem_batch_t *batch, svc_mem_batch_entry_t *entries, Err *errors, i32 max);
+void svc_mem_batch_reset(svc_mem_batch_t *batch);
+
+Err svc_mem_batch_r_u8(svc_mem_batch_t *batch, u8 unit, i32 offset, u8 *dst, i32 len);
+Err svc_mem_batch_r_u32(svc_mem_batch_t *batch, u8 unit, i32 offset, u32 *dst, i32 len);
+Err svc_mem_batch_w_u8(svc_mem_batch_t *batch, u8 *src, i32 len, u8 unit, i32 offset);
+Err svc_mem_batch_w_u32(svc_mem_batch_t *batch, u32 *src, i32 len, u8 unit, i32 offset);
+
+Err svc_mem_batch_exec(Item device, svc_mem_batch_t *batch, i32 first, i32 *done);
+
 #ifdef __cplusplus
 }
 #endif
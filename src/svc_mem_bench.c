@@ -0,0 +1,479 @@
+/*
+  ISC License
+
+  Copyright (c) 2024, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "svc_mem.h"
+
+#include "io.h"
+#include "mem.h"
+#include "operror.h"
+#include "stdio.h"
+#include "time.h"
+
+/*
+  Sweeps unit x op x width x size x alignment through the driver and
+  prints one CSV row per combination so runs can be diffed.
+
+  Every combination is repeated until at least BENCH_MIN_USEC have
+  passed. `dispatch_ns` is the time of a zero length request to the
+  same unit, op and width, `copy_ns` is what the transfer adds on top
+  of it. Chunking is disabled for the run so every request is a single
+  direct driver call.
+
+  Time comes from the timer device's microsecond unit, which Portfolio
+  drives from the CLIO timers, and from CLOCK_MONOTONIC in the host
+  build.
+
+  Writes only go to unit NONE, into the bench's own buffer. DRAM and
+  VRAM share its write kernels and writing to memory the bench doesn't
+  own isn't safe on hardware.
+
+  A second table compares SVC_MEM_CMD_SPORT against its CPU fallback
+  clearing and copying a 320x240 16 bit screen in VRAM the bench
+  allocates itself. SPORT times include waiting for the vertical blank
+  the work is done in.
+*/
+
+#define BENCH_MIN_USEC 20000
+#define BENCH_MAX_SIZE (64 * 1024)
+
+typedef struct bench_unit_s bench_unit_t;
+struct bench_unit_s
+{
+  u8          unit;
+  const char *name;
+  u8          widths;
+  u8          write;
+  i32         size;   // bytes, for NONE the bench's buffers
+};
+
+#define U8   (1 << 0)
+#define U32  (1 << 1)
+
+static const bench_unit_t g_BENCH_UNITS[] =
+  {
+    {SVC_MEM_UNIT_NONE,  "none",  U8|U32, 1, BENCH_MAX_SIZE + 4},
+    {SVC_MEM_UNIT_DRAM,  "dram",  U8|U32, 0, 2 * 1024 * 1024},
+    {SVC_MEM_UNIT_VRAM,  "vram",  U8|U32, 0, 1 * 1024 * 1024},
+    {SVC_MEM_UNIT_ROM1,  "rom1",  U8|U32, 0, 1 * 1024 * 1024},
+    {SVC_MEM_UNIT_ROM2,  "rom2",  U8|U32, 0, 1 * 1024 * 1024},
+    {SVC_MEM_UNIT_NVRAM, "nvram", U8,     0, 32 * 1024},
+    {SVC_MEM_UNIT_MADAM, "madam", U32,    0, 2 * 1024},
+    {SVC_MEM_UNIT_CLIO,  "clio",  U32,    0, 1 * 1024}
+  };
+
+#define BENCH_UNITS (sizeof(g_BENCH_UNITS) / sizeof(g_BENCH_UNITS[0]))
+
+static const i32 g_BENCH_SIZES[] = {16, 256, 4096, BENCH_MAX_SIZE};
+
+#define BENCH_SIZES (sizeof(g_BENCH_SIZES) / sizeof(g_BENCH_SIZES[0]))
+
+#define BENCH_SCREEN_PAGES ((320 * 240 * 2) / SVC_MEM_SPORT_PAGE_SIZE)
+#define BENCH_SCREEN_BYTES (BENCH_SCREEN_PAGES * SVC_MEM_SPORT_PAGE_SIZE)
+// two screens and a page to align them with
+#define BENCH_VRAM_BYTES   ((2 * BENCH_SCREEN_BYTES) + SVC_MEM_SPORT_PAGE_SIZE)
+
+typedef struct bench_sport_s bench_sport_t;
+struct bench_sport_s
+{
+  u8          op;
+  u32         options;
+  const char *name;
+  const char *path;
+};
+
+static const bench_sport_t g_BENCH_SPORT[] =
+  {
+    {SVC_MEM_SPORT_OP_FLASH, 0,                    "clear", "sport"},
+    {SVC_MEM_SPORT_OP_FLASH, SVC_MEM_CMD_FLAG_CPU, "clear", "cpu"},
+    {SVC_MEM_SPORT_OP_COPY,  0,                    "copy",  "sport"},
+    {SVC_MEM_SPORT_OP_COPY,  SVC_MEM_CMD_FLAG_CPU, "copy",  "cpu"}
+  };
+
+#define BENCH_SPORT (sizeof(g_BENCH_SPORT) / sizeof(g_BENCH_SPORT[0]))
+
+// {src, dst} byte misalignment, byte mode only
+static const u8 g_BENCH_ALIGNS[][2] = {{0,0},{1,1},{0,1},{1,0}};
+
+#define BENCH_ALIGNS (sizeof(g_BENCH_ALIGNS) / sizeof(g_BENCH_ALIGNS[0]))
+
+typedef struct bench_s bench_t;
+struct bench_s
+{
+  Item  ioreq;
+  u8   *src;
+  u8   *dst;
+};
+
+static Item g_TIMER_IOREQ;
+
+static
+Err
+bench_clock_init(void)
+{
+  Item timer;
+
+  timer = OpenNamedDevice("timer",0);
+  if(timer < 0)
+    return timer;
+
+  g_TIMER_IOREQ = CreateIOReq(0,0,timer,0);
+  if(g_TIMER_IOREQ < 0)
+    return g_TIMER_IOREQ;
+
+  return 0;
+}
+
+static
+u32
+bench_clock_usec(void)
+{
+  IOInfo ioi = {0};
+  struct timeval tv;
+
+  ioi.ioi_Command         = CMD_READ;
+  ioi.ioi_Unit            = TIMER_UNIT_USEC;
+  ioi.ioi_Recv.iob_Buffer = &tv;
+  ioi.ioi_Recv.iob_Len    = sizeof(tv);
+
+  DoIO(g_TIMER_IOREQ,&ioi);
+
+  return (((u32)tv.tv_sec * 1000000) + (u32)tv.tv_usec);
+}
+
+/*
+  `len_` and the unit offset are in elements. Unit NONE reads from and
+  writes to the bench's buffers.
+*/
+static
+Err
+bench_io(const bench_t *b_,
+         const u8       cmd_,
+         const u8       unit_,
+         const i32      in_words_,
+         const u8      *align_,
+         const i32      len_)
+{
+  IOInfo ioi = {0};
+
+  ioi.ioi_Command = cmd_;
+  ioi.ioi_Unit    = unit_;
+  if(in_words_)
+    ioi.ioi_CmdOptions |= SVC_MEM_CMD_FLAG_WORDS;
+
+  if(cmd_ == CMD_READ)
+    {
+      ioi.ioi_Offset          = align_[0];
+      ioi.ioi_Send.iob_Buffer = b_->src;
+      ioi.ioi_Recv.iob_Buffer = (b_->dst + align_[1]);
+      ioi.ioi_Recv.iob_Len    = len_;
+    }
+  else
+    {
+      ioi.ioi_Offset          = align_[1];
+      ioi.ioi_Send.iob_Buffer = (b_->src + align_[0]);
+      ioi.ioi_Send.iob_Len    = len_;
+      ioi.ioi_Recv.iob_Buffer = b_->dst;
+    }
+
+  return DoIO(b_->ioreq,&ioi);
+}
+
+/*
+  Returns the average time per request in ns and the repetitions in
+  `reps_`. The repetition count doubles until the run is long enough
+  for the clock's resolution not to matter.
+*/
+static
+Err
+bench_time(const bench_t *b_,
+           const u8       cmd_,
+           const u8       unit_,
+           const i32      in_words_,
+           const u8      *align_,
+           const i32      len_,
+           u32           *ns_,
+           u32           *reps_)
+{
+  Err err;
+  u32 i;
+  u32 reps;
+  u32 usec;
+  u32 start;
+
+  for(reps = 1;; reps <<= 1)
+    {
+      start = bench_clock_usec();
+      for(i = 0; i < reps; i++)
+        {
+          err = bench_io(b_,cmd_,unit_,in_words_,align_,len_);
+          if(err < 0)
+            return err;
+        }
+      usec = (bench_clock_usec() - start);
+      if(usec >= BENCH_MIN_USEC)
+        break;
+    }
+
+  *ns_   = ((usec * 1000) / reps);
+  *reps_ = reps;
+
+  return 0;
+}
+
+/*
+  MB/s with two decimals, computed in 32 bits.
+*/
+static
+void
+bench_print_mbps(const u32 bytes_,
+                 const u32 ns_)
+{
+  u32 x;
+
+  if(ns_ == 0)
+    {
+      printf("0.00");
+      return;
+    }
+
+  x = ((bytes_ * 1000) / ns_) * 100 + ((((bytes_ * 1000) % ns_) * 100) / ns_);
+  printf("%u.%02u",x / 100,x % 100);
+}
+
+static
+void
+bench_combo(const bench_t      *b_,
+            const bench_unit_t *u_,
+            const u8            cmd_,
+            const i32           in_words_)
+{
+  Err err;
+  u32 s;
+  u32 a;
+  u32 ns;
+  u32 reps;
+  u32 copy;
+  u32 dispatch;
+  i32 bytes;
+  u32 naligns;
+  static const u8 aligned[2] = {0,0};
+
+  err = bench_time(b_,cmd_,u_->unit,in_words_,aligned,0,&dispatch,&reps);
+  if(err < 0)
+    {
+      printf("# %s %s u%d: ",u_->name,(cmd_ == CMD_READ ? "read" : "write"),
+             (in_words_ ? 32 : 8));
+      PrintfSysErr(err);
+      return;
+    }
+
+  naligns = (in_words_ ? 1 : BENCH_ALIGNS);
+  for(s = 0; s < BENCH_SIZES; s++)
+    {
+      // leave room for the misaligned offsets
+      bytes = g_BENCH_SIZES[s];
+      if(bytes >= u_->size)
+        continue;
+
+      for(a = 0; a < naligns; a++)
+        {
+          err = bench_time(b_,cmd_,u_->unit,in_words_,g_BENCH_ALIGNS[a],
+                           (in_words_ ? (bytes >> 2) : bytes),
+                           &ns,&reps);
+          if(err < 0)
+            continue;
+
+          copy = ((ns > dispatch) ? (ns - dispatch) : 0);
+          printf("%s,%s,%d,%d,%d,%d,%u,%u,%u,%u,",
+                 u_->name,
+                 (cmd_ == CMD_READ ? "read" : "write"),
+                 (in_words_ ? 32 : 8),
+                 bytes,
+                 g_BENCH_ALIGNS[a][0],
+                 g_BENCH_ALIGNS[a][1],
+                 reps,
+                 ns,
+                 dispatch,
+                 copy);
+          bench_print_mbps(bytes,ns);
+          printf(",");
+          bench_print_mbps(bytes,copy);
+          printf("\n");
+        }
+    }
+}
+
+static
+void
+bench_run(const bench_t *b_)
+{
+  u32 i;
+  const bench_unit_t *u;
+
+  printf("unit,op,width,bytes,src_align,dst_align,reps,"
+         "call_ns,dispatch_ns,copy_ns,mbps,copy_mbps\n");
+
+  for(i = 0; i < BENCH_UNITS; i++)
+    {
+      u = &g_BENCH_UNITS[i];
+      if(u->widths & U8)
+        bench_combo(b_,u,CMD_READ,0);
+      if(u->widths & U32)
+        bench_combo(b_,u,CMD_READ,1);
+      if(u->write && (u->widths & U8))
+        bench_combo(b_,u,CMD_WRITE,0);
+      if(u->write && (u->widths & U32))
+        bench_combo(b_,u,CMD_WRITE,1);
+    }
+}
+
+/*
+  One screen's worth of pages, `screen_` holds the VRAM offsets of
+  the two screens. Copies go from the first to the second.
+*/
+static
+Err
+bench_sport_io(const bench_t       *b_,
+               const bench_sport_t *s_,
+               const i32           *screen_)
+{
+  IOInfo ioi = {0};
+
+  ioi.ioi_Command      = SVC_MEM_CMD_SPORT;
+  ioi.ioi_CmdOptions   = (s_->options | SVC_MEM_CMD_SPORT_OP(s_->op));
+  ioi.ioi_Unit         = SVC_MEM_UNIT_VRAM;
+  ioi.ioi_Offset       = screen_[1];
+  ioi.ioi_User         = ((s_->op == SVC_MEM_SPORT_OP_COPY) ? screen_[0] : 0);
+  ioi.ioi_Recv.iob_Len = BENCH_SCREEN_PAGES;
+
+  return DoIO(b_->ioreq,&ioi);
+}
+
+static
+void
+bench_sport(const bench_t *b_)
+{
+  Err err;
+  u8 *vram;
+  u32 i;
+  u32 n;
+  u32 ns;
+  u32 reps;
+  u32 usec;
+  u32 start;
+  i32 screen[2];
+  const bench_sport_t *s;
+
+  printf("\nop,path,bytes,reps,call_ns,mbps\n");
+
+  vram = (u8*)AllocMem(BENCH_VRAM_BYTES,MEMTYPE_VRAM);
+  if(vram == NULL)
+    {
+      printf("# sport: ");
+      PrintfSysErr(NOMEM);
+      return;
+    }
+
+  screen[0] = ((svc_mem_vram_offset(vram) + SVC_MEM_SPORT_PAGE_SIZE - 1) &
+               ~(SVC_MEM_SPORT_PAGE_SIZE - 1));
+  screen[1] = (screen[0] + BENCH_SCREEN_BYTES);
+
+  for(n = 0; n < BENCH_SPORT; n++)
+    {
+      s   = &g_BENCH_SPORT[n];
+      err = 0;
+      for(reps = 1; err >= 0; reps <<= 1)
+        {
+          start = bench_clock_usec();
+          for(i = 0; (i < reps) && (err >= 0); i++)
+            err = bench_sport_io(b_,s,screen);
+          usec = (bench_clock_usec() - start);
+          if(usec >= BENCH_MIN_USEC)
+            break;
+        }
+
+      if(err < 0)
+        {
+          printf("# %s %s: ",s->name,s->path);
+          PrintfSysErr(err);
+          continue;
+        }
+
+      ns = ((usec * 1000) / reps);
+      printf("%s,%s,%d,%u,%u,",s->name,s->path,BENCH_SCREEN_BYTES,reps,ns);
+      bench_print_mbps(BENCH_SCREEN_BYTES,ns);
+      printf("\n");
+    }
+
+  FreeMem(vram,BENCH_VRAM_BYTES);
+}
+
+int
+main()
+{
+  Err err;
+  Item dev;
+  bench_t b;
+  svc_mem_config_t cfg;
+  svc_mem_config_t nochunk;
+
+  err = svc_mem_init();
+  if(err < 0)
+    goto error;
+
+  err = bench_clock_init();
+  if(err < 0)
+    goto error;
+
+  dev = svc_mem_open_device();
+  if(dev < 0)
+    {
+      err = dev;
+      goto error;
+    }
+
+  b.ioreq = svc_mem_ioreq_get(dev);
+  b.src   = (u8*)AllocMem(BENCH_MAX_SIZE + 4,MEMTYPE_FILL);
+  b.dst   = (u8*)AllocMem(BENCH_MAX_SIZE + 4,MEMTYPE_FILL);
+  if((b.ioreq < 0) || (b.src == NULL) || (b.dst == NULL))
+    {
+      err = NOMEM;
+      goto error;
+    }
+
+  svc_mem_config_get(dev,&cfg);
+  nochunk = cfg;
+  nochunk.chunk_threshold = 0;
+  svc_mem_config_set(dev,&nochunk);
+
+  bench_run(&b);
+  bench_sport(&b);
+
+  svc_mem_config_set(dev,&cfg);
+
+  FreeMem(b.dst,BENCH_MAX_SIZE + 4);
+  FreeMem(b.src,BENCH_MAX_SIZE + 4);
+  svc_mem_ioreq_put(dev,b.ioreq);
+  svc_mem_close_device(dev);
+
+  return 0;
+
+ error:
+  PrintfSysErr(err);
+  return 1;
+}
@@ -0,0 +1,43 @@
+/*
+  ISC License
+
+  Copyright (c) 2024, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#pragma once
+
+#include "types.h"
+
+/*
+  Free running tick count for timing inside the driver. On hardware
+  it is the counter of CLIO timer SVC_MEM_CLOCK_TIMER, which must be
+  one the kernel keeps running. CLIO timers count down so the value is
+  inverted, and they are 16 bits wide so intervals wrap after 65536
+  ticks. The host build counts microseconds.
+*/
+#ifdef SVC_MEM_HOST
+#include "sim.h"
+#define SVC_MEM_CLOCK_NOW()  (sim_ticks())
+#define SVC_MEM_CLOCK_MASK   0xFFFFFFFF
+#else
+#ifndef SVC_MEM_CLOCK_TIMER
+#define SVC_MEM_CLOCK_TIMER  1
+#endif
+#define SVC_MEM_CLOCK_ADDR   (0x03400100 + (SVC_MEM_CLOCK_TIMER * 8))
+#define SVC_MEM_CLOCK_NOW()  (~*(volatile u32*)SVC_MEM_CLOCK_ADDR)
+#define SVC_MEM_CLOCK_MASK   0x0000FFFF
+#endif
+
+#define SVC_MEM_CLOCK_DIFF(start_,end_) (((end_) - (start_)) & SVC_MEM_CLOCK_MASK)
@@ -1,45 +1,17 @@
 #include "svc_mem_drv.h"
+#include "svc_mem_stats.h"
+#include "svc_mem_unit.h"
 
 #include "svc_funcs.h"
 
 #include "kernel.h"
 #include "portfolio.h"
-#include "setjmp.h"
+#include "stddef.h"
 #include "strings.h"
+#include "super.h"
 
 #define SVC_MEM_DRV_NAME "svc-mem-drv"
 
-#define ABT_ROMF 0x00000001
-
-#define ONEMEG (1024 * 1024)
-
-#define DRAM_START_ADDR  0x00000000
-#define VRAM_START_ADDR  0x00200000
-#define NVRAM_START_ADDR 0x03140000
-#define ROM1_START_ADDR  0x03000000
-#define ROM2_START_ADDR  0x03000000
-#define MADAM_START_ADDR 0x03300000
-#define CLIO_START_ADDR  0x03400000
-#define SPORT_START_ADDR 0x03200000
-
-#define DRAM_SIZE  (2 * ONEMEG)
-#define VRAM_SIZE  (1 * ONEMEG)
-#define ROM1_SIZE  (1 * ONEMEG)
-#define ROM2_SIZE  (1 * ONEMEG)
-#define NVRAM_SIZE (32 * 1024)
-#define MADAM_SIZE ( 2 * 1024)
-#define CLIO_SIZE  ( 1 * 1024)
-#define SPORT_SIZE (1 * ONEMEG)
-
-#define SYSINFO_TAG_SETROMBANK 0x11006
-#define SYSINFO_TAG_CURROMBANK 0x10006
-#define SYSINFO_ROMBANK1       0
-#define SYSINFO_ROMBANK2       1
-#define SYSINFO_TAG_ROM2BASE   0x10007
-#define SYSINFO_ROM2FOUND      0
-#define SYSINFO_ROM2NOTFOUND   1
-
-
 enum driver_tags_e
   {
     CREATEDRIVER_TAG_ABORTIO = TAG_ITEM_LAST+1, // 0x0A
@@ -50,535 +22,1621 @@ enum driver_tags_e
     CREATEDRIVER_TAG_DISPATCH	                // 0x0F
   };
 
-#define DRV_CMDTABLE_LEN 3
+#define DRV_CMDTABLE_LEN 19
+
+/*
+  Memory transfers larger than the threshold are queued and moved by
+  the svc_mem task one chunk per SVC_MEM_CMD_WORK. The task runs
+  between chunks so the time spent in supervisor mode, and with it the
+  latency added to other tasks, is bounded by one chunk copy. Both
+  can be changed with SVC_MEM_CMD_CONFIG.
+*/
+#define DRV_CHUNK_THRESHOLD (32 * 1024)
+#define DRV_CHUNK_SIZE      (16 * 1024)
+
+/*
+  SPORT pages done per vertical blank. Keeps a large request from
+  running on past the blank into the displayed part of the field.
+*/
+#define DRV_SPORT_VBL_PAGES 128
+
+#define DRV_SPORT_PAGE_SHIFT 11
+
+#define DRV_IOR_FROM_LINK(n_) \
+  ((struct IOReq*)((u8*)(n_) - offsetof(struct IOReq,io_Link)))
+
+/*
+  Task that sent a request, the host build keeps it in the IOReq.
+*/
+#ifdef SVC_MEM_HOST
+#define DRV_IOR_OWNER(ior_) ((ior_)->io_Owner)
+#else
+#define DRV_IOR_OWNER(ior_) ((struct Task*)LookupItem((ior_)->io.n_Owner))
+#endif
+
+static List        g_DRV_QUEUE;
+static List        g_DRV_WAITS;
+static List        g_DRV_SAMPLERS;
+static List        g_DRV_WATCHES;
+static u32          g_DRV_VBLS            = 0;
+static struct Task *g_DRV_WORKER_TASK     = NULL;
+static i32          g_DRV_WORKER_SIGNAL   = 0;
+static u32          g_DRV_CHUNK_THRESHOLD = DRV_CHUNK_THRESHOLD;
+static u32          g_DRV_CHUNK_SIZE      = DRV_CHUNK_SIZE;
+
+/*
+  Only queued requests can be aborted. Everything else completes
+  before the dispatch returns. Whatever was moved before the abort is
+  left in io_Actual.
+*/
+static
+void
+drv_abortio(struct IOReq *ior_)
+{
+  RemNode((Node*)&ior_->io_Link);
+
+  ior_->io_Error = ABORTED;
+  SVC_MEM_STATS(svc_mem_stats_abort(ior_->io_Info.ioi_Unit));
+
+  SuperCompleteIO(ior_);
+}
 
 static
-void*
-get_rom2_base(void)
+Item
+drv_init(struct Driver *drv_)
 {
-  Err err;
-  void *rv;
+  svc_kprintf(SVC_MEM_DRV_NAME ": drv_init - opencnt=%d;\n",
+              drv_->drv_OpenCnt);
+
+  InitList(&g_DRV_QUEUE,"svc-mem-queue");
+  InitList(&g_DRV_WAITS,"svc-mem-waits");
+  InitList(&g_DRV_SAMPLERS,"svc-mem-samplers");
+  InitList(&g_DRV_WATCHES,"svc-mem-watches");
+
+  return drv_->drv.n_Item;
+}
+
+void
+svc_mem_drv_set_worker(struct Task *task_,
+                       i32          signal_)
+{
+  g_DRV_WORKER_TASK   = task_;
+  g_DRV_WORKER_SIGNAL = signal_;
+}
+
+Err
+svc_mem_drv_drain(Item ioreq_)
+{
+  IOInfo ioi = {0};
+
+  ioi.ioi_Command    = SVC_MEM_CMD_WORK;
+  ioi.ioi_CmdOptions = SVC_MEM_WORK_DRAIN;
+
+  return DoIO(ioreq_,&ioi);
+}
+
+/*
+  log2 of the element size of a request.
+*/
+static
+i32
+drv_shift(const struct IOReq *ior_)
+{
+  if(ior_->io_Info.ioi_Command == SVC_MEM_CMD_SPORT)
+    return DRV_SPORT_PAGE_SHIFT;
+  if((ior_->io_Info.ioi_CmdOptions & SVC_MEM_CMD_FLAG_WORDS) ||
+     (ior_->io_Info.ioi_Command == SVC_MEM_CMD_CAPTURE) ||
+     (ior_->io_Info.ioi_Command == SVC_MEM_CMD_DELTA))
+    return 2;
+  if(ior_->io_Info.ioi_CmdOptions & SVC_MEM_CMD_FLAG_HALFWORDS)
+    return 1;
+
+  return 0;
+}
+
+static
+u32
+drv_bytes(const struct IOReq *ior_,
+          const i32           len_)
+{
+  return ((u32)len_ << drv_shift(ior_));
+}
+
+/*
+  Length in elements of a request the driver may chunk.
+*/
+static
+i32
+drv_len(const struct IOReq *ior_)
+{
+  switch(ior_->io_Info.ioi_Command)
+    {
+    case CMD_WRITE:
+    case SVC_MEM_CMD_COPY:
+    case SVC_MEM_CMD_CHECKSUM:
+      return ior_->io_Info.ioi_Send.iob_Len;
+    case SVC_MEM_CMD_SEARCH:
+      return ((const svc_mem_search_t*)ior_->io_Info.ioi_Send.iob_Buffer)->len;
+    case SVC_MEM_CMD_DIFF:
+      return ((const svc_mem_diff_t*)ior_->io_Info.ioi_Send.iob_Buffer)->len;
+    case SVC_MEM_CMD_DELTA:
+      return ((const svc_mem_delta_t*)ior_->io_Info.ioi_Send.iob_Buffer)->len;
+    case SVC_MEM_CMD_CAPTURE:
+      return SVC_MEM_CAPTURE_WORDS(SVC_MEM_CAPTURE_WIDTH(ior_->io_Info.ioi_User),
+                                   SVC_MEM_CAPTURE_HEIGHT(ior_->io_Info.ioi_User));
+    }
+
+  return ior_->io_Info.ioi_Recv.iob_Len;
+}
+
+/*
+  Non-zero for SPORT requests, which the svc_mem task runs in
+  vertical blanks.
+*/
+static
+i32
+drv_vbl(const struct IOReq *ior_)
+{
+  return ((ior_->io_Info.ioi_Command == SVC_MEM_CMD_SPORT) &&
+          !(ior_->io_Info.ioi_CmdOptions & SVC_MEM_CMD_FLAG_CPU));
+}
+
+static
+void
+drv_queue(List         *list_,
+          struct IOReq *ior_)
+{
+  ior_->io_Actual  = 0;
+  ior_->io_Flags  &= ~IO_QUICK;
+  AddTail(list_,(Node*)&ior_->io_Link);
+  SuperInternalSignal(g_DRV_WORKER_TASK,g_DRV_WORKER_SIGNAL);
+}
+
+/*
+  Returns non-zero if the request was handed to the svc_mem task, in
+  which case io_Actual tracks progress in elements.
+*/
+static
+i32
+drv_defer(struct IOReq *ior_,
+          const i32     len_)
+{
+  u32 bytes;
+
+  bytes = drv_bytes(ior_,len_);
+  if((bytes <= g_DRV_CHUNK_THRESHOLD) || (g_DRV_CHUNK_THRESHOLD == 0))
+    return 0;
+  if(g_DRV_WORKER_TASK == NULL)
+    return 0;
+  if(!svc_mem_unit_chunkable(ior_->io_Info.ioi_Unit))
+    return 0;
+
+  drv_queue(&g_DRV_QUEUE,ior_);
+
+  return 1;
+}
+
+#define DRV_NO_ROM_BANK (-1)
+
+static
+i32
+drv_rom_bank_save(const struct IOReq *ior_)
+{
+  if(!(ior_->io_Info.ioi_CmdOptions & SVC_MEM_CMD_FLAG_ROM_RESTORE))
+    return DRV_NO_ROM_BANK;
+
+  return svc_mem_unit_rom_bank_get();
+}
+
+static
+void
+drv_rom_bank_restore(const i32 bank_)
+{
+  if(bank_ == DRV_NO_ROM_BANK)
+    return;
+
+  svc_mem_unit_rom_bank_set(bank_);
+}
+
+/*
+  Reads / writes `len_` elements between the request's buffer, `boff_`
+  elements in, and the unit at offset `uoff_`.
+*/
+typedef Err (*drv_span_fn)(const struct IOReq *ior, i32 boff, i32 uoff, i32 len);
 
-  err = svc_QuerySysInfo(SYSINFO_TAG_ROM2BASE,&rv,sizeof(rv));
+static
+Err
+drv_read_span(const struct IOReq *ior_,
+              const i32           boff_,
+              const i32           uoff_,
+              const i32           len_)
+{
+  i32 in_words;
+  u8 *dst;
+  const IOInfo *ioi;
+
+  ioi      = &ior_->io_Info;
+  in_words = !!(ioi->ioi_CmdOptions & SVC_MEM_CMD_FLAG_WORDS);
+  dst      = ((u8*)ioi->ioi_Recv.iob_Buffer + (boff_ << (in_words ? 2 : 0)));
+
+  if(ioi->ioi_CmdOptions & SVC_MEM_CMD_FLAG_FAULTMAP)
+    return svc_mem_unit_read_faults(ioi->ioi_Unit,
+                                    in_words,
+                                    uoff_,
+                                    dst,
+                                    len_,
+                                    ioi->ioi_User,
+                                    (u32*)ioi->ioi_Send.iob_Buffer,
+                                    boff_,
+                                    NULL);
+
+  return svc_mem_unit_read(ioi->ioi_Unit,
+                           in_words,
+                           ioi->ioi_Send.iob_Buffer,
+                           uoff_,
+                           dst,
+                           len_);
+}
 
-  return rv;
+static
+Err
+drv_write_span(const struct IOReq *ior_,
+               const i32           boff_,
+               const i32           uoff_,
+               const i32           len_)
+{
+  i32 in_words;
+  const u8 *src;
+  const IOInfo *ioi;
+
+  ioi      = &ior_->io_Info;
+  in_words = !!(ioi->ioi_CmdOptions & SVC_MEM_CMD_FLAG_WORDS);
+  src      = ((const u8*)ioi->ioi_Send.iob_Buffer + (boff_ << (in_words ? 2 : 0)));
+
+  return svc_mem_unit_write(ioi->ioi_Unit,
+                            in_words,
+                            src,
+                            len_,
+                            ioi->ioi_Recv.iob_Buffer,
+                            uoff_);
 }
 
+/*
+  With SVC_MEM_CMD_FLAG_RECT the buffer holds the rows packed and each
+  is moved on its own, a chunk possibly starting or ending mid row.
+*/
 static
 Err
-set_rom_bank1(void)
+drv_rect(const struct IOReq *ior_,
+         i32                 done_,
+         const i32           len_,
+         drv_span_fn         fn_)
 {
   Err err;
+  i32 n;
+  i32 row;
+  i32 col;
+  i32 end;
+  i32 stride;
+  i32 row_len;
+
+  row_len = SVC_MEM_RECT_ROW_LEN(ior_->io_Info.ioi_User);
+  stride  = SVC_MEM_RECT_STRIDE(ior_->io_Info.ioi_User);
+  if(row_len == 0)
+    return BADSIZE;
+
+  for(end = (done_ + len_); done_ < end; done_ += n)
+    {
+      row = (done_ / row_len);
+      col = (done_ - (row * row_len));
+      n   = (row_len - col);
+      if(n > (end - done_))
+        n = (end - done_);
 
-  err = svc_SetSysInfo(SYSINFO_TAG_SETROMBANK,(void*)SYSINFO_ROMBANK1,0);
+      err = fn_(ior_,done_,ior_->io_Info.ioi_Offset + (row * stride) + col,n);
+      if(err)
+        return err;
+    }
 
-  return err;
+  return 0;
 }
 
+/*
+  Checks the first and last rows of a SVC_MEM_CMD_FLAG_RECT request
+  against the unit before anything is moved. Strides aren't negative
+  so the rows in between fall within them.
+*/
 static
 Err
-set_rom_bank2(void)
+drv_rect_check(const struct IOReq *ior_,
+               const i32           len_)
 {
   Err err;
+  u32 rows;
+  u32 last;
+  i32 stride;
+  i32 row_len;
+  i32 in_words;
+  const svc_mem_unit_t *unit;
+
+  if(!(ior_->io_Info.ioi_CmdOptions & SVC_MEM_CMD_FLAG_RECT))
+    return 0;
+
+  row_len  = SVC_MEM_RECT_ROW_LEN(ior_->io_Info.ioi_User);
+  stride   = SVC_MEM_RECT_STRIDE(ior_->io_Info.ioi_User);
+  in_words = !!(ior_->io_Info.ioi_CmdOptions & SVC_MEM_CMD_FLAG_WORDS);
+  if((row_len == 0) || (len_ < 0))
+    return BADSIZE;
+  if(len_ == 0)
+    return 0;
+
+  unit = svc_mem_unit_get(ior_->io_Info.ioi_Unit);
+  if(unit == NULL)
+    return BADUNIT;
+
+  err = svc_mem_unit_check(unit,in_words,ior_->io_Info.ioi_Offset,
+                           ((len_ < row_len) ? len_ : row_len));
+  if(err)
+    return err;
+
+  rows = (((u32)len_ + row_len - 1) / (u32)row_len);
+  if((stride > 0) &&
+     ((rows - 1) > ((0x7FFFFFFF - (u32)ior_->io_Info.ioi_Offset) / (u32)stride)))
+    return BADPTR;
+
+  last = ((u32)ior_->io_Info.ioi_Offset + ((rows - 1) * (u32)stride));
+
+  return svc_mem_unit_check(unit,in_words,(i32)last,len_ - (i32)((rows - 1) * row_len));
+}
 
-  err = svc_SetSysInfo(SYSINFO_TAG_SETROMBANK,(void*)SYSINFO_ROMBANK2,0);
+/*
+  Reads / writes `len_` elements of a CMD_READ / CMD_WRITE request
+  starting `done_` elements in. Used directly and per chunk.
+*/
+static
+Err
+drv_read(const struct IOReq *ior_,
+         const i32           done_,
+         const i32           len_)
+{
+  if(ior_->io_Info.ioi_CmdOptions & SVC_MEM_CMD_FLAG_RECT)
+    return drv_rect(ior_,done_,len_,drv_read_span);
 
-  return err;
+  return drv_read_span(ior_,done_,ior_->io_Info.ioi_Offset + done_,len_);
 }
 
 static
-void
-drv_abortio(struct IOReq *ior_)
+Err
+drv_write(const struct IOReq *ior_,
+          const i32           done_,
+          const i32           len_)
 {
-  (void)ior_;
+  if(ior_->io_Info.ioi_CmdOptions & SVC_MEM_CMD_FLAG_RECT)
+    return drv_rect(ior_,done_,len_,drv_write_span);
 
-  svc_kprintf(SVC_MEM_DRV_NAME ": drv_abortio\n");
+  return drv_write_span(ior_,done_,ior_->io_Info.ioi_Offset + done_,len_);
 }
 
+/*
+  With SVC_MEM_CMD_FLAG_FAULTMAP the Send buffer is the optional
+  fault map rather than a source so it is only accepted for units
+  that can fault. The map is cleared up front as chunked reads only
+  ever set bits.
+*/
 static
-Item
-drv_init(struct Driver *drv_)
+Err
+drv_faultmap_clear(const struct IOReq *ior_)
 {
-  svc_kprintf(SVC_MEM_DRV_NAME ": drv_init - opencnt=%d;\n",
-              drv_->drv_OpenCnt);
+  u32 *map;
+  i32  words;
+  const svc_mem_unit_t *unit;
 
-  return drv_->drv.n_Item;
+  unit = svc_mem_unit_get(ior_->io_Info.ioi_Unit);
+  if((unit == NULL) || !(unit->flags & SVC_MEM_UNIT_FLAG_FAULTS))
+    return BADUNIT;
+
+  map   = (u32*)ior_->io_Info.ioi_Send.iob_Buffer;
+  words = SVC_MEM_FAULTMAP_WORDS(ior_->io_Info.ioi_Recv.iob_Len);
+  if(map == NULL)
+    return 0;
+  if(ior_->io_Info.ioi_Send.iob_Len < words)
+    return BADSIZE;
+
+  memset(map,0,words * sizeof(u32));
+
+  return 0;
 }
 
 static
-i32
-drv_cmdwrite_u32(const void *src_,
-                 const i32   len_,
-                 void       *dst_,
-                 const i32   offset_)
+Err
+drv_fill(const struct IOReq *ior_,
+         const i32           done_,
+         const i32           len_)
 {
-  i32 i;
-  const u32 *src = (const u32*)src_;
-  u32       *dst = (u32*)dst_;
+  const IOInfo *ioi;
 
-  dst += offset_;
-  for(i = 0; i < len_; i++)
-    dst[i] = src[i];
+  ioi = &ior_->io_Info;
 
-  return 1;
+  return svc_mem_unit_fill(ioi->ioi_Unit,
+                           drv_shift(ior_),
+                           ioi->ioi_Recv.iob_Buffer,
+                           ioi->ioi_Offset + done_,
+                           len_,
+                           ioi->ioi_User);
 }
 
+/*
+  A copy whose destination overlaps its source from above is done
+  from the end, chunks included, so nothing is overwritten before it
+  has been read.
+*/
 static
-i32
-drv_cmdwrite_u8(const void *src_,
-                const i32   len_,
-                void       *dst_,
-                const i32   offset_)
+Err
+drv_copy(const struct IOReq *ior_,
+         const i32           done_,
+         const i32           len_)
 {
-  i32 i;
-  const u8 *src = (const u8*)src_;
-  u8       *dst = (u8*)dst_;
+  u8 sunit;
+  i32 first;
+  i32 in_words;
+  const IOInfo *ioi;
+
+  ioi      = &ior_->io_Info;
+  in_words = !!(ioi->ioi_CmdOptions & SVC_MEM_CMD_FLAG_WORDS);
+  sunit    = SVC_MEM_CMD_COPY_SRC_UNIT(ioi->ioi_CmdOptions);
+  first    = done_;
+  if(svc_mem_unit_copy_backward(ioi->ioi_Unit,
+                                ioi->ioi_Recv.iob_Buffer,
+                                ioi->ioi_Offset,
+                                sunit,
+                                ioi->ioi_Send.iob_Buffer,
+                                (i32)ioi->ioi_User,
+                                in_words,
+                                ioi->ioi_Send.iob_Len))
+    first = (ioi->ioi_Send.iob_Len - done_ - len_);
+
+  return svc_mem_unit_copy(ioi->ioi_Unit,
+                           ioi->ioi_Recv.iob_Buffer,
+                           ioi->ioi_Offset + first,
+                           sunit,
+                           ioi->ioi_Send.iob_Buffer,
+                           (i32)ioi->ioi_User + first,
+                           in_words,
+                           len_);
+}
+
+/*
+  The running digest is kept in the caller's Recv buffer between
+  chunks.
+*/
+static
+Err
+drv_checksum(const struct IOReq *ior_,
+             const i32           done_,
+             const i32           len_)
+{
+  const IOInfo *ioi;
 
-  dst += offset_;
-  for(i = 0; i < len_; i++)
-    dst[i] = src[i];
+  ioi = &ior_->io_Info;
 
-  return 1;
+  return svc_mem_unit_checksum(ioi->ioi_Unit,
+                               !!(ioi->ioi_CmdOptions & SVC_MEM_CMD_FLAG_WORDS),
+                               ioi->ioi_Send.iob_Buffer,
+                               ioi->ioi_Offset + done_,
+                               len_,
+                               SVC_MEM_CMD_CHECKSUM_ALGO_ID(ioi->ioi_CmdOptions),
+                               (u32*)ioi->ioi_Recv.iob_Buffer);
 }
 
+/*
+  Each chunk also reads the pattern_len - 1 elements past it so
+  matches straddling chunks are found, and only once.
+*/
 static
-i32
-aligned(const void *p0_,
-        const void *p1_)
+Err
+drv_search(const struct IOReq *ior_,
+           const i32           done_,
+           const i32           len_)
 {
-  return ((((u32)p0_ | (u32)p1_) & 0x3) == 0);
+  i32 n;
+  const IOInfo *ioi;
+  svc_mem_search_t *desc;
+
+  ioi  = &ior_->io_Info;
+  desc = (svc_mem_search_t*)ioi->ioi_Send.iob_Buffer;
+  n    = (desc->len - done_);
+  if(n > (len_ + desc->pattern_len - 1))
+    n = (len_ + desc->pattern_len - 1);
+
+  return svc_mem_unit_search(ioi->ioi_Unit,
+                             !!(ioi->ioi_CmdOptions & SVC_MEM_CMD_FLAG_WORDS),
+                             desc->src,
+                             ioi->ioi_Offset + done_,
+                             n,
+                             desc,
+                             (i32*)ioi->ioi_Recv.iob_Buffer,
+                             ioi->ioi_Recv.iob_Len,
+                             &desc->hits);
+}
+
+static
+Err
+drv_diff(const struct IOReq *ior_,
+         const i32           done_,
+         const i32           len_)
+{
+  i32 in_words;
+  const IOInfo *ioi;
+  svc_mem_diff_t *desc;
+
+  ioi      = &ior_->io_Info;
+  desc     = (svc_mem_diff_t*)ioi->ioi_Send.iob_Buffer;
+  in_words = !!(ioi->ioi_CmdOptions & SVC_MEM_CMD_FLAG_WORDS);
+
+  return svc_mem_unit_diff(ioi->ioi_Unit,
+                           in_words,
+                           desc->src,
+                           ioi->ioi_Offset + done_,
+                           len_,
+                           (const u8*)desc->ref + (done_ << (in_words ? 2 : 0)),
+                           desc,
+                           (svc_mem_diff_run_t*)ioi->ioi_Recv.iob_Buffer,
+                           ioi->ioi_Recv.iob_Len);
+}
+
+static
+Err
+drv_capture(const struct IOReq *ior_,
+            const i32           done_,
+            const i32           len_)
+{
+  const IOInfo *ioi;
+
+  ioi = &ior_->io_Info;
+
+  return svc_mem_unit_capture(ioi->ioi_Unit,
+                              ioi->ioi_Send.iob_Buffer,
+                              ioi->ioi_Offset,
+                              SVC_MEM_CAPTURE_WIDTH(ioi->ioi_User),
+                              SVC_MEM_CAPTURE_HEIGHT(ioi->ioi_User),
+                              done_,
+                              len_,
+                              (u16*)ioi->ioi_Recv.iob_Buffer,
+                              ioi->ioi_CmdOptions);
+}
+
+/*
+  Pages of a copy to higher pages it overlaps are done from the end,
+  chunks included, like drv_copy.
+*/
+static
+Err
+drv_sport(const struct IOReq *ior_,
+          const i32           done_,
+          const i32           len_,
+          const i32           cpu_)
+{
+  u8 op;
+  u32 arg;
+  i32 len;
+  i32 first;
+  const IOInfo *ioi;
+
+  ioi   = &ior_->io_Info;
+  op    = SVC_MEM_CMD_SPORT_OP_ID(ioi->ioi_CmdOptions);
+  arg   = ioi->ioi_User;
+  len   = ioi->ioi_Recv.iob_Len;
+  first = done_;
+  if(op == SVC_MEM_SPORT_OP_COPY)
+    {
+      if((ioi->ioi_Offset > (i32)arg) &&
+         (ioi->ioi_Offset < ((i32)arg + (len << DRV_SPORT_PAGE_SHIFT))))
+        first = (len - done_ - len_);
+      arg += (first << DRV_SPORT_PAGE_SHIFT);
+    }
+
+  return svc_mem_unit_sport(op,
+                            ioi->ioi_Offset + (first << DRV_SPORT_PAGE_SHIFT),
+                            arg,
+                            len_,
+                            cpu_);
 }
 
 static
 i32
 drv_cmdwrite(struct IOReq *ior_)
 {
-  const void *src;
-  void       *dst;
-  i32         offset;
-  i32         offset_in_bytes;
-  i32         len;
-  i32         in_words;
+  SVC_MEM_STATS(svc_mem_stats_request(ior_->io_Info.ioi_Unit,
+                                      drv_bytes(ior_,ior_->io_Info.ioi_Send.iob_Len)));
 
-  src             = ior_->io_Info.ioi_Send.iob_Buffer;
-  len             = ior_->io_Info.ioi_Send.iob_Len;
-  in_words        = !!(ior_->io_Info.ioi_CmdOptions & SVC_MEM_CMD_FLAG_WORDS);
-  offset          = ior_->io_Info.ioi_Offset;
-  offset_in_bytes = (offset * (in_words ? sizeof(u32) : sizeof(u8)));
+  ior_->io_Error = drv_rect_check(ior_,ior_->io_Info.ioi_Send.iob_Len);
+  if(ior_->io_Error)
+    return 1;
 
-  ior_->io_Actual = len;
+  if(drv_defer(ior_,ior_->io_Info.ioi_Send.iob_Len))
+    return 0;
 
-  switch(ior_->io_Info.ioi_Unit)
-    {
-    case SVC_MEM_UNIT_NONE:
-      dst = ior_->io_Info.ioi_Recv.iob_Buffer;
+  ior_->io_Error  = drv_write(ior_,0,ior_->io_Info.ioi_Send.iob_Len);
+  ior_->io_Actual = (ior_->io_Error ? 0 : ior_->io_Info.ioi_Send.iob_Len);
 
-      if(in_words && !aligned(src,dst))
-        ior_->io_Error = BADPTR;
-      if(ior_->io_Error)
-        return 1;
+  return 1;
+}
 
-      if(in_words)
-        return drv_cmdwrite_u32(src,len,dst,offset);
-      return drv_cmdwrite_u8(src,len,dst,offset);
+static
+i32
+drv_cmdread(struct IOReq *ior_)
+{
+  i32 rom_bank;
 
-    case SVC_MEM_UNIT_DRAM:
-      dst = (void*)DRAM_START_ADDR;
+  SVC_MEM_STATS(svc_mem_stats_request(ior_->io_Info.ioi_Unit,
+                                      drv_bytes(ior_,ior_->io_Info.ioi_Recv.iob_Len)));
 
-      if((offset_in_bytes + len) > DRAM_SIZE)
-        ior_->io_Error = BADPTR;
-      if(in_words && !aligned(src,dst))
-        ior_->io_Error = BADPTR;
+  if(ior_->io_Info.ioi_CmdOptions & SVC_MEM_CMD_FLAG_FAULTMAP)
+    {
+      if(ior_->io_Info.ioi_CmdOptions & SVC_MEM_CMD_FLAG_RECT)
+        {
+          ior_->io_Error = NOSUPPORT;
+          return 1;
+        }
+      ior_->io_Error = drv_faultmap_clear(ior_);
       if(ior_->io_Error)
         return 1;
+    }
 
-      if(in_words)
-        return drv_cmdwrite_u32(src,len,dst,offset);
-      return drv_cmdwrite_u8(src,len,dst,offset);
+  ior_->io_Error = drv_rect_check(ior_,ior_->io_Info.ioi_Recv.iob_Len);
+  if(ior_->io_Error)
+    return 1;
 
-    case SVC_MEM_UNIT_VRAM:
-      dst = (void*)VRAM_START_ADDR;
+  if(drv_defer(ior_,ior_->io_Info.ioi_Recv.iob_Len))
+    return 0;
 
-      if((offset_in_bytes + len) > VRAM_SIZE)
-        ior_->io_Error = BADPTR;
-      if(in_words && !aligned(src,dst))
-        ior_->io_Error = BADPTR;
-      if(ior_->io_Error)
-        return 1;
+  rom_bank = drv_rom_bank_save(ior_);
 
-      if(in_words)
-        return drv_cmdwrite_u32(src,len,dst,offset);
-      return drv_cmdwrite_u8(src,len,dst,offset);
+  ior_->io_Error  = drv_read(ior_,0,ior_->io_Info.ioi_Recv.iob_Len);
+  ior_->io_Actual = (ior_->io_Error ? 0 : ior_->io_Info.ioi_Recv.iob_Len);
 
-    case SVC_MEM_UNIT_ROM1:
-    case SVC_MEM_UNIT_ROM2:
-      ior_->io_Error = NOSUPPORT;
-      return 1;
+  drv_rom_bank_restore(rom_bank);
 
-    case SVC_MEM_UNIT_NVRAM:
-      // TODO create dedicated write to nvram function
-      ior_->io_Error = NOSUPPORT;
+  return 1;
+}
+
+static
+i32
+drv_cmdfill(struct IOReq *ior_)
+{
+  SVC_MEM_STATS(svc_mem_stats_request(ior_->io_Info.ioi_Unit,
+                                      drv_bytes(ior_,ior_->io_Info.ioi_Recv.iob_Len)));
+
+  if((ior_->io_Info.ioi_CmdOptions & SVC_MEM_CMD_FLAG_WORDS) &&
+     (ior_->io_Info.ioi_CmdOptions & SVC_MEM_CMD_FLAG_HALFWORDS))
+    {
+      ior_->io_Error = BADSIZE;
       return 1;
-      dst = (void*)NVRAM_START_ADDR;
-
-      if(in_words)
-        ior_->io_Error = BADSIZE;
-      if(in_words && !aligned(src,dst))
-        ior_->io_Error = BADPTR;
-      if((offset_in_bytes + len) > NVRAM_SIZE)
-        ior_->io_Error = BADPTR;
-      if(ior_->io_Error)
-        return 1;
-      break;
+    }
 
-    case SVC_MEM_UNIT_MADAM:
-      dst = (void*)MADAM_START_ADDR;
+  if(drv_defer(ior_,ior_->io_Info.ioi_Recv.iob_Len))
+    return 0;
 
-      if(!in_words)
-        ior_->io_Error = BADSIZE;
-      if(!aligned(src,dst))
-        ior_->io_Error = BADPTR;
-      if((offset_in_bytes + len) > MADAM_SIZE)
-        ior_->io_Error = BADPTR;
-      if(ior_->io_Error)
-        return 1;
-      return drv_cmdwrite_u32(src,len,dst,offset);
+  ior_->io_Error  = drv_fill(ior_,0,ior_->io_Info.ioi_Recv.iob_Len);
+  ior_->io_Actual = (ior_->io_Error ? 0 : ior_->io_Info.ioi_Recv.iob_Len);
 
-    case SVC_MEM_UNIT_CLIO:
-      dst = (void*)CLIO_START_ADDR;
+  return 1;
+}
 
-      if(!in_words)
-        ior_->io_Error = BADSIZE;
-      if(!aligned(src,dst))
-        ior_->io_Error = BADPTR;
-      if((offset_in_bytes + len) > CLIO_SIZE)
-        ior_->io_Error = BADPTR;
-      if(ior_->io_Error)
-        return 1;
-      return drv_cmdwrite_u32(src,len,dst,offset);
+static
+i32
+drv_cmdcopy(struct IOReq *ior_)
+{
+  i32 rom_bank;
 
-    case SVC_MEM_UNIT_SPORT:
-      dst = (void*)SPORT_START_ADDR;
+  SVC_MEM_STATS(svc_mem_stats_request(ior_->io_Info.ioi_Unit,
+                                      drv_bytes(ior_,ior_->io_Info.ioi_Send.iob_Len)));
 
-      if(!in_words)
-        ior_->io_Error = BADSIZE;
-      if(!aligned(src,dst))
-        ior_->io_Error = BADPTR;
-      if((offset_in_bytes + len) > SPORT_SIZE)
-        ior_->io_Error = BADPTR;
-      if(ior_->io_Error)
-        return 1;
-      return drv_cmdwrite_u32(src,len,dst,offset);
+  if(ior_->io_Info.ioi_CmdOptions & SVC_MEM_CMD_FLAG_HALFWORDS)
+    {
+      ior_->io_Error = BADSIZE;
+      return 1;
     }
 
-  ior_->io_Error = BADUNIT;
+  if(svc_mem_unit_chunkable(SVC_MEM_CMD_COPY_SRC_UNIT(ior_->io_Info.ioi_CmdOptions)) &&
+     drv_defer(ior_,ior_->io_Info.ioi_Send.iob_Len))
+    return 0;
+
+  rom_bank = drv_rom_bank_save(ior_);
+
+  ior_->io_Error  = drv_copy(ior_,0,ior_->io_Info.ioi_Send.iob_Len);
+  ior_->io_Actual = (ior_->io_Error ? 0 : ior_->io_Info.ioi_Send.iob_Len);
+
+  drv_rom_bank_restore(rom_bank);
+
   return 1;
 }
 
 static
 i32
-drv_cmdread_u32(const void *src_,
-                const i32   offset_,
-                void       *dst_,
-                const i32   len_)
+drv_cmdchecksum(struct IOReq *ior_)
 {
-  i32 i;
-  const u32 *src = (const u32*)src_;
-  u32       *dst = (u32*)dst_;
+  i32 rom_bank;
+  u32 *digest;
 
-  src += offset_;
-  for(i = 0; i < len_; i++)
-    dst[i]  = src[i];
+  SVC_MEM_STATS(svc_mem_stats_request(ior_->io_Info.ioi_Unit,
+                                      drv_bytes(ior_,ior_->io_Info.ioi_Send.iob_Len)));
+
+  digest = (u32*)ior_->io_Info.ioi_Recv.iob_Buffer;
+  if((digest == NULL) || ((u32)digest & 0x3))
+    {
+      ior_->io_Error = BADPTR;
+      return 1;
+    }
+  if((ior_->io_Info.ioi_Recv.iob_Len < (i32)sizeof(u32)) ||
+     (ior_->io_Info.ioi_CmdOptions & SVC_MEM_CMD_FLAG_HALFWORDS))
+    {
+      ior_->io_Error = BADSIZE;
+      return 1;
+    }
+
+  *digest = ior_->io_Info.ioi_User;
+
+  if(drv_defer(ior_,ior_->io_Info.ioi_Send.iob_Len))
+    return 0;
+
+  rom_bank = drv_rom_bank_save(ior_);
+
+  ior_->io_Error  = drv_checksum(ior_,0,ior_->io_Info.ioi_Send.iob_Len);
+  ior_->io_Actual = (ior_->io_Error ? 0 : ior_->io_Info.ioi_Send.iob_Len);
+
+  drv_rom_bank_restore(rom_bank);
 
   return 1;
 }
 
 static
 i32
-drv_cmdread_u8(const void *src_,
-               const i32   offset_,
-               void       *dst_,
-               const i32   len_)
+drv_cmdsearch(struct IOReq *ior_)
 {
-  i32 i;
-  const u8 *src = (const u8*)src_;
-  u8       *dst = (u8*)dst_;
+  i32 rom_bank;
+  svc_mem_search_t *desc;
+
+  desc = (svc_mem_search_t*)ior_->io_Info.ioi_Send.iob_Buffer;
+  if((desc == NULL) ||
+     ((ior_->io_Info.ioi_Recv.iob_Buffer == NULL) && (ior_->io_Info.ioi_Recv.iob_Len > 0)))
+    {
+      ior_->io_Error = BADPTR;
+      return 1;
+    }
 
-  src += offset_;
-  for(i = 0; i < len_; i++)
-    dst[i] = src[i];
+  SVC_MEM_STATS(svc_mem_stats_request(ior_->io_Info.ioi_Unit,drv_bytes(ior_,desc->len)));
+
+  if(ior_->io_Info.ioi_CmdOptions & SVC_MEM_CMD_FLAG_HALFWORDS)
+    {
+      ior_->io_Error = BADSIZE;
+      return 1;
+    }
+
+  desc->hits = 0;
+
+  if(drv_defer(ior_,desc->len))
+    return 0;
+
+  rom_bank = drv_rom_bank_save(ior_);
+
+  ior_->io_Error  = drv_search(ior_,0,desc->len);
+  ior_->io_Actual = (ior_->io_Error ? 0 : desc->len);
+
+  drv_rom_bank_restore(rom_bank);
 
   return 1;
 }
 
 static
 i32
-drv_cmdread_u8_per_u32_aborts(const void *src_,
-                              const i32   offset_,
-                              void       *dst_,
-                              const i32   len_)
+drv_cmddiff(struct IOReq *ior_)
 {
-  const u32 *src;
-  u8 *dst;
-  jmp_buf jmpbuf;
-  jmp_buf *old_catchdataaborts;
-  u32 old_quietaborts;
-  volatile i32 i;
+  i32 rom_bank;
+  svc_mem_diff_t *desc;
 
-  old_catchdataaborts = KernelBase->kb_CatchDataAborts;
-  old_quietaborts     = KernelBase->kb_QuietAborts;
+  desc = (svc_mem_diff_t*)ior_->io_Info.ioi_Send.iob_Buffer;
+  if((desc == NULL) ||
+     ((ior_->io_Info.ioi_Recv.iob_Buffer == NULL) && (ior_->io_Info.ioi_Recv.iob_Len > 0)))
+    {
+      ior_->io_Error = BADPTR;
+      return 1;
+    }
 
-  i   = 0;
-  src = (const u32*)src_;
-  src = &src[offset_];
-  dst = (u8*)dst_;
+  SVC_MEM_STATS(svc_mem_stats_request(ior_->io_Info.ioi_Unit,drv_bytes(ior_,desc->len)));
 
- catch_abort:
+  if(ior_->io_Info.ioi_CmdOptions & SVC_MEM_CMD_FLAG_HALFWORDS)
+    {
+      ior_->io_Error = BADSIZE;
+      return 1;
+    }
 
-  KernelBase->kb_CatchDataAborts = &jmpbuf;
-  KernelBase->kb_QuietAborts     =  ABT_ROMF;
+  desc->runs     = 0;
+  desc->overflow = 0;
 
-  if(setjmp(jmpbuf))
-    goto catch_abort;
+  if(drv_defer(ior_,desc->len))
+    return 0;
 
-  for(; i < len_; i++)
-    dst[i] = (u8)(src[i] & 0xFF);
+  rom_bank = drv_rom_bank_save(ior_);
 
-  KernelBase->kb_CatchDataAborts = old_catchdataaborts;
-  KernelBase->kb_QuietAborts     = old_quietaborts;
+  ior_->io_Error  = drv_diff(ior_,0,desc->len);
+  ior_->io_Actual = (ior_->io_Error ? 0 : desc->len);
+
+  drv_rom_bank_restore(rom_bank);
 
   return 1;
 }
 
+static
+Err
+drv_delta(const struct IOReq *ior_,
+          const i32           done_,
+          const i32           len_)
+{
+  const IOInfo *ioi;
+
+  ioi = &ior_->io_Info;
+
+  return svc_mem_unit_delta(ioi->ioi_Unit,
+                            ioi->ioi_Recv.iob_Buffer,
+                            ioi->ioi_Offset,
+                            (svc_mem_delta_t*)ioi->ioi_Send.iob_Buffer,
+                            done_,
+                            len_);
+}
+
 static
 i32
-drv_cmdread_u8_aborts(const void *src_,
-                      const i32   offset_,
-                      void       *dst_,
-                      const i32   len_)
+drv_cmddelta(struct IOReq *ior_)
 {
-  const u8 *src;
-  u8 *dst;
-  jmp_buf jmpbuf;
-  jmp_buf *old_catchdataaborts;
-  u32   old_quietaborts;
-  volatile i32 i;
+  svc_mem_delta_t *desc;
 
-  old_catchdataaborts = KernelBase->kb_CatchDataAborts;
-  old_quietaborts     = KernelBase->kb_QuietAborts;
+  desc = (svc_mem_delta_t*)ior_->io_Info.ioi_Send.iob_Buffer;
+  if(desc == NULL)
+    {
+      ior_->io_Error = BADPTR;
+      return 1;
+    }
 
-  i   = 0;
-  src = (const u8*)src_;
-  src = &src[offset_];
-  dst = (u8*)dst_;
+  SVC_MEM_STATS(svc_mem_stats_request(ior_->io_Info.ioi_Unit,(u32)desc->len << 2));
 
- catch_abort:
+  if(desc->len < 0)
+    {
+      ior_->io_Error = BADSIZE;
+      return 1;
+    }
 
-  KernelBase->kb_CatchDataAborts = &jmpbuf;
-  KernelBase->kb_QuietAborts     =  ABT_ROMF;
+  desc->written = 0;
+  if(drv_defer(ior_,desc->len))
+    return 0;
 
-  if(setjmp(jmpbuf))
-    goto catch_abort;
+  ior_->io_Error  = drv_delta(ior_,0,desc->len);
+  ior_->io_Actual = (ior_->io_Error ? 0 : desc->len);
+
+  return 1;
+}
+
+static
+i32
+drv_cmdcapture(struct IOReq *ior_)
+{
+  i32 len;
+  i32 width;
+  i32 height;
+
+  width  = SVC_MEM_CAPTURE_WIDTH(ior_->io_Info.ioi_User);
+  height = SVC_MEM_CAPTURE_HEIGHT(ior_->io_Info.ioi_User);
+  len    = SVC_MEM_CAPTURE_WORDS(width,height);
+
+  SVC_MEM_STATS(svc_mem_stats_request(ior_->io_Info.ioi_Unit,(u32)len << 2));
+
+  if(ior_->io_Info.ioi_Recv.iob_Buffer == NULL)
+    {
+      ior_->io_Error = BADPTR;
+      return 1;
+    }
+  // 16 bit dimensions, the product can't wrap a u32
+  if((width == 0) ||
+     (height == 0) ||
+     (ior_->io_Info.ioi_Recv.iob_Len < 0) ||
+     ((u32)ior_->io_Info.ioi_Recv.iob_Len < ((u32)width * (u32)height)))
+    {
+      ior_->io_Error = BADSIZE;
+      return 1;
+    }
 
-  for(; i < len_; i++)
-    dst[i] = src[i];
+  if(drv_defer(ior_,len))
+    return 0;
 
-  KernelBase->kb_CatchDataAborts = old_catchdataaborts;
-  KernelBase->kb_QuietAborts     = old_quietaborts;
+  ior_->io_Error  = drv_capture(ior_,0,len);
+  ior_->io_Actual = (ior_->io_Error ? 0 : len);
 
   return 1;
 }
 
+/*
+  Without the svc_mem task there is nothing to wait for a vertical
+  blank with and the CPU does the job instead.
+*/
 static
 i32
-drv_cmdread_u32_aborts(const void *src_,
-                       const i32   offset_,
-                       void       *dst_,
-                       const i32   len_)
+drv_cmdsport(struct IOReq *ior_)
 {
-  volatile const u32 *src;
-  u32 *dst;
-  jmp_buf jmpbuf;
-  jmp_buf *old_catchdataaborts;
-  u32 old_quietaborts;
-  volatile i32 i;
+  i32 pages;
 
-  old_catchdataaborts = KernelBase->kb_CatchDataAborts;
-  old_quietaborts     = KernelBase->kb_QuietAborts;
+  pages = ior_->io_Info.ioi_Recv.iob_Len;
 
-  i   = 0;
-  src = (const u32*)src_;
-  src = &src[offset_];
-  dst = (u32*)dst_;
+  SVC_MEM_STATS(svc_mem_stats_request(ior_->io_Info.ioi_Unit,drv_bytes(ior_,pages)));
 
- catch_abort:
+  if(ior_->io_Info.ioi_Unit != SVC_MEM_UNIT_VRAM)
+    {
+      ior_->io_Error = BADUNIT;
+      return 1;
+    }
 
-  KernelBase->kb_CatchDataAborts = &jmpbuf;
-  KernelBase->kb_QuietAborts     =  ABT_ROMF;
+  ior_->io_Error = svc_mem_unit_sport_check(SVC_MEM_CMD_SPORT_OP_ID(ior_->io_Info.ioi_CmdOptions),
+                                            ior_->io_Info.ioi_Offset,
+                                            ior_->io_Info.ioi_User,
+                                            pages);
+  if(ior_->io_Error)
+    return 1;
 
-  if(setjmp(jmpbuf))
-    goto catch_abort;
+  if(drv_vbl(ior_) && (pages > 0) && (g_DRV_WORKER_TASK != NULL))
+    {
+      drv_queue(&g_DRV_QUEUE,ior_);
+      return 0;
+    }
 
-  for(; i < len_; i++)
-    dst[i] = src[i];
+  if(drv_defer(ior_,pages))
+    return 0;
 
-  KernelBase->kb_CatchDataAborts = old_catchdataaborts;
-  KernelBase->kb_QuietAborts     = old_quietaborts;
+  ior_->io_Error  = drv_sport(ior_,0,pages,1);
+  ior_->io_Actual = (ior_->io_Error ? 0 : pages);
 
   return 1;
 }
 
 static
 i32
-drv_cmdread(struct IOReq *ior_)
+drv_cmdrmw(struct IOReq *ior_)
 {
-  Err         err;
-  const void *src;
-  void       *dst;
-  i32         offset;
-  i32         offset_in_bytes;
-  i32         len;
-  i32         in_words;
+  i32 i;
+  i32 count;
+  i32 olds_len;
+  u32 old;
+  u32 state;
+  Err err;
+  u32 *olds;
+  const svc_mem_rmw_t *ents;
 
-  dst             = ior_->io_Info.ioi_Recv.iob_Buffer;
-  len             = ior_->io_Info.ioi_Recv.iob_Len;
-  in_words        = !!(ior_->io_Info.ioi_CmdOptions & SVC_MEM_CMD_FLAG_WORDS);
-  offset          = ior_->io_Info.ioi_Offset;
-  offset_in_bytes = (offset * (in_words ? sizeof(u32) : sizeof(u8)));
+  ents     = (const svc_mem_rmw_t*)ior_->io_Info.ioi_Send.iob_Buffer;
+  count    = ior_->io_Info.ioi_Send.iob_Len;
+  olds     = (u32*)ior_->io_Info.ioi_Recv.iob_Buffer;
+  olds_len = ((olds == NULL) ? 0 : ior_->io_Info.ioi_Recv.iob_Len);
 
-  ior_->io_Actual = len;
+  if(ents == NULL)
+    {
+      ior_->io_Error = BADPTR;
+      return 1;
+    }
+  if((count < 0) || (count > SVC_MEM_RMW_MAX))
+    {
+      ior_->io_Error = BADSIZE;
+      return 1;
+    }
 
-  switch(ior_->io_Info.ioi_Unit)
+  for(i = 0; i < count; i++)
     {
-    case SVC_MEM_UNIT_NONE:
-      src = ior_->io_Info.ioi_Send.iob_Buffer;
+      SVC_MEM_STATS(svc_mem_stats_request(ents[i].unit,sizeof(u32)));
+      err = svc_mem_unit_rmw_check(&ents[i]);
+      if(err)
+        {
+          ior_->io_Error = err;
+          return 1;
+        }
+    }
 
-      if(in_words && !aligned(src,dst))
-        ior_->io_Error = BADPTR;
+  state = Disable();
+  for(i = 0; i < count; i++)
+    {
+      old = 0;
+      svc_mem_unit_rmw(&ents[i],&old);
+      if(i < olds_len)
+        olds[i] = old;
+    }
+  Enable(state);
 
-      if(in_words)
-        return drv_cmdread_u32(src,offset,dst,len);
-      return drv_cmdread_u8(src,offset,dst,len);
+  ior_->io_Actual = count;
 
-    case SVC_MEM_UNIT_DRAM:
-      src = (void*)DRAM_START_ADDR;
+  return 1;
+}
 
-      if((offset_in_bytes + len) > DRAM_SIZE)
-        ior_->io_Error = BADPTR;
-      if(in_words && !aligned(src,dst))
-        ior_->io_Error = BADPTR;
-      if(ior_->io_Error)
-        return 1;
+static
+i32
+drv_cmdwait(struct IOReq *ior_)
+{
+  i32 i;
+  Err rv;
+  svc_mem_wait_t *desc;
 
-      if(in_words)
-        return drv_cmdread_u32(src,offset,dst,len);
-      return drv_cmdread_u8(src,offset,dst,len);
+  desc = (svc_mem_wait_t*)ior_->io_Info.ioi_Send.iob_Buffer;
+  if(desc == NULL)
+    {
+      ior_->io_Error = BADPTR;
+      return 1;
+    }
 
-    case SVC_MEM_UNIT_VRAM:
-      src = (void*)VRAM_START_ADDR;
+  SVC_MEM_STATS(svc_mem_stats_request(ior_->io_Info.ioi_Unit,sizeof(u32)));
 
-      if((offset_in_bytes + len) > VRAM_SIZE)
-        ior_->io_Error = BADPTR;
-      if(in_words && !aligned(src,dst))
-        ior_->io_Error = BADPTR;
-      if(ior_->io_Error)
-        return 1;
+  if((desc->spins > SVC_MEM_WAIT_MAX_SPINS) || (desc->timeout < 0))
+    {
+      ior_->io_Error = BADSIZE;
+      return 1;
+    }
+
+  desc->waited = 0;
+  i = 0;
+  do
+    {
+      rv = svc_mem_unit_poll(ior_->io_Info.ioi_Unit,ior_->io_Info.ioi_Offset,desc);
+    }
+  while((rv == 0) && (++i < desc->spins));
+
+  if(rv < 0)
+    {
+      ior_->io_Error = rv;
+      return 1;
+    }
+
+  if((rv == 0) && (desc->timeout > 0) && (g_DRV_WORKER_TASK != NULL))
+    {
+      drv_queue(&g_DRV_WAITS,ior_);
+      return 0;
+    }
 
-      if(in_words)
-        return drv_cmdread_u32(src,offset,dst,len);
-      return drv_cmdread_u8(src,offset,dst,len);
+  ior_->io_Actual = rv;
 
-    case SVC_MEM_UNIT_ROM1:
-      src = (void*)ROM1_START_ADDR;
+  return 1;
+}
 
-      err = set_rom_bank1();
+static
+Err
+drv_sample_check(const svc_mem_sample_t *desc_)
+{
+  i32 i;
+  Err err;
+  u32 word;
+  const svc_mem_ring_t *ring;
+
+  if((desc_->words == NULL) || (desc_->ring == NULL) || (desc_->ring->data == NULL))
+    return BADPTR;
+
+  ring = desc_->ring;
+  if((desc_->count <= 0) ||
+     (desc_->count > SVC_MEM_SAMPLE_MAX_WORDS) ||
+     (desc_->period <= 0) ||
+     (ring->size == 0) ||
+     (ring->size & (ring->size - 1)) ||
+     (ring->record_words != (u32)(desc_->count + 1)))
+    return BADSIZE;
+
+  for(i = 0; i < desc_->count; i++)
+    {
+      err = svc_mem_unit_word(desc_->words[i].unit,desc_->words[i].offset,&word);
       if(err)
-        ior_->io_Error = err;
-      if((offset_in_bytes + len) > ROM1_SIZE)
-        ior_->io_Error = BADPTR;
-      if(in_words && !aligned(src,dst))
-        ior_->io_Error = BADPTR;
-      if(ior_->io_Error)
-        return 1;
+        return err;
+    }
+
+  return 0;
+}
+
+static
+i32
+drv_cmdsample(struct IOReq *ior_)
+{
+  Err err;
+  const svc_mem_sample_t *desc;
+
+  desc = (const svc_mem_sample_t*)ior_->io_Info.ioi_Send.iob_Buffer;
+  if(desc == NULL)
+    {
+      ior_->io_Error = BADPTR;
+      return 1;
+    }
+
+  if(ior_->io_Info.ioi_Unit > SVC_MEM_UNIT_MAX)
+    {
+      ior_->io_Error = BADUNIT;
+      return 1;
+    }
+
+  if(g_DRV_WORKER_TASK == NULL)
+    {
+      ior_->io_Error = NOSUPPORT;
+      return 1;
+    }
+
+  err = drv_sample_check(desc);
+  if(err)
+    {
+      ior_->io_Error = err;
+      return 1;
+    }
+
+  drv_queue(&g_DRV_SAMPLERS,ior_);
 
-      if(in_words)
-        drv_cmdread_u32_aborts(src,offset,dst,len);
-      return drv_cmdread_u8_aborts(src,offset,dst,len);
+  return 0;
+}
+
+/*
+  Hashes every range, which also checks them, as the baseline.
+*/
+static
+Err
+drv_watch_init(svc_mem_watch_t *desc_)
+{
+  i32 i;
+  Err err;
+  svc_mem_watch_range_t *r;
 
-    case SVC_MEM_UNIT_ROM2:
-      src = get_rom2_base();
+  if(desc_->ranges == NULL)
+    return BADPTR;
+  if((desc_->count <= 0) ||
+     (desc_->count > SVC_MEM_WATCH_MAX_RANGES) ||
+     (desc_->period <= 0))
+    return BADSIZE;
 
-      err = set_rom_bank2();
+  for(i = 0; i < desc_->count; i++)
+    {
+      r = &desc_->ranges[i];
+      if((r->unit != SVC_MEM_UNIT_DRAM) &&
+         (r->unit != SVC_MEM_UNIT_VRAM) &&
+         (r->unit != SVC_MEM_UNIT_NVRAM))
+        return BADUNIT;
+      if(r->len <= 0)
+        return BADSIZE;
+
+      err = svc_mem_unit_hash(r->unit,r->offset,r->len,&r->hash);
       if(err)
+        return err;
+    }
+
+  return 0;
+}
+
+static
+i32
+drv_cmdwatch(struct IOReq *ior_)
+{
+  Err err;
+  svc_mem_watch_t *desc;
+
+  desc = (svc_mem_watch_t*)ior_->io_Info.ioi_Send.iob_Buffer;
+  if(desc == NULL)
+    {
+      ior_->io_Error = BADPTR;
+      return 1;
+    }
+
+  if(ior_->io_Info.ioi_Unit > SVC_MEM_UNIT_MAX)
+    {
+      ior_->io_Error = BADUNIT;
+      return 1;
+    }
+
+  if(g_DRV_WORKER_TASK == NULL)
+    {
+      ior_->io_Error = NOSUPPORT;
+      return 1;
+    }
+
+  err = drv_watch_init(desc);
+  if(err)
+    {
+      ior_->io_Error = err;
+      return 1;
+    }
+
+  drv_queue(&g_DRV_WATCHES,ior_);
+
+  return 0;
+}
+
+static
+Err
+drv_batch_entry(const svc_mem_batch_entry_t *ent_)
+{
+  i32 in_words;
+
+  if(ent_->unit == SVC_MEM_UNIT_NONE)
+    return BADUNIT;
+
+  SVC_MEM_STATS(svc_mem_stats_request(ent_->unit,ent_->count * ent_->width));
+
+  switch(ent_->width)
+    {
+    case sizeof(u8):
+      in_words = 0;
+      break;
+    case sizeof(u32):
+      in_words = 1;
+      break;
+    default:
+      return BADSIZE;
+    }
+
+  // entries aren't chunked, the whole batch runs in the dispatch
+  if((g_DRV_CHUNK_THRESHOLD != 0) &&
+     (ent_->count > 0) &&
+     ((u32)ent_->count > (g_DRV_CHUNK_THRESHOLD >> (in_words ? 2 : 0))))
+    return BADSIZE;
+
+  switch(ent_->op)
+    {
+    case SVC_MEM_BATCH_OP_READ:
+      return svc_mem_unit_read(ent_->unit,
+                               in_words,
+                               NULL,
+                               ent_->offset,
+                               ent_->buffer,
+                               ent_->count);
+    case SVC_MEM_BATCH_OP_WRITE:
+      return svc_mem_unit_write(ent_->unit,
+                                in_words,
+                                ent_->buffer,
+                                ent_->count,
+                                NULL,
+                                ent_->offset);
+    }
+
+  return NOSUPPORT;
+}
+
+static
+i32
+drv_cmdbatch(struct IOReq *ior_)
+{
+  i32 i;
+  i32 count;
+  i32 errs_len;
+  i32 keep_going;
+  i32 rom_bank;
+  Err err;
+  Err *errs;
+  const svc_mem_batch_entry_t *ents;
+
+  ents       = (const svc_mem_batch_entry_t*)ior_->io_Info.ioi_Send.iob_Buffer;
+  count      = ior_->io_Info.ioi_Send.iob_Len;
+  errs       = (Err*)ior_->io_Info.ioi_Recv.iob_Buffer;
+  errs_len   = ((errs == NULL) ? 0 : ior_->io_Info.ioi_Recv.iob_Len);
+  keep_going = !!(ior_->io_Info.ioi_CmdOptions & SVC_MEM_CMD_FLAG_CONTINUE);
+
+  if((ents == NULL) && (count > 0))
+    {
+      ior_->io_Error = BADPTR;
+      return 1;
+    }
+
+  rom_bank        = drv_rom_bank_save(ior_);
+  ior_->io_Actual = 0;
+  for(i = 0; i < count; i++)
+    {
+      err = drv_batch_entry(&ents[i]);
+      if(i < errs_len)
+        errs[i] = err;
+      if(err == 0)
+        {
+          ior_->io_Actual++;
+          continue;
+        }
+
+      if(ior_->io_Error == 0)
         ior_->io_Error = err;
-      if((offset_in_bytes + len) > ROM2_SIZE)
-        ior_->io_Error = BADPTR;
-      if(in_words && !aligned(src,dst))
-        ior_->io_Error = BADPTR;
-      if(ior_->io_Error)
-        return 1;
+      if(!keep_going)
+        break;
+    }
 
-      if(in_words)
-        drv_cmdread_u32_aborts(src,offset,dst,len);
-      return drv_cmdread_u8_aborts(src,offset,dst,len);
+  drv_rom_bank_restore(rom_bank);
 
+  return 1;
+}
 
-    case SVC_MEM_UNIT_NVRAM:
-      src = (void*)NVRAM_START_ADDR;
+/*
+  SVC_MEM_WORK_* for the request at the head of the queue. Waits
+  alone only need the task back once per vertical blank. Samplers need
+  it back every vertical blank, so chunks are held to that pace.
+*/
+static
+i32
+drv_work_next(void)
+{
+  if(ISEMPTYLIST(&g_DRV_QUEUE))
+    return ((ISEMPTYLIST(&g_DRV_WAITS) &&
+             ISEMPTYLIST(&g_DRV_SAMPLERS) &&
+             ISEMPTYLIST(&g_DRV_WATCHES)) ?
+            0 : (SVC_MEM_WORK_MORE | SVC_MEM_WORK_VBL));
+  if(!ISEMPTYLIST(&g_DRV_SAMPLERS))
+    return (SVC_MEM_WORK_MORE | SVC_MEM_WORK_VBL);
+  if(drv_vbl(DRV_IOR_FROM_LINK(FIRSTNODE(&g_DRV_QUEUE))))
+    return (SVC_MEM_WORK_MORE | SVC_MEM_WORK_VBL);
+
+  return SVC_MEM_WORK_MORE;
+}
 
-      if(in_words)
-        ior_->io_Error = BADSIZE;
-      if((offset_in_bytes + len) > NVRAM_SIZE)
-        ior_->io_Error = BADPTR;
-      if(ior_->io_Error)
-        return 1;
+/*
+  Completes the waits whose condition holds, or whose timeout has
+  passed once another vertical blank is counted.
+*/
+static
+void
+drv_poll_waits(const i32 vbl_)
+{
+  Err rv;
+  Node *n;
+  Node *next;
+  struct IOReq *ior;
+  svc_mem_wait_t *desc;
 
-      return drv_cmdread_u8_per_u32_aborts(src,offset,dst,len);
+  for(n = FIRSTNODE(&g_DRV_WAITS); ISNODE(&g_DRV_WAITS,n); n = next)
+    {
+      next = NEXTNODE(n);
+      ior  = DRV_IOR_FROM_LINK(n);
+      desc = (svc_mem_wait_t*)ior->io_Info.ioi_Send.iob_Buffer;
+      rv   = svc_mem_unit_poll(ior->io_Info.ioi_Unit,ior->io_Info.ioi_Offset,desc);
+      if((rv == 0) && vbl_)
+        desc->waited++;
+      if((rv == 0) && (desc->waited < desc->timeout))
+        continue;
+
+      RemNode(n);
+      ior->io_Actual = ((rv > 0) ? 1 : 0);
+      ior->io_Error  = ((rv < 0) ? rv : 0);
+      SuperCompleteIO(ior);
+    }
+}
 
-    case SVC_MEM_UNIT_MADAM:
-      src = (void*)MADAM_START_ADDR;
+/*
+  Appends a record to the ring of each sampler due this vertical
+  blank. The words were checked when the sampler was queued. The
+  record is complete before `head` moves past it.
+*/
+static
+void
+drv_sample(const u32 usec_)
+{
+  i32 i;
+  u32 *rec;
+  Node *n;
+  struct IOReq *ior;
+  svc_mem_ring_t *ring;
+  const svc_mem_sample_t *desc;
 
-      if(!in_words)
-        ior_->io_Error = BADSIZE;
-      if(!aligned(src,dst))
-        ior_->io_Error = BADPTR;
-      if((offset_in_bytes + len) > MADAM_SIZE)
-        ior_->io_Error = BADPTR;
-      if(ior_->io_Error)
-        return 1;
+  for(n = FIRSTNODE(&g_DRV_SAMPLERS); ISNODE(&g_DRV_SAMPLERS,n); n = NEXTNODE(n))
+    {
+      ior  = DRV_IOR_FROM_LINK(n);
+      desc = (const svc_mem_sample_t*)ior->io_Info.ioi_Send.iob_Buffer;
+      if(g_DRV_VBLS % (u32)desc->period)
+        continue;
+
+      ring = desc->ring;
+      if((ring->head - ring->tail) >= ring->size)
+        {
+          ring->dropped++;
+          continue;
+        }
+
+      rec    = &ring->data[(ring->head & (ring->size - 1)) * ring->record_words];
+      rec[0] = usec_;
+      for(i = 0; i < desc->count; i++)
+        svc_mem_unit_word(desc->words[i].unit,desc->words[i].offset,&rec[i + 1]);
+
+      ring->head++;
+      ior->io_Actual++;
+    }
+}
 
-      return drv_cmdread_u32(src,offset,dst,len);
+/*
+  Rehashes the ranges of each watch due this vertical blank. A range
+  that changed gets its bit in `changed` set to the opposite of the
+  one in `acked`, which leaves it alone if already reported and not
+  yet seen. The sender is signalled once per pass.
+*/
+static
+void
+drv_watch(void)
+{
+  i32 i;
+  u32 h;
+  u32 changed;
+  Node *n;
+  struct IOReq *ior;
+  svc_mem_watch_t *desc;
+  svc_mem_watch_range_t *r;
+
+  for(n = FIRSTNODE(&g_DRV_WATCHES); ISNODE(&g_DRV_WATCHES,n); n = NEXTNODE(n))
+    {
+      ior  = DRV_IOR_FROM_LINK(n);
+      desc = (svc_mem_watch_t*)ior->io_Info.ioi_Send.iob_Buffer;
+      if(g_DRV_VBLS % (u32)desc->period)
+        continue;
+
+      changed = 0;
+      for(i = 0; i < desc->count; i++)
+        {
+          r = &desc->ranges[i];
+          if(svc_mem_unit_hash(r->unit,r->offset,r->len,&h) || (h == r->hash))
+            continue;
+
+          r->hash  = h;
+          changed |= ((u32)1 << i);
+        }
+
+      if(changed == 0)
+        continue;
+
+      desc->changed = ((desc->changed & ~changed) | (~desc->acked & changed));
+      ior->io_Actual++;
+      if(desc->signal)
+        SuperInternalSignal(DRV_IOR_OWNER(ior),desc->signal);
+    }
+}
 
-    case SVC_MEM_UNIT_CLIO:
-      src = (void*)CLIO_START_ADDR;
+/*
+  Requests keep whatever they moved in io_Actual, samplers their
+  record count.
+*/
+static
+void
+drv_drain(List *list_)
+{
+  while(!ISEMPTYLIST(list_))
+    drv_abortio(DRV_IOR_FROM_LINK(FIRSTNODE(list_)));
+}
 
-      if(!in_words)
-        ior_->io_Error = BADSIZE;
-      if(!aligned(src,dst))
-        ior_->io_Error = BADPTR;
-      if((offset_in_bytes + len) > CLIO_SIZE)
-        ior_->io_Error = BADPTR;
-      if(ior_->io_Error)
-        return 1;
+/*
+  Samples, rehashes the watches and polls the waits, then moves one
+  chunk of the request at the head of the queue and completes it once
+  finished or failed. io_Actual of the work request is set from
+  drv_work_next. Samplers, watches and SPORT requests only move when
+  the task says a vertical blank has just started. SVC_MEM_WORK_DRAIN
+  hands every request back to the dispatch in one go, with nothing
+  able to queue in between.
+*/
+static
+i32
+drv_cmdwork(struct IOReq *ior_)
+{
+  Err err;
+  i32 n;
+  i32 vbl;
+  i32 len;
+  i32 done;
+  i32 chunk_len;
+  i32 rom_bank;
+  struct IOReq *job;
+
+  if(ior_->io_Info.ioi_CmdOptions & SVC_MEM_WORK_DRAIN)
+    {
+      svc_mem_drv_set_worker(NULL,0);
+      drv_drain(&g_DRV_QUEUE);
+      drv_drain(&g_DRV_WAITS);
+      drv_drain(&g_DRV_SAMPLERS);
+      drv_drain(&g_DRV_WATCHES);
+      ior_->io_Actual = 0;
+      return 1;
+    }
+
+  if(ior_->io_Info.ioi_CmdOptions & SVC_MEM_WORK_VBL)
+    {
+      g_DRV_VBLS++;
+      drv_sample((u32)ior_->io_Info.ioi_Offset);
+      drv_watch();
+    }
+  drv_poll_waits(!!(ior_->io_Info.ioi_CmdOptions & SVC_MEM_WORK_VBL));
 
-      return drv_cmdread_u32(src,offset,dst,len);
+  ior_->io_Actual = drv_work_next();
+  if(ISEMPTYLIST(&g_DRV_QUEUE))
+    return 1;
 
-    case SVC_MEM_UNIT_SPORT:
-      src = (void*)SPORT_START_ADDR;
+  job = DRV_IOR_FROM_LINK(FIRSTNODE(&g_DRV_QUEUE));
+  vbl = drv_vbl(job);
+  if(vbl && !(ior_->io_Info.ioi_CmdOptions & SVC_MEM_WORK_VBL))
+    return 1;
 
-      if(!in_words)
-        ior_->io_Error = BADSIZE;
-      if(!aligned(src,dst))
-        ior_->io_Error = BADPTR;
-      if((offset_in_bytes + len) > SPORT_SIZE)
-        ior_->io_Error = BADPTR;
-      if(ior_->io_Error)
-        return 1;
+  chunk_len = (vbl ? DRV_SPORT_VBL_PAGES : (i32)(g_DRV_CHUNK_SIZE >> drv_shift(job)));
+  if(chunk_len == 0)
+    chunk_len = 1;
+
+  done     = job->io_Actual;
+  len      = drv_len(job);
+  n        = (((len - done) < chunk_len) ? (len - done) : chunk_len);
+  rom_bank = drv_rom_bank_save(job);
+
+  switch(job->io_Info.ioi_Command)
+    {
+    case CMD_READ:
+      err = drv_read(job,done,n);
+      break;
+    case CMD_WRITE:
+      err = drv_write(job,done,n);
+      break;
+    case SVC_MEM_CMD_FILL:
+      err = drv_fill(job,done,n);
+      break;
+    case SVC_MEM_CMD_COPY:
+      err = drv_copy(job,done,n);
+      break;
+    case SVC_MEM_CMD_CHECKSUM:
+      err = drv_checksum(job,done,n);
+      break;
+    case SVC_MEM_CMD_SEARCH:
+      err = drv_search(job,done,n);
+      break;
+    case SVC_MEM_CMD_DIFF:
+      err = drv_diff(job,done,n);
+      break;
+    case SVC_MEM_CMD_DELTA:
+      err = drv_delta(job,done,n);
+      break;
+    case SVC_MEM_CMD_SPORT:
+      err = drv_sport(job,done,n,!vbl);
+      break;
+    default:
+      err = drv_capture(job,done,n);
+      break;
+    }
+
+  drv_rom_bank_restore(rom_bank);
+
+  if(err == 0)
+    job->io_Actual += n;
 
-      return drv_cmdread_u32(src,offset,dst,len);
+  if(err || (job->io_Actual >= len))
+    {
+      RemNode((Node*)&job->io_Link);
+      job->io_Error = err;
+      SuperCompleteIO(job);
     }
 
-  ior_->io_Error = BADUNIT;
+  ior_->io_Actual = drv_work_next();
+
+  return 1;
+}
+
+static
+i32
+drv_cmdconfig(struct IOReq *ior_)
+{
+  svc_mem_config_t       *old;
+  const svc_mem_config_t *cfg;
+
+  old = (svc_mem_config_t*)ior_->io_Info.ioi_Recv.iob_Buffer;
+  cfg = (const svc_mem_config_t*)ior_->io_Info.ioi_Send.iob_Buffer;
+
+  if((old != NULL) && (ior_->io_Info.ioi_Recv.iob_Len < (i32)sizeof(svc_mem_config_t)))
+    old = NULL;
+  if((cfg != NULL) && (ior_->io_Info.ioi_Send.iob_Len < (i32)sizeof(svc_mem_config_t)))
+    goto bad_size;
+
+  if(old != NULL)
+    {
+      old->chunk_threshold = g_DRV_CHUNK_THRESHOLD;
+      old->chunk_size      = g_DRV_CHUNK_SIZE;
+      ior_->io_Actual      = sizeof(svc_mem_config_t);
+    }
+
+  if(cfg == NULL)
+    return 1;
+  if((cfg->chunk_size < sizeof(u32)) || (cfg->chunk_size & 0x3))
+    goto bad_size;
+
+  g_DRV_CHUNK_THRESHOLD = cfg->chunk_threshold;
+  g_DRV_CHUNK_SIZE      = cfg->chunk_size;
+
+  return 1;
+
+ bad_size:
+  ior_->io_Error = BADSIZE;
   return 1;
 }
 
@@ -586,9 +1644,43 @@ static
 i32
 drv_cmdstatus(struct IOReq *ior_)
 {
+#ifdef SVC_MEM_NO_STATS
+  ior_->io_Error = NOSUPPORT;
+#else
+  i32 len;
+
+  if(ior_->io_Info.ioi_Recv.iob_Buffer == NULL)
+    {
+      ior_->io_Error = BADPTR;
+      return 1;
+    }
+
+  len = ior_->io_Info.ioi_Recv.iob_Len;
+  if(len < 0)
+    len = 0;
+  else if(len > (i32)sizeof(svc_mem_stats_t))
+    len = sizeof(svc_mem_stats_t);
+
+  memcpy(ior_->io_Info.ioi_Recv.iob_Buffer,&g_SVC_MEM_STATS,len);
+  ior_->io_Actual = len;
+#endif
+
+  return 1;
+}
+
+static
+i32
+drv_cmdstatsreset(struct IOReq *ior_)
+{
+#ifdef SVC_MEM_NO_STATS
+  ior_->io_Error = NOSUPPORT;
+#else
   (void)ior_;
 
-  return 0;
+  svc_mem_stats_clear();
+#endif
+
+  return 1;
 }
 
 Item
@@ -598,7 +1690,23 @@ svc_mem_drv_create(void)
     {
       (void*)drv_cmdwrite,
       (void*)drv_cmdread,
-      (void*)drv_cmdstatus
+      (void*)drv_cmdstatus,
+      (void*)drv_cmdbatch,
+      (void*)drv_cmdwork,
+      (void*)drv_cmdconfig,
+      (void*)drv_cmdstatsreset,
+      (void*)drv_cmdfill,
+      (void*)drv_cmdcopy,
+      (void*)drv_cmdchecksum,
+      (void*)drv_cmdsearch,
+      (void*)drv_cmddiff,
+      (void*)drv_cmddelta,
+      (void*)drv_cmdcapture,
+      (void*)drv_cmdsport,
+      (void*)drv_cmdrmw,
+      (void*)drv_cmdwait,
+      (void*)drv_cmdsample,
+      (void*)drv_cmdwatch
     };
 
   static TagArg drv_tags[] =
@@ -21,5 +21,14 @@
 #include "svc_mem_drv_opts.h"
 
 #include "item.h"
+#include "task.h"
 
 Item svc_mem_drv_create(void);
+void svc_mem_drv_set_worker(struct Task *task, i32 signal);
+
+/*
+  For the svc_mem task on its way out, with its work IOReq. Clears the
+  worker and completes every queued, waiting, sampling or watching
+  request with ABORTED.
+*/
+Err  svc_mem_drv_drain(Item ioreq);
@@ -1,7 +1,66 @@
 #pragma once
 
+#include "types.h"
+
+// Commands beyond CMD_WRITE (0), CMD_READ (1) and CMD_STATUS (2)
+#define SVC_MEM_CMD_BATCH       3
+#define SVC_MEM_CMD_WORK        4 // issued by the svc_mem task only
+#define SVC_MEM_CMD_CONFIG      5
+#define SVC_MEM_CMD_STATS_RESET 6
+#define SVC_MEM_CMD_FILL        7
+#define SVC_MEM_CMD_COPY        8
+#define SVC_MEM_CMD_CHECKSUM    9
+#define SVC_MEM_CMD_SEARCH      10
+#define SVC_MEM_CMD_DIFF        11
+#define SVC_MEM_CMD_DELTA       12
+#define SVC_MEM_CMD_CAPTURE     13
+#define SVC_MEM_CMD_SPORT       14
+#define SVC_MEM_CMD_RMW         15
+#define SVC_MEM_CMD_WAIT        16
+#define SVC_MEM_CMD_SAMPLE      17
+#define SVC_MEM_CMD_WATCH       18
+
+/*
+  io_Actual of a SVC_MEM_CMD_WORK: SVC_MEM_WORK_MORE while requests
+  are queued, with SVC_MEM_WORK_VBL if the next chunk has to start in
+  a vertical blank, samplers are running or only SVC_MEM_CMD_WAIT and
+  SVC_MEM_CMD_WATCH requests are left. The svc_mem task then waits
+  for one and passes SVC_MEM_WORK_VBL in ioi_CmdOptions of the next
+  SVC_MEM_CMD_WORK, with the microsecond timer in ioi_Offset.
+
+  SVC_MEM_WORK_DRAIN in ioi_CmdOptions is passed once by the exiting
+  task. The driver stops queueing for it and completes everything
+  left with ABORTED.
+*/
+#define SVC_MEM_WORK_MORE  (1 << 0)
+#define SVC_MEM_WORK_VBL   (1 << 1)
+#define SVC_MEM_WORK_DRAIN (1 << 2)
+
 // CmdOptions flags
-#define SVC_MEM_CMD_FLAG_WORDS (1 << 0)
+#define SVC_MEM_CMD_FLAG_WORDS       (1 << 0)
+#define SVC_MEM_CMD_FLAG_CONTINUE    (1 << 1)
+// put the ROM bank back as it was once a read or batch completes
+#define SVC_MEM_CMD_FLAG_ROM_RESTORE (1 << 2)
+// see SVC_MEM_CMD_FLAG_FAULTMAP below
+#define SVC_MEM_CMD_FLAG_FAULTMAP    (1 << 3)
+// 16 bit elements, SVC_MEM_CMD_FILL only
+#define SVC_MEM_CMD_FLAG_HALFWORDS   (1 << 4)
+// CMD_READ / CMD_WRITE of a rectangle, see SVC_MEM_RECT
+#define SVC_MEM_CMD_FLAG_RECT        (1 << 5)
+// SVC_MEM_CMD_CAPTURE output conversions
+#define SVC_MEM_CMD_FLAG_RGB15       (1 << 6)
+#define SVC_MEM_CMD_FLAG_SWAP        (1 << 7)
+// SVC_MEM_CMD_SPORT done by the CPU
+#define SVC_MEM_CMD_FLAG_CPU         (1 << 8)
+// source unit of a SVC_MEM_CMD_COPY, in the top byte
+#define SVC_MEM_CMD_COPY_SRC(unit_)         ((u32)(unit_) << 24)
+#define SVC_MEM_CMD_COPY_SRC_UNIT(opts_)    ((u8)((opts_) >> 24))
+// algorithm of a SVC_MEM_CMD_CHECKSUM, in the top byte
+#define SVC_MEM_CMD_CHECKSUM_ALGO(algo_)    ((u32)(algo_) << 24)
+#define SVC_MEM_CMD_CHECKSUM_ALGO_ID(opts_) ((u8)((opts_) >> 24))
+// operation of a SVC_MEM_CMD_SPORT, in the top byte
+#define SVC_MEM_CMD_SPORT_OP(op_)           ((u32)(op_) << 24)
+#define SVC_MEM_CMD_SPORT_OP_ID(opts_)      ((u8)((opts_) >> 24))
 
 enum svc_mem_unit_e
   {
@@ -14,5 +73,528 @@ enum svc_mem_unit_e
     SVC_MEM_UNIT_MADAM,
     SVC_MEM_UNIT_CLIO,
     SVC_MEM_UNIT_SPORT,
-    SVC_MEM_UNIT_MAX = SVC_MEM_UNIT_NVRAM
+    SVC_MEM_UNIT_MAX = SVC_MEM_UNIT_SPORT
+  };
+
+/*
+  SVC_MEM_CMD_FLAG_FAULTMAP (CMD_READ of ROM1, ROM2 or NVRAM)
+
+  Send: optional fault map, iob_Len in u32s, at least
+        SVC_MEM_FAULTMAP_WORDS(Recv iob_Len)
+  ioi_User: pattern stored in place of elements that data abort
+
+  Faulting elements are skipped rather than retried forever so a
+  whole region can be swept in one pass. Bit (i & 31) of map word
+  (i >> 5) is set if element i of the request faulted.
+*/
+#define SVC_MEM_FAULTMAP_WORDS(len_) (((len_) + 31) >> 5)
+
+/*
+  SVC_MEM_CMD_FILL (DRAM, VRAM or NONE)
+
+  Recv: destination for NONE, otherwise NULL. iob_Len is the number of
+        elements to fill
+  ioi_Offset: in elements, as with CMD_WRITE
+  ioi_User: pattern, the low 8 or 16 bits unless SVC_MEM_CMD_FLAG_WORDS
+
+  Elements are bytes by default, halfwords with
+  SVC_MEM_CMD_FLAG_HALFWORDS and words with SVC_MEM_CMD_FLAG_WORDS.
+  The destination must be aligned to the element size. Large fills are
+  chunked like writes and io_Actual is the number of elements filled.
+*/
+
+/*
+  SVC_MEM_CMD_COPY (to DRAM, VRAM or NONE)
+
+  ioi_Unit, ioi_Offset: destination, as with CMD_WRITE
+  Recv: destination for NONE, otherwise NULL
+  ioi_CmdOptions: SVC_MEM_CMD_COPY_SRC(unit) selects the source unit
+  ioi_User: source offset in elements
+  Send: source for NONE, otherwise NULL. iob_Len is the number of
+        elements to copy
+
+  Any readable unit can be the source. ROM and NVRAM sources go
+  through the same abort catching readers and ROM bank switching as
+  CMD_READ, elements that keep faulting are copied as 0. Overlapping
+  copies within plain memory behave like memmove. Large copies are
+  chunked and io_Actual is the number of elements copied.
+*/
+
+enum svc_mem_checksum_e
+  {
+    SVC_MEM_CHECKSUM_CRC32,
+    SVC_MEM_CHECKSUM_ADLER32,
+    SVC_MEM_CHECKSUM_XOR_ROT,
+    SVC_MEM_CHECKSUM_MAX = SVC_MEM_CHECKSUM_XOR_ROT
+  };
+
+#define SVC_MEM_CHECKSUM_INIT(algo_) (((algo_) == SVC_MEM_CHECKSUM_ADLER32) ? 1 : 0)
+
+/*
+  SVC_MEM_CMD_CHECKSUM (any readable unit)
+
+  ioi_Unit, ioi_Offset: start of the range, as with CMD_READ
+  ioi_CmdOptions: SVC_MEM_CMD_CHECKSUM_ALGO(algo) selects the algorithm
+  ioi_User: digest to continue from, SVC_MEM_CHECKSUM_INIT(algo) to
+            start a new one
+  Send: source for NONE, otherwise NULL. iob_Len is the number of
+        elements to hash
+  Recv: u32 receiving the digest
+
+  CRC32 is the zlib / PNG one and Adler-32 the zlib one, both over
+  the bytes of the range so digests match other implementations.
+  XOR_ROT is h = rol(h,5) ^ w over native 32 bit words, the trailing
+  bytes one at a time, and only comparable between runs on the same
+  machine. Continuing from a previous digest gives the same result as
+  hashing both ranges at once, with XOR_ROT as long as the first
+  range is a multiple of 4 bytes.
+
+  ROM and NVRAM go through the abort catching readers, elements that
+  keep faulting hash as 0. Large ranges are chunked and io_Actual is
+  the number of elements hashed.
+*/
+
+/*
+  SVC_MEM_CMD_SEARCH (any readable unit)
+
+  ioi_Unit, ioi_Offset: start of the range, as with CMD_READ
+  Send: svc_mem_search_t
+  Recv: i32 array receiving the offset, in elements from the start of
+        the unit, of each match. iob_Len is the most it can hold
+
+  An element matches when (element & mask) == (pattern & mask) for
+  every element of the pattern, no mask meaning an exact match.
+  Patterns are at most SVC_MEM_SEARCH_MAX_PATTERN bytes and must lie
+  entirely within the range to match. Matches are found in order and
+  can overlap. Once the Recv array is full the rest of the range is
+  skipped, resume from the last match + 1 to find more. `hits` is
+  set to the number of matches stored. Large ranges are chunked and
+  io_Actual is `len` on success.
+*/
+#define SVC_MEM_SEARCH_MAX_PATTERN 256
+
+typedef struct svc_mem_search_s svc_mem_search_t;
+struct svc_mem_search_s
+{
+  const void *pattern;
+  const void *mask;         // optional, same length as the pattern
+  i32         pattern_len;  // in elements
+  i32         len;          // elements to search from ioi_Offset
+  const void *src;          // base for NONE, otherwise NULL
+  i32         hits;
+};
+
+/*
+  SVC_MEM_CMD_DIFF (any readable unit)
+
+  ioi_Unit, ioi_Offset: start of the range, as with CMD_READ
+  Send: svc_mem_diff_t
+  Recv: svc_mem_diff_run_t array receiving the runs of elements that
+        differ from `ref`, iob_Len is the most it can hold
+
+  Run offsets are in elements from the start of the unit. Adjacent
+  runs are merged, chunk boundaries included. If there are more runs
+  than fit `overflow` is set and the rest of the range skipped. `runs`
+  is set to the number of runs stored. Large ranges are chunked and
+  io_Actual is `len` on success.
+*/
+typedef struct svc_mem_diff_run_s svc_mem_diff_run_t;
+struct svc_mem_diff_run_s
+{
+  i32 offset;
+  i32 len;
+};
+
+typedef struct svc_mem_diff_s svc_mem_diff_t;
+struct svc_mem_diff_s
+{
+  const void *ref;       // `len` elements to compare against
+  i32         len;       // elements to compare from ioi_Offset
+  const void *src;       // base for NONE, otherwise NULL
+  i32         runs;
+  i32         overflow;
+};
+
+/*
+  A rectangle within a linear buffer, in elements: `rows` rows of
+  `row_len` elements, each `stride` elements after the previous.
+*/
+typedef struct svc_mem_rect_s svc_mem_rect_t;
+struct svc_mem_rect_s
+{
+  i32 offset;
+  i32 row_len;
+  i32 stride;
+  i32 rows;
+};
+
+/*
+  SVC_MEM_CMD_FLAG_RECT (CMD_READ / CMD_WRITE)
+
+  ioi_Offset: unit offset of the first row, in elements
+  ioi_User: SVC_MEM_RECT(row_len,stride), both in elements and at
+            most 65535
+  Recv / Send: the caller's side with the rows packed one after the
+               other. iob_Len is the total, rows * row_len
+
+  Every row is moved in the one request, chunked like any other
+  transfer. Not combinable with SVC_MEM_CMD_FLAG_FAULTMAP.
+*/
+#define SVC_MEM_RECT(row_len_,stride_) (((u32)(row_len_) << 16) | ((u32)(stride_) & 0xFFFF))
+#define SVC_MEM_RECT_ROW_LEN(user_)    ((i32)((user_) >> 16))
+#define SVC_MEM_RECT_STRIDE(user_)     ((i32)((user_) & 0xFFFF))
+
+/*
+  SVC_MEM_CMD_DELTA (to DRAM, VRAM or NONE)
+
+  ioi_Unit, ioi_Offset: destination of the frame, in words
+  Recv: destination for NONE, otherwise NULL
+  Send: svc_mem_delta_t
+
+  Writes the words of `next` that differ from `prev`, or all of them
+  if `prev` is NULL, to the same place in the destination. With
+  `rects` only the words within the rectangles are considered,
+  offsets relative to the start of the frame. Changed runs less than
+  SVC_MEM_DELTA_GAP unchanged words apart are written as one so they
+  go out in store bursts, except across chunk boundaries. Large frames
+  are chunked, io_Actual is `len` on success and `written` the number
+  of words written.
+*/
+#define SVC_MEM_DELTA_GAP 4
+
+typedef struct svc_mem_delta_s svc_mem_delta_t;
+struct svc_mem_delta_s
+{
+  const u32            *next;
+  const u32            *prev;     // what the destination holds, or NULL
+  i32                   len;      // words in the frame
+  const svc_mem_rect_t *rects;    // optional dirty rectangles
+  i32                   nrects;
+  i32                   written;
+};
+
+/*
+  SVC_MEM_CMD_CAPTURE (VRAM, DRAM or NONE)
+
+  ioi_Unit, ioi_Offset: the bitmap, offset in words
+  ioi_User: SVC_MEM_CAPTURE_SIZE(width,height) in pixels
+  Send: bitmap base for NONE, otherwise NULL
+  Recv: u16 image, iob_Len in pixels and at least width * height,
+        neither of which may be 0
+
+  3DO bitmaps store lines in pairs, each word holding a pixel of an
+  even line in its upper half and the one below it in the lower. The
+  image written is linear, line after line. SVC_MEM_CMD_FLAG_RGB15
+  clears bit 15 of every pixel leaving 0RRRRRGGGGGBBBBB and
+  SVC_MEM_CMD_FLAG_SWAP byte swaps them. Large bitmaps are chunked and
+  io_Actual is the number of bitmap words read.
+*/
+#define SVC_MEM_CAPTURE_SIZE(w_,h_)   (((u32)(w_) << 16) | ((u32)(h_) & 0xFFFF))
+#define SVC_MEM_CAPTURE_WIDTH(user_)  ((i32)((user_) >> 16))
+#define SVC_MEM_CAPTURE_HEIGHT(user_) ((i32)((user_) & 0xFFFF))
+#define SVC_MEM_CAPTURE_WORDS(w_,h_)  ((w_) * (((h_) + 1) >> 1))
+
+enum svc_mem_sport_op_e
+  {
+    SVC_MEM_SPORT_OP_FLASH,
+    SVC_MEM_SPORT_OP_COPY,
+    SVC_MEM_SPORT_OP_MAX = SVC_MEM_SPORT_OP_COPY
+  };
+
+#define SVC_MEM_SPORT_PAGE_SIZE 2048
+
+/*
+  SVC_MEM_CMD_SPORT (VRAM)
+
+  ioi_Offset: first destination page, in bytes from the start of VRAM
+  ioi_CmdOptions: SVC_MEM_CMD_SPORT_OP(op) selects the operation
+  ioi_User: FLASH, the colour, a pair of 16 bit pixels
+            COPY, the first source page, in bytes like ioi_Offset
+  Recv: NULL, iob_Len is the number of pages
+
+  FLASH fills every page with the colour and COPY copies pages from
+  the source to the destination, overlapping ranges included. Offsets
+  must be multiples of SVC_MEM_SPORT_PAGE_SIZE.
+
+  The SPORT moves a whole page per access but shares the VRAM serial
+  port with the video display, so requests are handed to the svc_mem
+  task and done in the vertical blanks that follow, a run of pages per
+  blank. SVC_MEM_CMD_FLAG_CPU, or a driver without its task, does the
+  same with the CPU right away, chunked like a fill. io_Actual is the
+  number of pages done.
+*/
+
+enum svc_mem_batch_op_e
+  {
+    SVC_MEM_BATCH_OP_READ,
+    SVC_MEM_BATCH_OP_WRITE
+  };
+
+/*
+  SVC_MEM_CMD_BATCH
+
+  Send: array of svc_mem_batch_entry_t, iob_Len is the entry count
+  Recv: optional array of Err, one per entry, iob_Len is the count
+
+  Entries run in order. By default the batch stops at the first
+  failing entry, with SVC_MEM_CMD_FLAG_CONTINUE it runs them all.
+  io_Actual is the number of entries that succeeded. Only when
+  stopping on error is that also the index to resume from, with
+  SVC_MEM_CMD_FLAG_CONTINUE the Recv errors say which failed.
+  `offset` and `count` are in units of `width` (1 or 4) as with
+  CMD_READ / CMD_WRITE. SVC_MEM_UNIT_NONE is not supported in a batch.
+
+  Batches aren't chunked. An entry of more than the chunk threshold
+  in bytes fails with BADSIZE, unless chunking is disabled.
+*/
+typedef struct svc_mem_batch_entry_s svc_mem_batch_entry_t;
+struct svc_mem_batch_entry_s
+{
+  u8    op;
+  u8    unit;
+  u8    width;
+  u8    reserved;
+  i32   offset;
+  i32   count;
+  void *buffer;
+};
+
+enum svc_mem_rmw_op_e
+  {
+    SVC_MEM_RMW_OP_AND,
+    SVC_MEM_RMW_OP_OR,
+    SVC_MEM_RMW_OP_XOR,
+    SVC_MEM_RMW_OP_INSERT,
+    SVC_MEM_RMW_OP_CAS,
+    SVC_MEM_RMW_OP_MAX = SVC_MEM_RMW_OP_CAS
+  };
+
+#define SVC_MEM_RMW_MAX 32
+
+/*
+  SVC_MEM_CMD_RMW (DRAM, VRAM, MADAM or CLIO)
+
+  Send: array of svc_mem_rmw_t, iob_Len is the entry count, at most
+        SVC_MEM_RMW_MAX
+  Recv: optional u32 array receiving the word each entry found,
+        iob_Len is the count
+
+  AND, OR and XOR combine the word with `value`. INSERT replaces the
+  bits set in `mask` with those of `value`. CAS stores `value` only if
+  the word equals `mask`, the old value tells whether it did.
+
+  Every entry is checked before any is applied so an invalid one
+  fails the request with nothing changed. The entries then run in
+  order with interrupts disabled, no interrupt handler or task sees
+  the words part way through. io_Actual is the number of entries
+  applied.
+*/
+typedef struct svc_mem_rmw_s svc_mem_rmw_t;
+struct svc_mem_rmw_s
+{
+  u8  op;
+  u8  unit;
+  u8  reserved[2];
+  i32 offset;    // in words
+  u32 value;
+  u32 mask;      // INSERT: bits replaced, CAS: expected word
+};
+
+#define SVC_MEM_WAIT_MAX_SPINS 4096
+
+/*
+  SVC_MEM_CMD_WAIT (DRAM, VRAM, MADAM or CLIO)
+
+  ioi_Unit, ioi_Offset: the word to watch, offset in words
+  Send: svc_mem_wait_t
+
+  Completes once (word & mask) == expected or the timeout expires,
+  io_Actual being 1 or 0 respectively. The word is read `spins` times
+  in the dispatch, at least once and at most SVC_MEM_WAIT_MAX_SPINS,
+  for conditions expected within microseconds. After that the request
+  is handed to the svc_mem task, which reads it again each time it
+  runs and for at most `timeout` vertical blanks, and the caller can
+  sleep in WaitIO or do something else after SendIO. `word` is left
+  holding the last value read and `waited` the vertical blanks polled
+  for. AbortIO stops the wait.
+*/
+typedef struct svc_mem_wait_s svc_mem_wait_t;
+struct svc_mem_wait_s
+{
+  u32 mask;
+  u32 expected;
+  i32 spins;
+  i32 timeout;   // vertical blanks, 0 to give up after spinning
+  u32 word;
+  i32 waited;
+};
+
+/*
+  Single producer, single consumer ring of fixed size records shared
+  by the driver and a client. `head` and `tail` count records from 0
+  and wrap at 2^32, record n being at data + (n & (size - 1)) *
+  record_words. The producer only writes `head` and `dropped`, after
+  the record, and the consumer only `tail`, after copying records
+  out, so neither side needs a lock. A full ring drops new records.
+*/
+typedef struct svc_mem_ring_s svc_mem_ring_t;
+struct svc_mem_ring_s
+{
+  volatile u32  head;
+  volatile u32  tail;
+  u32           size;          // in records, a power of 2
+  u32           record_words;
+  volatile u32  dropped;
+  u32          *data;
+};
+
+#define SVC_MEM_SAMPLE_MAX_WORDS 16
+
+typedef struct svc_mem_sample_word_s svc_mem_sample_word_t;
+struct svc_mem_sample_word_s
+{
+  u8  unit;
+  u8  reserved[3];
+  i32 offset;    // in words
+};
+
+/*
+  SVC_MEM_CMD_SAMPLE (DRAM, VRAM, MADAM, CLIO or SPORT reads)
+
+  Send: svc_mem_sample_t
+
+  Has the svc_mem task read `count` words, at most
+  SVC_MEM_SAMPLE_MAX_WORDS, every `period` vertical blanks and append
+  them to `ring` as one record: the microsecond timer at the vertical
+  blank followed by the words in order. `record_words` of the ring
+  must be count + 1. The request stays in progress while sampling,
+  io_Actual counting the records, and is stopped with AbortIO. The
+  descriptor, words and ring have to stay valid until then. While
+  samplers run, queued chunked requests move one chunk per vertical
+  blank.
+*/
+typedef struct svc_mem_sample_s svc_mem_sample_t;
+struct svc_mem_sample_s
+{
+  const svc_mem_sample_word_t *words;
+  i32                          count;
+  i32                          period;   // in vertical blanks
+  svc_mem_ring_t              *ring;
+};
+
+#define SVC_MEM_WATCH_MAX_RANGES 32
+
+typedef struct svc_mem_watch_range_s svc_mem_watch_range_t;
+struct svc_mem_watch_range_s
+{
+  u8  unit;
+  u8  reserved[3];
+  i32 offset;    // in bytes
+  i32 len;       // in bytes
+  u32 hash;      // set by the driver
+};
+
+/*
+  SVC_MEM_CMD_WATCH (DRAM, VRAM or NVRAM)
+
+  Send: svc_mem_watch_t
+
+  Has the svc_mem task hash `count` ranges, at most
+  SVC_MEM_WATCH_MAX_RANGES, every `period` vertical blanks with
+  SVC_MEM_CHECKSUM_XOR_ROT and report those that changed. Range n
+  is reported by making bit n of `changed` differ from that of
+  `acked`. The driver only writes `changed` and the client only
+  `acked`, setting it to `changed` once it has seen the bits, so
+  neither side needs a lock. After a pass that found changes the
+  task that sent the request gets the `signal` mask, if not 0.
+
+  The ranges are hashed when the request is sent, invalid ones
+  failing it, and those hashes are the baseline. The request stays in
+  progress while watching, io_Actual counting the passes that found
+  changes, and is stopped with AbortIO. The descriptor and ranges
+  have to stay valid until then. A pass runs within a single
+  SVC_MEM_CMD_WORK so the ranges should be kept to what is of
+  interest. Passes wait while queued chunked requests are moved.
+*/
+typedef struct svc_mem_watch_s svc_mem_watch_t;
+struct svc_mem_watch_s
+{
+  svc_mem_watch_range_t *ranges;
+  i32                    count;
+  i32                    period;   // in vertical blanks
+  i32                    signal;
+  volatile u32           changed;
+  volatile u32           acked;
+};
+
+/*
+  SVC_MEM_CMD_CONFIG
+
+  Send: optional svc_mem_config_t with the new settings
+  Recv: optional svc_mem_config_t receiving the previous settings
+
+  Memory reads and writes larger than `chunk_threshold` bytes are
+  handed to the svc_mem task and moved `chunk_size` bytes at a time
+  with other tasks able to run in between. A threshold of 0 disables
+  chunking. `chunk_size` must be a non-zero multiple of 4.
+*/
+typedef struct svc_mem_config_s svc_mem_config_t;
+struct svc_mem_config_s
+{
+  u32 chunk_threshold;
+  u32 chunk_size;
+};
+
+enum svc_mem_stats_err_e
+  {
+    SVC_MEM_STATS_ERR_BADPTR,
+    SVC_MEM_STATS_ERR_BADSIZE,
+    SVC_MEM_STATS_ERR_BADUNIT,
+    SVC_MEM_STATS_ERR_NOSUPPORT,
+    SVC_MEM_STATS_ERR_ABORTED,
+    SVC_MEM_STATS_ERR_OTHER,
+    SVC_MEM_STATS_ERR_MAX
   };
+
+#define SVC_MEM_STATS_HIST_LEN 32
+
+typedef struct svc_mem_unit_stats_s svc_mem_unit_stats_t;
+struct svc_mem_unit_stats_s
+{
+  u32 requests;
+  u32 bytes_read;
+  u32 bytes_written;
+  u32 aborts;
+  u32 errors[SVC_MEM_STATS_ERR_MAX];
+};
+
+/*
+  CMD_STATUS
+
+  Recv: svc_mem_stats_t, io_Actual is the number of bytes filled
+
+  `requests` counts the requests that access a unit, every command
+  but CONFIG, STATUS, STATS_RESET, WORK, SAMPLE, WATCH and BATCH.
+  Batch and RMW entries are counted one by one. `bytes_*` is what
+  was moved successfully and `errors` failed transfers and aborted
+  requests by code. `aborts` counts data aborts caught, retries
+  included.
+
+  Histogram bucket n counts values needing n bits, 0 in bucket 0,
+  1 in 1, 2-3 in 2, 4-7 in 3 and so on, the last bucket taking
+  everything larger. `size_hist` is of request sizes in bytes and
+  `tick_hist` of the time spent in each transfer, a chunk when
+  chunked, in clock ticks: the CLIO timer on hardware, microseconds
+  in the host build.
+
+  Drivers built without statistics fail CMD_STATUS with NOSUPPORT.
+  SVC_MEM_CMD_STATS_RESET zeroes everything.
+*/
+typedef struct svc_mem_stats_s svc_mem_stats_t;
+struct svc_mem_stats_s
+{
+  u32                  rom_bank_switches;
+  svc_mem_unit_stats_t units[SVC_MEM_UNIT_MAX + 1];
+  u32                  size_hist[SVC_MEM_STATS_HIST_LEN];
+  u32                  tick_hist[SVC_MEM_STATS_HIST_LEN];
+};
@@ -0,0 +1,452 @@
+/*
+  ISC License
+
+  Copyright (c) 2024, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "svc_mem_kern.h"
+
+/*
+  Byte copies shorter than this are not worth aligning for.
+*/
+#define KERN_U8_MIN_WORDS 16
+
+/*
+  The eight loads and stores per iteration are consecutive off a
+  single base so armcc folds them into one LDMIA / STMIA pair. That
+  moves a DRAM page burst per instruction rather than paying the
+  non-sequential cycle for every word.
+*/
+void
+svc_mem_kern_copy_u32(u32       *dst_,
+                      const u32 *src_,
+                      i32        len_)
+{
+  u32 w0,w1,w2,w3,w4,w5,w6,w7;
+
+  for(; len_ >= 8; len_ -= 8)
+    {
+      w0 = src_[0];
+      w1 = src_[1];
+      w2 = src_[2];
+      w3 = src_[3];
+      w4 = src_[4];
+      w5 = src_[5];
+      w6 = src_[6];
+      w7 = src_[7];
+      dst_[0] = w0;
+      dst_[1] = w1;
+      dst_[2] = w2;
+      dst_[3] = w3;
+      dst_[4] = w4;
+      dst_[5] = w5;
+      dst_[6] = w6;
+      dst_[7] = w7;
+      src_ += 8;
+      dst_ += 8;
+    }
+
+  if(len_ >= 4)
+    {
+      w0 = src_[0];
+      w1 = src_[1];
+      w2 = src_[2];
+      w3 = src_[3];
+      dst_[0] = w0;
+      dst_[1] = w1;
+      dst_[2] = w2;
+      dst_[3] = w3;
+      src_ += 4;
+      dst_ += 4;
+      len_ -= 4;
+    }
+
+  while(len_-- > 0)
+    *dst_++ = *src_++;
+}
+
+static
+void
+kern_copy_u8_bytes(u8       *dst_,
+                   const u8 *src_,
+                   i32       len_)
+{
+  for(; len_ >= 4; len_ -= 4)
+    {
+      dst_[0] = src_[0];
+      dst_[1] = src_[1];
+      dst_[2] = src_[2];
+      dst_[3] = src_[3];
+      src_ += 4;
+      dst_ += 4;
+    }
+
+  while(len_-- > 0)
+    *dst_++ = *src_++;
+}
+
+/*
+  When source and destination share the same alignment the head is
+  copied bytewise up to a word boundary, the body goes through the
+  word kernel and the remaining tail is copied bytewise.
+*/
+void
+svc_mem_kern_copy_u8(u8       *dst_,
+                     const u8 *src_,
+                     i32       len_)
+{
+  i32 head;
+  i32 words;
+
+  if((((u32)dst_ ^ (u32)src_) & 0x3) ||
+     (len_ < (i32)(KERN_U8_MIN_WORDS * sizeof(u32))))
+    {
+      kern_copy_u8_bytes(dst_,src_,len_);
+      return;
+    }
+
+  head = ((4 - ((u32)dst_ & 0x3)) & 0x3);
+  kern_copy_u8_bytes(dst_,src_,head);
+  dst_ += head;
+  src_ += head;
+  len_ -= head;
+
+  words = (len_ >> 2);
+  svc_mem_kern_copy_u32((u32*)dst_,(const u32*)src_,words);
+  dst_ += (words << 2);
+  src_ += (words << 2);
+  len_ -= (words << 2);
+
+  kern_copy_u8_bytes(dst_,src_,len_);
+}
+
+/*
+  Backwards copies for overlapping moves with the destination above
+  the source. Same block structure as the forward copy walking down
+  from the end, which armcc folds into LDMDB / STMDB.
+*/
+void
+svc_mem_kern_copy_u32_rev(u32       *dst_,
+                          const u32 *src_,
+                          i32        len_)
+{
+  u32 w0,w1,w2,w3,w4,w5,w6,w7;
+
+  src_ += len_;
+  dst_ += len_;
+  for(; len_ >= 8; len_ -= 8)
+    {
+      src_ -= 8;
+      dst_ -= 8;
+      w0 = src_[0];
+      w1 = src_[1];
+      w2 = src_[2];
+      w3 = src_[3];
+      w4 = src_[4];
+      w5 = src_[5];
+      w6 = src_[6];
+      w7 = src_[7];
+      dst_[0] = w0;
+      dst_[1] = w1;
+      dst_[2] = w2;
+      dst_[3] = w3;
+      dst_[4] = w4;
+      dst_[5] = w5;
+      dst_[6] = w6;
+      dst_[7] = w7;
+    }
+
+  while(len_-- > 0)
+    *--dst_ = *--src_;
+}
+
+void
+svc_mem_kern_copy_u8_rev(u8       *dst_,
+                         const u8 *src_,
+                         i32       len_)
+{
+  i32 words;
+
+  src_ += len_;
+  dst_ += len_;
+  if(!(((u32)dst_ ^ (u32)src_) & 0x3) &&
+     (len_ >= (i32)(KERN_U8_MIN_WORDS * sizeof(u32))))
+    {
+      while((u32)dst_ & 0x3)
+        {
+          *--dst_ = *--src_;
+          len_--;
+        }
+
+      words = (len_ >> 2);
+      dst_ -= (words << 2);
+      src_ -= (words << 2);
+      len_ -= (words << 2);
+      svc_mem_kern_copy_u32_rev((u32*)dst_,(const u32*)src_,words);
+    }
+
+  while(len_-- > 0)
+    *--dst_ = *--src_;
+}
+
+/*
+  As with the copy the eight stores come off one base so they fold
+  into a single STMIA, the pattern held in eight registers.
+*/
+void
+svc_mem_kern_fill_u32(u32       *dst_,
+                      const u32  v_,
+                      i32        len_)
+{
+  u32 w0,w1,w2,w3,w4,w5,w6,w7;
+
+  w0 = w1 = w2 = w3 = w4 = w5 = w6 = w7 = v_;
+  for(; len_ >= 8; len_ -= 8)
+    {
+      dst_[0] = w0;
+      dst_[1] = w1;
+      dst_[2] = w2;
+      dst_[3] = w3;
+      dst_[4] = w4;
+      dst_[5] = w5;
+      dst_[6] = w6;
+      dst_[7] = w7;
+      dst_ += 8;
+    }
+
+  if(len_ >= 4)
+    {
+      dst_[0] = w0;
+      dst_[1] = w1;
+      dst_[2] = w2;
+      dst_[3] = w3;
+      dst_ += 4;
+      len_ -= 4;
+    }
+
+  while(len_-- > 0)
+    *dst_++ = v_;
+}
+
+/*
+  `dst_` must be halfword aligned. The pattern is the same in both
+  halves of a word so byte order doesn't matter for the body.
+*/
+void
+svc_mem_kern_fill_u16(u16       *dst_,
+                      const u16  v_,
+                      i32        len_)
+{
+  i32 words;
+
+  if(((u32)dst_ & 0x2) && (len_ > 0))
+    {
+      *dst_++ = v_;
+      len_--;
+    }
+
+  words = (len_ >> 1);
+  svc_mem_kern_fill_u32((u32*)dst_,(((u32)v_ << 16) | v_),words);
+  dst_ += (words << 1);
+
+  if(len_ & 1)
+    *dst_ = v_;
+}
+
+void
+svc_mem_kern_fill_u8(u8       *dst_,
+                     const u8  v_,
+                     i32       len_)
+{
+  i32 words;
+
+  if(len_ >= (i32)(KERN_U8_MIN_WORDS * sizeof(u32)))
+    {
+      while((u32)dst_ & 0x3)
+        {
+          *dst_++ = v_;
+          len_--;
+        }
+
+      words = (len_ >> 2);
+      svc_mem_kern_fill_u32((u32*)dst_,(v_ * 0x01010101U),words);
+      dst_ += (words << 2);
+      len_ -= (words << 2);
+    }
+
+  while(len_-- > 0)
+    *dst_++ = v_;
+}
+
+/*
+  Byte at a time table CRC, reflected 0xEDB88320 as used by zlib. The
+  1KB table is built on first use rather than carried in the binary.
+*/
+#define KERN_CRC32_POLY 0xEDB88320
+
+static u32 g_KERN_CRC32[256];
+
+static
+void
+kern_crc32_init(void)
+{
+  u32 i;
+  u32 j;
+  u32 c;
+
+  for(i = 0; i < 256; i++)
+    {
+      c = i;
+      for(j = 0; j < 8; j++)
+        c = ((c & 1) ? (KERN_CRC32_POLY ^ (c >> 1)) : (c >> 1));
+      g_KERN_CRC32[i] = c;
+    }
+}
+
+#define KERN_CRC32_STEP(c_,b_) (g_KERN_CRC32[((c_) ^ (b_)) & 0xFF] ^ ((c_) >> 8))
+
+u32
+svc_mem_kern_crc32(u32       crc_,
+                   const u8 *src_,
+                   i32       len_)
+{
+  if(g_KERN_CRC32[1] == 0)
+    kern_crc32_init();
+
+  crc_ = ~crc_;
+  for(; len_ >= 4; len_ -= 4)
+    {
+      crc_ = KERN_CRC32_STEP(crc_,src_[0]);
+      crc_ = KERN_CRC32_STEP(crc_,src_[1]);
+      crc_ = KERN_CRC32_STEP(crc_,src_[2]);
+      crc_ = KERN_CRC32_STEP(crc_,src_[3]);
+      src_ += 4;
+    }
+
+  while(len_-- > 0)
+    crc_ = KERN_CRC32_STEP(crc_,*src_++);
+
+  return ~crc_;
+}
+
+/*
+  The modulo is deferred for as long as the sums can't overflow, the
+  ARM60 has no divide.
+*/
+#define KERN_ADLER32_MOD  65521
+#define KERN_ADLER32_NMAX 5552
+
+u32
+svc_mem_kern_adler32(u32       adler_,
+                     const u8 *src_,
+                     i32       len_)
+{
+  u32 a;
+  u32 b;
+  i32 n;
+
+  a = (adler_ & 0xFFFF);
+  b = (adler_ >> 16);
+  while(len_ > 0)
+    {
+      n     = ((len_ < KERN_ADLER32_NMAX) ? len_ : KERN_ADLER32_NMAX);
+      len_ -= n;
+      for(; n >= 4; n -= 4)
+        {
+          a += src_[0]; b += a;
+          a += src_[1]; b += a;
+          a += src_[2]; b += a;
+          a += src_[3]; b += a;
+          src_ += 4;
+        }
+      while(n-- > 0)
+        {
+          a += *src_++;
+          b += a;
+        }
+
+      a %= KERN_ADLER32_MOD;
+      b %= KERN_ADLER32_MOD;
+    }
+
+  return ((b << 16) | a);
+}
+
+#define KERN_ROL5(h_) (((h_) << 5) | ((h_) >> 27))
+
+/*
+  `src_` must be word aligned. Words are loaded whole and the bytes
+  left over at the end are mixed in one at a time.
+*/
+u32
+svc_mem_kern_xor_rot(u32       h_,
+                     const u8 *src_,
+                     i32       len_)
+{
+  const u32 *w;
+
+  w = (const u32*)src_;
+  for(; len_ >= 16; len_ -= 16)
+    {
+      h_ = (KERN_ROL5(h_) ^ w[0]);
+      h_ = (KERN_ROL5(h_) ^ w[1]);
+      h_ = (KERN_ROL5(h_) ^ w[2]);
+      h_ = (KERN_ROL5(h_) ^ w[3]);
+      w += 4;
+    }
+  for(; len_ >= 4; len_ -= 4)
+    h_ = (KERN_ROL5(h_) ^ *w++);
+
+  src_ = (const u8*)w;
+  while(len_-- > 0)
+    h_ = (KERN_ROL5(h_) ^ *src_++);
+
+  return h_;
+}
+
+#define KERN_SWAP16(v_) ((((v_) >> 8) | ((v_) << 8)) & 0xFFFF)
+
+/*
+  Splits line paired pixels, the upper halves into `hi_` and lower
+  into `lo_`, which may be NULL. Each pixel is masked with `mask_` and
+  byte swapped if `swap_`.
+*/
+void
+svc_mem_kern_split_u16(u16       *hi_,
+                       u16       *lo_,
+                       const u32 *src_,
+                       i32        len_,
+                       const u32  mask_,
+                       const i32  swap_)
+{
+  u32 w;
+  u32 h;
+  u32 l;
+
+  for(; len_ > 0; len_--)
+    {
+      w = *src_++;
+      h = ((w >> 16) & mask_);
+      l = (w & mask_);
+      if(swap_)
+        {
+          h = KERN_SWAP16(h);
+          l = KERN_SWAP16(l);
+        }
+      *hi_++ = (u16)h;
+      if(lo_ != NULL)
+        *lo_++ = (u16)l;
+    }
+}
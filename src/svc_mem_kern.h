@@ -0,0 +1,47 @@
+/*
+  ISC License
+
+  Copyright (c) 2024, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#pragma once
+
+#include "types.h"
+
+/*
+  Block move, fill and hash kernels used by the driver for plain
+  memory (DRAM, VRAM, ROM and caller buffers). Lengths are in
+  elements. Not for use on memory mapped registers. Callers reading
+  memory that may data abort must catch the aborts themselves.
+*/
+
+void svc_mem_kern_copy_u32(u32 *dst, const u32 *src, i32 len);
+void svc_mem_kern_copy_u8(u8 *dst, const u8 *src, i32 len);
+void svc_mem_kern_copy_u32_rev(u32 *dst, const u32 *src, i32 len);
+void svc_mem_kern_copy_u8_rev(u8 *dst, const u8 *src, i32 len);
+
+void svc_mem_kern_fill_u32(u32 *dst, u32 v, i32 len);
+void svc_mem_kern_fill_u16(u16 *dst, u16 v, i32 len);
+void svc_mem_kern_fill_u8(u8 *dst, u8 v, i32 len);
+
+/*
+  Hashes take the digest so far and return the updated one. `len` is
+  in bytes.
+*/
+u32 svc_mem_kern_crc32(u32 crc, const u8 *src, i32 len);
+u32 svc_mem_kern_adler32(u32 adler, const u8 *src, i32 len);
+u32 svc_mem_kern_xor_rot(u32 h, const u8 *src, i32 len);
+
+void svc_mem_kern_split_u16(u16 *hi, u16 *lo, const u32 *src, i32 len, u32 mask, i32 swap);
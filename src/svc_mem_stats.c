@@ -0,0 +1,149 @@
+/*
+  ISC License
+
+  Copyright (c) 2024, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "svc_mem_stats.h"
+
+#include "operror.h"
+#include "strings.h"
+
+#ifndef SVC_MEM_NO_STATS
+
+svc_mem_stats_t g_SVC_MEM_STATS;
+
+/*
+  Number of bits needed to hold `v_`. No CLZ on the ARM60 so halve
+  the search space instead.
+*/
+static
+u32
+stats_bits(u32 v_)
+{
+  u32 n;
+
+  n = 0;
+  if(v_ & 0xFFFF0000)
+    {
+      n   += 16;
+      v_ >>= 16;
+    }
+  if(v_ & 0x0000FF00)
+    {
+      n   += 8;
+      v_ >>= 8;
+    }
+  if(v_ & 0x000000F0)
+    {
+      n   += 4;
+      v_ >>= 4;
+    }
+  if(v_ & 0x0000000C)
+    {
+      n   += 2;
+      v_ >>= 2;
+    }
+  if(v_ & 0x00000002)
+    {
+      n   += 1;
+      v_ >>= 1;
+    }
+
+  return (n + v_);
+}
+
+static
+void
+stats_hist(u32       *hist_,
+           const u32  v_)
+{
+  u32 n;
+
+  n = stats_bits(v_);
+  if(n >= SVC_MEM_STATS_HIST_LEN)
+    n = (SVC_MEM_STATS_HIST_LEN - 1);
+
+  hist_[n]++;
+}
+
+static
+u32
+stats_err(const Err err_)
+{
+  if(err_ == BADPTR)
+    return SVC_MEM_STATS_ERR_BADPTR;
+  if(err_ == BADSIZE)
+    return SVC_MEM_STATS_ERR_BADSIZE;
+  if(err_ == BADUNIT)
+    return SVC_MEM_STATS_ERR_BADUNIT;
+  if(err_ == NOSUPPORT)
+    return SVC_MEM_STATS_ERR_NOSUPPORT;
+  if(err_ == ABORTED)
+    return SVC_MEM_STATS_ERR_ABORTED;
+
+  return SVC_MEM_STATS_ERR_OTHER;
+}
+
+void
+svc_mem_stats_request(const u8  unit_,
+                      const u32 bytes_)
+{
+  if(unit_ > SVC_MEM_UNIT_MAX)
+    return;
+
+  g_SVC_MEM_STATS.units[unit_].requests++;
+  stats_hist(g_SVC_MEM_STATS.size_hist,bytes_);
+}
+
+void
+svc_mem_stats_abort(const u8 unit_)
+{
+  if(unit_ > SVC_MEM_UNIT_MAX)
+    return;
+
+  g_SVC_MEM_STATS.units[unit_].errors[SVC_MEM_STATS_ERR_ABORTED]++;
+}
+
+/*
+  `unit_` has already been validated by the unit layer.
+*/
+void
+svc_mem_stats_xfer(const u8  unit_,
+                   const i32 write_,
+                   const u32 bytes_,
+                   const Err err_,
+                   const u32 ticks_)
+{
+  svc_mem_unit_stats_t *u;
+
+  u = &g_SVC_MEM_STATS.units[unit_];
+  if(err_ < 0)
+    u->errors[stats_err(err_)]++;
+  else if(write_)
+    u->bytes_written += bytes_;
+  else
+    u->bytes_read += bytes_;
+
+  stats_hist(g_SVC_MEM_STATS.tick_hist,ticks_);
+}
+
+void
+svc_mem_stats_clear(void)
+{
+  memset(&g_SVC_MEM_STATS,0,sizeof(g_SVC_MEM_STATS));
+}
+
+#endif
@@ -0,0 +1,41 @@
+/*
+  ISC License
+
+  Copyright (c) 2024, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#pragma once
+
+#include "svc_mem_drv_opts.h"
+
+#include "types.h"
+
+/*
+  Driver side statistics, see CMD_STATUS in svc_mem_drv_opts.h. Hot
+  paths wrap their bookkeeping in SVC_MEM_STATS() so building with
+  SVC_MEM_NO_STATS removes it entirely.
+*/
+#ifdef SVC_MEM_NO_STATS
+#define SVC_MEM_STATS(x_)
+#else
+#define SVC_MEM_STATS(x_) x_
+
+extern svc_mem_stats_t g_SVC_MEM_STATS;
+
+void svc_mem_stats_request(u8 unit, u32 bytes);
+void svc_mem_stats_abort(u8 unit);
+void svc_mem_stats_xfer(u8 unit, i32 write, u32 bytes, Err err, u32 ticks);
+void svc_mem_stats_clear(void);
+#endif
@@ -0,0 +1,2139 @@
+/*
+  ISC License
+
+  Copyright (c) 2024, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "svc_mem_unit.h"
+#include "svc_mem_clock.h"
+#include "svc_mem_kern.h"
+#include "svc_mem_stats.h"
+
+#include "svc_funcs.h"
+
+#include "kernel.h"
+#include "portfolio.h"
+#include "setjmp.h"
+
+/*
+  Physical addresses go through PHYS so the host build can back the
+  memory map with its own reservation.
+*/
+#ifdef SVC_MEM_HOST
+#include "sim.h"
+#define PHYS(addr_) (sim_phys(addr_))
+#define SPORT_WR(addr_,v_) (sim_sport_write(addr_,v_))
+#else
+#define PHYS(addr_) ((void*)(addr_))
+#define SPORT_WR(addr_,v_) (*(volatile u32*)(addr_) = (v_))
+#endif
+
+#define ABT_ROMF 0x00000001
+
+#define ONEMEG (1024 * 1024)
+
+#define DRAM_START_ADDR  0x00000000
+#define VRAM_START_ADDR  0x00200000
+#define NVRAM_START_ADDR 0x03140000
+#define ROM1_START_ADDR  0x03000000
+#define ROM2_START_ADDR  0x03000000
+#define MADAM_START_ADDR 0x03300000
+#define CLIO_START_ADDR  0x03400000
+#define SPORT_START_ADDR 0x03200000
+
+#define DRAM_SIZE  (2 * ONEMEG)
+#define VRAM_SIZE  (1 * ONEMEG)
+#define ROM1_SIZE  (1 * ONEMEG)
+#define ROM2_SIZE  (1 * ONEMEG)
+#define NVRAM_SIZE (32 * 1024)
+#define MADAM_SIZE ( 2 * 1024)
+#define CLIO_SIZE  ( 1 * 1024)
+#define SPORT_SIZE (1 * ONEMEG)
+
+/*
+  Bits 15 to 17 of a SPORT address select the operation and bits 2 to
+  10 the VRAM page. LOAD reads a page into the SPORT's buffer and
+  STORE writes the buffer to a page, FLASH fills a page with the
+  colour register. The value written to STORE and FLASH masks the
+  bits changed in each word, to LOAD it is ignored.
+*/
+#define SPORT_OP_LOAD    0x00000
+#define SPORT_OP_COLOUR  0x08000
+#define SPORT_OP_FLASH   0x10000
+#define SPORT_OP_STORE   0x18000
+#define SPORT_ADDR(op_,voffset_) (SPORT_START_ADDR + (op_) + (((u32)(voffset_) >> 11) << 2))
+#define SPORT_PAGE_WORDS (SVC_MEM_SPORT_PAGE_SIZE >> 2)
+
+#define SYSINFO_TAG_SETROMBANK 0x11006
+#define SYSINFO_TAG_CURROMBANK 0x10006
+#define SYSINFO_ROMBANK1       0
+#define SYSINFO_ROMBANK2       1
+#define SYSINFO_TAG_ROM2BASE   0x10007
+#define SYSINFO_ROM2FOUND      0
+#define SYSINFO_ROM2NOTFOUND   1
+
+static
+i32
+aligned(const void *p0_,
+        const void *p1_)
+{
+  return ((((u32)p0_ | (u32)p1_) & 0x3) == 0);
+}
+
+/*
+  The current ROM bank and the ROM2 base are cached so streaming reads
+  don't pay a SetSysInfo / QuerySysInfo per request. The driver
+  assumes it is the only one switching banks. Requests flagged
+  SVC_MEM_CMD_FLAG_ROM_RESTORE resync the cache from the system and
+  put the original bank back when done.
+*/
+#define ROM_BANK_UNKNOWN (-1)
+
+static i32   g_ROM_BANK  = ROM_BANK_UNKNOWN;
+static void *g_ROM2_BASE = NULL;
+
+static
+Err
+get_rom2_base(const void **base_)
+{
+  Err err;
+  void *rv;
+
+  if(g_ROM2_BASE != NULL)
+    {
+      *base_ = g_ROM2_BASE;
+      return 0;
+    }
+
+  err = svc_QuerySysInfo(SYSINFO_TAG_ROM2BASE,&rv,sizeof(rv));
+  if(err < 0)
+    return err;
+  if(err == SYSINFO_ROM2NOTFOUND)
+    return NOSUPPORT;
+
+  g_ROM2_BASE = rv;
+  *base_      = rv;
+
+  return 0;
+}
+
+Err
+svc_mem_unit_rom_bank_set(const i32 bank_)
+{
+  Err err;
+
+  if(g_ROM_BANK == bank_)
+    return 0;
+
+  err = svc_SetSysInfo(SYSINFO_TAG_SETROMBANK,(void*)bank_,0);
+  SVC_MEM_STATS(g_SVC_MEM_STATS.rom_bank_switches++);
+  g_ROM_BANK = ((err < 0) ? ROM_BANK_UNKNOWN : bank_);
+
+  return err;
+}
+
+i32
+svc_mem_unit_rom_bank_get(void)
+{
+  Err err;
+  u32 bank;
+
+  err = svc_QuerySysInfo(SYSINFO_TAG_CURROMBANK,&bank,sizeof(bank));
+  g_ROM_BANK = ((err < 0) ? ROM_BANK_UNKNOWN : (i32)bank);
+
+  return g_ROM_BANK;
+}
+
+static
+Err
+unit_select_rom1(const void **base_)
+{
+  (void)base_;
+
+  return svc_mem_unit_rom_bank_set(SYSINFO_ROMBANK1);
+}
+
+static
+Err
+unit_select_rom2(const void **base_)
+{
+  Err err;
+
+  err = get_rom2_base(base_);
+  if(err)
+    return err;
+
+  return svc_mem_unit_rom_bank_set(SYSINFO_ROMBANK2);
+}
+
+static
+Err
+unit_write_u32(const void *src_,
+               const i32   len_,
+               void       *dst_,
+               const i32   offset_)
+{
+  const u32 *src = (const u32*)src_;
+  u32       *dst = (u32*)dst_;
+
+  svc_mem_kern_copy_u32(&dst[offset_],src,len_);
+
+  return 0;
+}
+
+static
+Err
+unit_write_u8(const void *src_,
+              const i32   len_,
+              void       *dst_,
+              const i32   offset_)
+{
+  const u8 *src = (const u8*)src_;
+  u8       *dst = (u8*)dst_;
+
+  svc_mem_kern_copy_u8(&dst[offset_],src,len_);
+
+  return 0;
+}
+
+static
+Err
+unit_write_u32_reg(const void *src_,
+                   const i32   len_,
+                   void       *dst_,
+                   const i32   offset_)
+{
+  i32 i;
+  const u32    *src = (const u32*)src_;
+  volatile u32 *dst = (volatile u32*)dst_;
+
+  dst += offset_;
+  for(i = 0; i < len_; i++)
+    dst[i] = src[i];
+
+  return 0;
+}
+
+static
+Err
+unit_read_u32(const void *src_,
+              const i32   offset_,
+              void       *dst_,
+              const i32   len_)
+{
+  const u32 *src = (const u32*)src_;
+  u32       *dst = (u32*)dst_;
+
+  svc_mem_kern_copy_u32(dst,&src[offset_],len_);
+
+  return 0;
+}
+
+static
+Err
+unit_read_u8(const void *src_,
+             const i32   offset_,
+             void       *dst_,
+             const i32   len_)
+{
+  const u8 *src = (const u8*)src_;
+  u8       *dst = (u8*)dst_;
+
+  svc_mem_kern_copy_u8(dst,&src[offset_],len_);
+
+  return 0;
+}
+
+static
+Err
+unit_read_u32_reg(const void *src_,
+                  const i32   offset_,
+                  void       *dst_,
+                  const i32   len_)
+{
+  i32 i;
+  const volatile u32 *src = (const volatile u32*)src_;
+  u32                *dst = (u32*)dst_;
+
+  src += offset_;
+  for(i = 0; i < len_; i++)
+    dst[i] = src[i];
+
+  return 0;
+}
+
+/*
+  Readers for units that may data abort. The catch buffer is set up
+  once per request. A faulting element is retried UNIT_FAULT_RETRIES
+  times, the count starting over for each element, then filled with
+  the fault pattern, marked in the fault map if there is one and
+  skipped. Defaults are a zero pattern and no map,
+  svc_mem_unit_read_faults overrides them for a single read.
+*/
+#define UNIT_FAULT_RETRIES 1
+// elements per block copy, redone one at a time if it aborts
+#define UNIT_BLOCK_LEN     256
+
+typedef struct unit_faults_s unit_faults_t;
+struct unit_faults_s
+{
+  u32  pattern;
+  u32 *map;
+  i32  map_base;
+  i32  count;
+};
+
+typedef struct unit_aborts_s unit_aborts_t;
+struct unit_aborts_s
+{
+  jmp_buf *catchdataaborts;
+  u32      quietaborts;
+};
+
+static unit_faults_t g_FAULTS;
+#ifndef SVC_MEM_NO_STATS
+static u32 g_UNIT_ABORTS;
+#endif
+
+static
+void
+unit_aborts_catch(unit_aborts_t *old_,
+                  jmp_buf       *jmpbuf_)
+{
+  old_->catchdataaborts = KernelBase->kb_CatchDataAborts;
+  old_->quietaborts     = KernelBase->kb_QuietAborts;
+
+  KernelBase->kb_CatchDataAborts = jmpbuf_;
+  KernelBase->kb_QuietAborts     = ABT_ROMF;
+}
+
+static
+void
+unit_aborts_release(const unit_aborts_t *old_)
+{
+  KernelBase->kb_CatchDataAborts = old_->catchdataaborts;
+  KernelBase->kb_QuietAborts     = old_->quietaborts;
+}
+
+/*
+  Returns non-zero once element `idx_` should be given up on.
+*/
+static
+i32
+unit_fault(volatile i32 *retries_,
+           const i32     idx_)
+{
+  i32 bit;
+
+  if((*retries_)++ < UNIT_FAULT_RETRIES)
+    return 0;
+
+  *retries_ = 0;
+  g_FAULTS.count++;
+  if(g_FAULTS.map != NULL)
+    {
+      bit = (g_FAULTS.map_base + idx_);
+      g_FAULTS.map[bit >> 5] |= (1U << (bit & 31));
+    }
+
+  return 1;
+}
+
+static
+Err
+unit_read_u8_per_u32_aborts(const void *src_,
+                            const i32   offset_,
+                            void       *dst_,
+                            const i32   len_)
+{
+  const volatile u32 *src;
+  u8 *dst;
+  jmp_buf jmpbuf;
+  unit_aborts_t old;
+  volatile i32 i;
+  volatile i32 retries;
+
+  i       = 0;
+  retries = 0;
+  src     = &((const volatile u32*)src_)[offset_];
+  dst     = (u8*)dst_;
+
+  unit_aborts_catch(&old,&jmpbuf);
+  if(setjmp(jmpbuf))
+    {
+      KernelBase->kb_CatchDataAborts = &jmpbuf;
+      SVC_MEM_STATS(g_UNIT_ABORTS++);
+      if(unit_fault(&retries,i))
+        dst[i++] = (u8)g_FAULTS.pattern;
+    }
+
+  for(; i < len_; i++)
+    {
+      dst[i]  = (u8)(src[i] & 0xFF);
+      retries = 0;
+    }
+
+  unit_aborts_release(&old);
+
+  return 0;
+}
+
+/*
+  ROM is read with the block kernels, UNIT_BLOCK_LEN elements at a
+  time with `i` moved past each block once it is copied. If one aborts
+  that block is redone an element at a time so the faulting element
+  can be found, after which it is back to block copies. An abort
+  costs at most one block of single reads and `i`, `slow` and
+  `retries` are all that have to survive the longjmp.
+*/
+static
+Err
+unit_read_u8_aborts(const void *src_,
+                    const i32   offset_,
+                    void       *dst_,
+                    const i32   len_)
+{
+  const u8 *src;
+  u8 *dst;
+  jmp_buf jmpbuf;
+  unit_aborts_t old;
+  i32 n;
+  volatile i32 i;
+  volatile i32 slow;
+  volatile i32 retries;
+
+  i       = 0;
+  slow    = 0;
+  retries = 0;
+  src     = &((const u8*)src_)[offset_];
+  dst     = (u8*)dst_;
+
+  unit_aborts_catch(&old,&jmpbuf);
+  if(setjmp(jmpbuf))
+    {
+      KernelBase->kb_CatchDataAborts = &jmpbuf;
+      SVC_MEM_STATS(g_UNIT_ABORTS++);
+      if(i >= slow)
+        slow = (i + UNIT_BLOCK_LEN);
+      else if(unit_fault(&retries,i))
+        dst[i++] = (u8)g_FAULTS.pattern;
+    }
+
+  while(i < len_)
+    {
+      for(; (i < slow) && (i < len_); i++)
+        {
+          dst[i]  = ((const volatile u8*)src)[i];
+          retries = 0;
+        }
+
+      n = (len_ - i);
+      if(n > UNIT_BLOCK_LEN)
+        n = UNIT_BLOCK_LEN;
+      if(n <= 0)
+        break;
+
+      svc_mem_kern_copy_u8(&dst[i],&src[i],n);
+      i += n;
+    }
+
+  unit_aborts_release(&old);
+
+  return 0;
+}
+
+static
+Err
+unit_read_u32_aborts(const void *src_,
+                     const i32   offset_,
+                     void       *dst_,
+                     const i32   len_)
+{
+  const u32 *src;
+  u32 *dst;
+  jmp_buf jmpbuf;
+  unit_aborts_t old;
+  i32 n;
+  volatile i32 i;
+  volatile i32 slow;
+  volatile i32 retries;
+
+  i       = 0;
+  slow    = 0;
+  retries = 0;
+  src     = &((const u32*)src_)[offset_];
+  dst     = (u32*)dst_;
+
+  unit_aborts_catch(&old,&jmpbuf);
+  if(setjmp(jmpbuf))
+    {
+      KernelBase->kb_CatchDataAborts = &jmpbuf;
+      SVC_MEM_STATS(g_UNIT_ABORTS++);
+      if(i >= slow)
+        slow = (i + UNIT_BLOCK_LEN);
+      else if(unit_fault(&retries,i))
+        dst[i++] = g_FAULTS.pattern;
+    }
+
+  while(i < len_)
+    {
+      for(; (i < slow) && (i < len_); i++)
+        {
+          dst[i]  = ((const volatile u32*)src)[i];
+          retries = 0;
+        }
+
+      n = (len_ - i);
+      if(n > UNIT_BLOCK_LEN)
+        n = UNIT_BLOCK_LEN;
+      if(n <= 0)
+        break;
+
+      svc_mem_kern_copy_u32(&dst[i],&src[i],n);
+      i += n;
+    }
+
+  unit_aborts_release(&old);
+
+  return 0;
+}
+
+#define RD(U8,U32) {U8,U32}
+#define WR(U8,U32) {U8,U32}
+#define U8_U32     (SVC_MEM_UNIT_WIDTH_U8|SVC_MEM_UNIT_WIDTH_U32)
+#define U8_ONLY    (SVC_MEM_UNIT_WIDTH_U8)
+#define U32_ONLY   (SVC_MEM_UNIT_WIDTH_U32)
+
+static const svc_mem_unit_t g_SVC_MEM_UNITS[SVC_MEM_UNIT_MAX + 1] =
+  {
+    /* NONE */
+    {0,                0xFFFFFFFF, U8_U32,   SVC_MEM_UNIT_FLAG_CALLER, NULL,
+     RD(unit_read_u8,unit_read_u32),
+     WR(unit_write_u8,unit_write_u32)},
+    /* DRAM */
+    {DRAM_START_ADDR,  DRAM_SIZE,  U8_U32,   0,                        NULL,
+     RD(unit_read_u8,unit_read_u32),
+     WR(unit_write_u8,unit_write_u32)},
+    /* VRAM */
+    {VRAM_START_ADDR,  VRAM_SIZE,  U8_U32,   0,                        NULL,
+     RD(unit_read_u8,unit_read_u32),
+     WR(unit_write_u8,unit_write_u32)},
+    /* ROM1 */
+    {ROM1_START_ADDR,  ROM1_SIZE,  U8_U32,   SVC_MEM_UNIT_FLAG_FAULTS, unit_select_rom1,
+     RD(unit_read_u8_aborts,unit_read_u32_aborts),
+     WR(NULL,NULL)},
+    /* ROM2 */
+    {ROM2_START_ADDR,  ROM2_SIZE,  U8_U32,   SVC_MEM_UNIT_FLAG_FAULTS, unit_select_rom2,
+     RD(unit_read_u8_aborts,unit_read_u32_aborts),
+     WR(NULL,NULL)},
+    /* NVRAM - one byte per word, TODO dedicated write function */
+    {NVRAM_START_ADDR, NVRAM_SIZE, U8_ONLY,  SVC_MEM_UNIT_FLAG_FAULTS, NULL,
+     RD(unit_read_u8_per_u32_aborts,NULL),
+     WR(NULL,NULL)},
+    /* MADAM */
+    {MADAM_START_ADDR, MADAM_SIZE, U32_ONLY, SVC_MEM_UNIT_FLAG_REGS,   NULL,
+     RD(NULL,unit_read_u32_reg),
+     WR(NULL,unit_write_u32_reg)},
+    /* CLIO */
+    {CLIO_START_ADDR,  CLIO_SIZE,  U32_ONLY, SVC_MEM_UNIT_FLAG_REGS,   NULL,
+     RD(NULL,unit_read_u32_reg),
+     WR(NULL,unit_write_u32_reg)},
+    /* SPORT */
+    {SPORT_START_ADDR, SPORT_SIZE, U32_ONLY, SVC_MEM_UNIT_FLAG_REGS,   NULL,
+     RD(NULL,unit_read_u32_reg),
+     WR(NULL,unit_write_u32_reg)}
+  };
+
+const svc_mem_unit_t*
+svc_mem_unit_get(const u8 unit_)
+{
+  if(unit_ > SVC_MEM_UNIT_MAX)
+    return NULL;
+
+  return &g_SVC_MEM_UNITS[unit_];
+}
+
+/*
+  offset and len are in elements of the requested width.
+*/
+Err
+svc_mem_unit_check(const svc_mem_unit_t *unit_,
+                   const i32             in_words_,
+                   const i32             offset_,
+                   const i32             len_)
+{
+  u32 limit;
+
+  if(!(unit_->widths & (in_words_ ? SVC_MEM_UNIT_WIDTH_U32 : SVC_MEM_UNIT_WIDTH_U8)))
+    return BADSIZE;
+  if(len_ < 0)
+    return BADPTR;
+  if(unit_->flags & SVC_MEM_UNIT_FLAG_CALLER)
+    return 0;
+  if(offset_ < 0)
+    return BADPTR;
+
+  limit = (unit_->size >> (in_words_ ? 2 : 0));
+  if(((u32)offset_ > limit) || ((u32)len_ > (limit - offset_)))
+    return BADPTR;
+
+  return 0;
+}
+
+i32
+svc_mem_unit_chunkable(const u8 unit_)
+{
+  if(unit_ > SVC_MEM_UNIT_MAX)
+    return 0;
+
+  return !(g_SVC_MEM_UNITS[unit_].flags & SVC_MEM_UNIT_FLAG_REGS);
+}
+
+static
+Err
+unit_read(const svc_mem_unit_t *unit_,
+          const i32             in_words_,
+          const void           *src_,
+          const i32             offset_,
+          void                 *dst_,
+          const i32             len_)
+{
+  Err err;
+  const void *src;
+
+  err = svc_mem_unit_check(unit_,in_words_,offset_,len_);
+  if(err)
+    return err;
+  if(unit_->read[in_words_] == NULL)
+    return NOSUPPORT;
+
+  src = ((unit_->flags & SVC_MEM_UNIT_FLAG_CALLER) ? src_ : PHYS(unit_->base));
+  if(unit_->select != NULL)
+    {
+      err = unit_->select(&src);
+      if(err)
+        return err;
+    }
+
+  if(in_words_ && !aligned(src,dst_))
+    return BADPTR;
+
+  return unit_->read[in_words_](src,offset_,dst_,len_);
+}
+
+static
+Err
+unit_write(const svc_mem_unit_t *unit_,
+           const i32             in_words_,
+           const void           *src_,
+           const i32             len_,
+           void                 *dst_,
+           const i32             offset_)
+{
+  Err err;
+  void *dst;
+
+  err = svc_mem_unit_check(unit_,in_words_,offset_,len_);
+  if(err)
+    return err;
+  if(unit_->write[in_words_] == NULL)
+    return NOSUPPORT;
+
+  dst = ((unit_->flags & SVC_MEM_UNIT_FLAG_CALLER) ? dst_ : PHYS(unit_->base));
+  if(unit_->select != NULL)
+    {
+      err = unit_->select((const void**)&dst);
+      if(err)
+        return err;
+    }
+
+  if(in_words_ && !aligned(src_,dst))
+    return BADPTR;
+
+  return unit_->write[in_words_](src_,len_,dst,offset_);
+}
+
+Err
+svc_mem_unit_read(const u8    unit_,
+                  const i32   in_words_,
+                  const void *src_,
+                  const i32   offset_,
+                  void       *dst_,
+                  const i32   len_)
+{
+  Err err;
+#ifndef SVC_MEM_NO_STATS
+  u32 start;
+  u32 aborts;
+#endif
+
+  if(unit_ > SVC_MEM_UNIT_MAX)
+    return BADUNIT;
+
+  SVC_MEM_STATS(start  = SVC_MEM_CLOCK_NOW());
+  SVC_MEM_STATS(aborts = g_UNIT_ABORTS);
+
+  err = unit_read(&g_SVC_MEM_UNITS[unit_],in_words_,src_,offset_,dst_,len_);
+
+  SVC_MEM_STATS(g_SVC_MEM_STATS.units[unit_].aborts += (g_UNIT_ABORTS - aborts));
+  SVC_MEM_STATS(svc_mem_stats_xfer(unit_,0,(u32)len_ << (in_words_ ? 2 : 0),err,
+                                   SVC_MEM_CLOCK_DIFF(start,SVC_MEM_CLOCK_NOW())));
+
+  return err;
+}
+
+Err
+svc_mem_unit_write(const u8    unit_,
+                   const i32   in_words_,
+                   const void *src_,
+                   const i32   len_,
+                   void       *dst_,
+                   const i32   offset_)
+{
+  Err err;
+#ifndef SVC_MEM_NO_STATS
+  u32 start;
+#endif
+
+  if(unit_ > SVC_MEM_UNIT_MAX)
+    return BADUNIT;
+
+  SVC_MEM_STATS(start = SVC_MEM_CLOCK_NOW());
+
+  err = unit_write(&g_SVC_MEM_UNITS[unit_],in_words_,src_,len_,dst_,offset_);
+
+  SVC_MEM_STATS(svc_mem_stats_xfer(unit_,1,(u32)len_ << (in_words_ ? 2 : 0),err,
+                                   SVC_MEM_CLOCK_DIFF(start,SVC_MEM_CLOCK_NOW())));
+
+  return err;
+}
+
+/*
+  Plain memory only. `shift_` is log2 of the element size. Words go
+  through the regular bounds check, bytes and halfwords are checked in
+  bytes.
+*/
+static
+Err
+unit_fill(const svc_mem_unit_t *unit_,
+          const i32             shift_,
+          void                 *dst_,
+          const i32             offset_,
+          const i32             len_,
+          const u32             pattern_)
+{
+  Err err;
+  u8 *dst;
+
+  if(unit_->flags & (SVC_MEM_UNIT_FLAG_FAULTS|SVC_MEM_UNIT_FLAG_REGS))
+    return NOSUPPORT;
+  if(unit_->write[0] == NULL)
+    return NOSUPPORT;
+
+  if(shift_ == 2)
+    {
+      err = svc_mem_unit_check(unit_,1,offset_,len_);
+    }
+  else
+    {
+      if((len_ < 0) ||
+         (!(unit_->flags & SVC_MEM_UNIT_FLAG_CALLER) &&
+          ((offset_ | len_) & 0xC0000000)))
+        return BADPTR;
+      err = svc_mem_unit_check(unit_,0,offset_ << shift_,len_ << shift_);
+    }
+  if(err)
+    return err;
+
+  dst  = ((unit_->flags & SVC_MEM_UNIT_FLAG_CALLER) ? (u8*)dst_ : (u8*)PHYS(unit_->base));
+  dst += (offset_ << shift_);
+  if((u32)dst & ((1 << shift_) - 1))
+    return BADPTR;
+
+  switch(shift_)
+    {
+    case 0:
+      svc_mem_kern_fill_u8(dst,(u8)pattern_,len_);
+      return 0;
+    case 1:
+      svc_mem_kern_fill_u16((u16*)dst,(u16)pattern_,len_);
+      return 0;
+    case 2:
+      svc_mem_kern_fill_u32((u32*)dst,pattern_,len_);
+      return 0;
+    }
+
+  return BADSIZE;
+}
+
+Err
+svc_mem_unit_fill(const u8   unit_,
+                  const i32  shift_,
+                  void      *dst_,
+                  const i32  offset_,
+                  const i32  len_,
+                  const u32  pattern_)
+{
+  Err err;
+#ifndef SVC_MEM_NO_STATS
+  u32 start;
+#endif
+
+  if(unit_ > SVC_MEM_UNIT_MAX)
+    return BADUNIT;
+
+  SVC_MEM_STATS(start = SVC_MEM_CLOCK_NOW());
+
+  err = unit_fill(&g_SVC_MEM_UNITS[unit_],shift_,dst_,offset_,len_,pattern_);
+
+  SVC_MEM_STATS(svc_mem_stats_xfer(unit_,1,(u32)len_ << shift_,err,
+                                   SVC_MEM_CLOCK_DIFF(start,SVC_MEM_CLOCK_NOW())));
+
+  return err;
+}
+
+/*
+  Only plain memory can overlap and only a destination above the
+  source needs copying from the end.
+*/
+static
+i32
+unit_copy_backward(const svc_mem_unit_t *dunit_,
+                   const void           *dst_,
+                   const i32             doffset_,
+                   const svc_mem_unit_t *sunit_,
+                   const void           *src_,
+                   const i32             soffset_,
+                   const i32             in_words_,
+                   const i32             len_)
+{
+  i32 shift;
+  const u8 *src;
+  const u8 *dst;
+
+  if(len_ <= 0)
+    return 0;
+  if((dunit_->flags | sunit_->flags) & (SVC_MEM_UNIT_FLAG_FAULTS|SVC_MEM_UNIT_FLAG_REGS))
+    return 0;
+
+  shift = (in_words_ ? 2 : 0);
+  src   = ((sunit_->flags & SVC_MEM_UNIT_FLAG_CALLER) ? (const u8*)src_ : (const u8*)PHYS(sunit_->base));
+  dst   = ((dunit_->flags & SVC_MEM_UNIT_FLAG_CALLER) ? (const u8*)dst_ : (const u8*)PHYS(dunit_->base));
+  src  += (soffset_ << shift);
+  dst  += (doffset_ << shift);
+
+  return ((dst > src) && (dst < (src + (len_ << shift))));
+}
+
+/*
+  The source is read with its unit's reader straight into the
+  destination so ROM and NVRAM get the abort catching readers and
+  bank selection. The destination has to be plain memory.
+*/
+static
+Err
+unit_copy(const svc_mem_unit_t *dunit_,
+          void                 *dst_,
+          const i32             doffset_,
+          const svc_mem_unit_t *sunit_,
+          const void           *src_,
+          const i32             soffset_,
+          const i32             in_words_,
+          const i32             len_)
+{
+  Err err;
+  u8 *dst;
+  const void *src;
+
+  err = svc_mem_unit_check(dunit_,in_words_,doffset_,len_);
+  if(err)
+    return err;
+  err = svc_mem_unit_check(sunit_,in_words_,soffset_,len_);
+  if(err)
+    return err;
+  if(dunit_->flags & (SVC_MEM_UNIT_FLAG_FAULTS|SVC_MEM_UNIT_FLAG_REGS))
+    return NOSUPPORT;
+  if((dunit_->write[in_words_] == NULL) || (sunit_->read[in_words_] == NULL))
+    return NOSUPPORT;
+
+  dst  = ((dunit_->flags & SVC_MEM_UNIT_FLAG_CALLER) ? (u8*)dst_ : (u8*)PHYS(dunit_->base));
+  dst += (doffset_ << (in_words_ ? 2 : 0));
+  src  = ((sunit_->flags & SVC_MEM_UNIT_FLAG_CALLER) ? src_ : PHYS(sunit_->base));
+  if(sunit_->select != NULL)
+    {
+      err = sunit_->select(&src);
+      if(err)
+        return err;
+    }
+
+  if(in_words_ && !aligned(src,dst))
+    return BADPTR;
+
+  if(!unit_copy_backward(dunit_,dst_,doffset_,sunit_,src_,soffset_,in_words_,len_))
+    return sunit_->read[in_words_](src,soffset_,dst,len_);
+
+  if(in_words_)
+    svc_mem_kern_copy_u32_rev((u32*)dst,&((const u32*)src)[soffset_],len_);
+  else
+    svc_mem_kern_copy_u8_rev(dst,&((const u8*)src)[soffset_],len_);
+
+  return 0;
+}
+
+i32
+svc_mem_unit_copy_backward(const u8    dunit_,
+                           const void *dst_,
+                           const i32   doffset_,
+                           const u8    sunit_,
+                           const void *src_,
+                           const i32   soffset_,
+                           const i32   in_words_,
+                           const i32   len_)
+{
+  if((dunit_ > SVC_MEM_UNIT_MAX) || (sunit_ > SVC_MEM_UNIT_MAX))
+    return 0;
+
+  return unit_copy_backward(&g_SVC_MEM_UNITS[dunit_],dst_,doffset_,
+                            &g_SVC_MEM_UNITS[sunit_],src_,soffset_,
+                            in_words_,len_);
+}
+
+/*
+  Counted as a write to the destination. The source only gets its
+  bytes read and aborts.
+*/
+Err
+svc_mem_unit_copy(const u8    dunit_,
+                  void       *dst_,
+                  const i32   doffset_,
+                  const u8    sunit_,
+                  const void *src_,
+                  const i32   soffset_,
+                  const i32   in_words_,
+                  const i32   len_)
+{
+  Err err;
+#ifndef SVC_MEM_NO_STATS
+  u32 start;
+  u32 aborts;
+#endif
+
+  if((dunit_ > SVC_MEM_UNIT_MAX) || (sunit_ > SVC_MEM_UNIT_MAX))
+    return BADUNIT;
+
+  SVC_MEM_STATS(start  = SVC_MEM_CLOCK_NOW());
+  SVC_MEM_STATS(aborts = g_UNIT_ABORTS);
+
+  err = unit_copy(&g_SVC_MEM_UNITS[dunit_],dst_,doffset_,
+                  &g_SVC_MEM_UNITS[sunit_],src_,soffset_,
+                  in_words_,len_);
+
+  SVC_MEM_STATS(g_SVC_MEM_STATS.units[sunit_].aborts += (g_UNIT_ABORTS - aborts));
+  SVC_MEM_STATS(g_SVC_MEM_STATS.units[sunit_].bytes_read += (err ? 0 : ((u32)len_ << (in_words_ ? 2 : 0))));
+  SVC_MEM_STATS(svc_mem_stats_xfer(dunit_,1,(u32)len_ << (in_words_ ? 2 : 0),err,
+                                   SVC_MEM_CLOCK_DIFF(start,SVC_MEM_CLOCK_NOW())));
+
+  return err;
+}
+
+/*
+  Units that can't be scanned in place, those that fault or are
+  registers, and unaligned ranges are read through this buffer a piece
+  at a time with the unit's own reader.
+*/
+#define UNIT_BOUNCE_BYTES 1024
+
+static u32 g_UNIT_BOUNCE[UNIT_BOUNCE_BYTES / sizeof(u32)];
+
+static
+u32
+unit_hash(const u8   algo_,
+          const u32  h_,
+          const u8  *src_,
+          const i32  len_)
+{
+  switch(algo_)
+    {
+    case SVC_MEM_CHECKSUM_CRC32:
+      return svc_mem_kern_crc32(h_,src_,len_);
+    case SVC_MEM_CHECKSUM_ADLER32:
+      return svc_mem_kern_adler32(h_,src_,len_);
+    }
+
+  return svc_mem_kern_xor_rot(h_,src_,len_);
+}
+
+static
+Err
+unit_checksum(const svc_mem_unit_t *unit_,
+              const i32             in_words_,
+              const void           *src_,
+              const i32             offset_,
+              const i32             len_,
+              const u8              algo_,
+              u32                  *digest_)
+{
+  Err err;
+  u32 h;
+  i32 n;
+  i32 done;
+  i32 shift;
+  const u8 *p;
+  const void *src;
+
+  if(algo_ > SVC_MEM_CHECKSUM_MAX)
+    return NOSUPPORT;
+
+  err = svc_mem_unit_check(unit_,in_words_,offset_,len_);
+  if(err)
+    return err;
+  if(unit_->read[in_words_] == NULL)
+    return NOSUPPORT;
+
+  src = ((unit_->flags & SVC_MEM_UNIT_FLAG_CALLER) ? src_ : PHYS(unit_->base));
+  if(unit_->select != NULL)
+    {
+      err = unit_->select(&src);
+      if(err)
+        return err;
+    }
+
+  if(in_words_ && !aligned(src,NULL))
+    return BADPTR;
+
+  h     = *digest_;
+  shift = (in_words_ ? 2 : 0);
+  p     = ((const u8*)src + (offset_ << shift));
+  if(!(unit_->flags & (SVC_MEM_UNIT_FLAG_FAULTS|SVC_MEM_UNIT_FLAG_REGS)) &&
+     aligned(p,NULL))
+    {
+      *digest_ = unit_hash(algo_,h,p,len_ << shift);
+      return 0;
+    }
+
+  for(done = 0; done < len_; done += n)
+    {
+      n = (UNIT_BOUNCE_BYTES >> shift);
+      if(n > (len_ - done))
+        n = (len_ - done);
+
+      err = unit_->read[in_words_](src,offset_ + done,g_UNIT_BOUNCE,n);
+      if(err)
+        return err;
+
+      h = unit_hash(algo_,h,(const u8*)g_UNIT_BOUNCE,n << shift);
+    }
+
+  *digest_ = h;
+
+  return 0;
+}
+
+/*
+  `digest_` holds the digest to continue from and receives the new
+  one.
+*/
+Err
+svc_mem_unit_checksum(const u8    unit_,
+                      const i32   in_words_,
+                      const void *src_,
+                      const i32   offset_,
+                      const i32   len_,
+                      const u8    algo_,
+                      u32        *digest_)
+{
+  Err err;
+#ifndef SVC_MEM_NO_STATS
+  u32 start;
+  u32 aborts;
+#endif
+
+  if(unit_ > SVC_MEM_UNIT_MAX)
+    return BADUNIT;
+
+  SVC_MEM_STATS(start  = SVC_MEM_CLOCK_NOW());
+  SVC_MEM_STATS(aborts = g_UNIT_ABORTS);
+
+  err = unit_checksum(&g_SVC_MEM_UNITS[unit_],in_words_,src_,offset_,len_,algo_,digest_);
+
+  SVC_MEM_STATS(g_SVC_MEM_STATS.units[unit_].aborts += (g_UNIT_ABORTS - aborts));
+  SVC_MEM_STATS(svc_mem_stats_xfer(unit_,0,(u32)len_ << (in_words_ ? 2 : 0),err,
+                                   SVC_MEM_CLOCK_DIFF(start,SVC_MEM_CLOCK_NOW())));
+
+  return err;
+}
+
+/*
+  SVC_MEM_CHECKSUM_XOR_ROT of a byte range for the watches. They run
+  often and are left out of the statistics.
+*/
+Err
+svc_mem_unit_hash(const u8   unit_,
+                  const i32  offset_,
+                  const i32  len_,
+                  u32       *digest_)
+{
+  if(unit_ > SVC_MEM_UNIT_MAX)
+    return BADUNIT;
+
+  *digest_ = SVC_MEM_CHECKSUM_INIT(SVC_MEM_CHECKSUM_XOR_ROT);
+
+  return unit_checksum(&g_SVC_MEM_UNITS[unit_],0,NULL,offset_,len_,
+                       SVC_MEM_CHECKSUM_XOR_ROT,digest_);
+}
+
+/*
+  Byte searches look for the first element of the pattern a word at a
+  time. Each byte of the word is xored with it, under its mask, and
+  the word is only looked at more closely if one of the results is 0.
+*/
+#define UNIT_HASZERO(w_) (((w_) - 0x01010101) & ~(w_) & 0x80808080)
+
+typedef struct unit_search_s unit_search_t;
+struct unit_search_s
+{
+  const svc_mem_search_t *desc;
+  i32                    *hits;
+  i32                     max;
+};
+
+static
+i32
+unit_search_match_u32(const svc_mem_search_t *d_,
+                      const u32              *p_)
+{
+  i32 i;
+  const u32 *pat = (const u32*)d_->pattern;
+  const u32 *msk = (const u32*)d_->mask;
+
+  for(i = 0; i < d_->pattern_len; i++)
+    {
+      if(((p_[i] ^ pat[i]) & (msk ? msk[i] : 0xFFFFFFFF)) != 0)
+        return 0;
+    }
+
+  return 1;
+}
+
+static
+i32
+unit_search_match_u8(const svc_mem_search_t *d_,
+                     const u8               *p_)
+{
+  i32 i;
+  const u8 *pat = (const u8*)d_->pattern;
+  const u8 *msk = (const u8*)d_->mask;
+
+  for(i = 0; i < d_->pattern_len; i++)
+    {
+      if(((p_[i] ^ pat[i]) & (msk ? msk[i] : 0xFF)) != 0)
+        return 0;
+    }
+
+  return 1;
+}
+
+/*
+  Records a match at element `pos_`. Returns non-zero once full.
+*/
+static
+i32
+unit_search_hit(const unit_search_t *s_,
+                const i32            pos_,
+                i32                 *nhits_)
+{
+  s_->hits[(*nhits_)++] = pos_;
+
+  return (*nhits_ >= s_->max);
+}
+
+/*
+  Tries every position in [0, npos_) of `p_`, the data extending
+  pattern_len - 1 elements past it. `base_` is the unit offset of p_.
+*/
+static
+void
+unit_search_buf(const unit_search_t *s_,
+                const i32            shift_,
+                const u8            *p_,
+                const i32            npos_,
+                const i32            base_,
+                i32                 *nhits_)
+{
+  i32 i;
+  i32 k;
+  u32 m;
+  u32 x;
+  u32 v;
+
+  if(*nhits_ >= s_->max)
+    return;
+
+  if(shift_)
+    {
+      for(i = 0; i < npos_; i++)
+        {
+          if(unit_search_match_u32(s_->desc,&((const u32*)p_)[i]) &&
+             unit_search_hit(s_,base_ + i,nhits_))
+            return;
+        }
+      return;
+    }
+
+  m = (s_->desc->mask ? ((const u8*)s_->desc->mask)[0] : 0xFF) * 0x01010101U;
+  v = (((const u8*)s_->desc->pattern)[0] * 0x01010101U) & m;
+
+  for(i = 0; (i < npos_) && ((u32)&p_[i] & 0x3); i++)
+    {
+      if(unit_search_match_u8(s_->desc,&p_[i]) &&
+         unit_search_hit(s_,base_ + i,nhits_))
+        return;
+    }
+
+  for(; (i + 4) <= npos_; i += 4)
+    {
+      x = ((*(const u32*)&p_[i] & m) ^ v);
+      if(!UNIT_HASZERO(x))
+        continue;
+      for(k = i; k < (i + 4); k++)
+        {
+          if(unit_search_match_u8(s_->desc,&p_[k]) &&
+             unit_search_hit(s_,base_ + k,nhits_))
+            return;
+        }
+    }
+
+  for(; i < npos_; i++)
+    {
+      if(unit_search_match_u8(s_->desc,&p_[i]) &&
+         unit_search_hit(s_,base_ + i,nhits_))
+        return;
+    }
+}
+
+static
+Err
+unit_search(const svc_mem_unit_t *unit_,
+            const i32             in_words_,
+            const void           *src_,
+            const i32             offset_,
+            const i32             len_,
+            const unit_search_t  *s_,
+            i32                  *nhits_)
+{
+  Err err;
+  i32 n;
+  i32 pos;
+  i32 win;
+  i32 npos;
+  i32 plen;
+  i32 shift;
+  const void *src;
+
+  shift = (in_words_ ? 2 : 0);
+  plen  = s_->desc->pattern_len;
+  if((plen <= 0) || ((plen << shift) > SVC_MEM_SEARCH_MAX_PATTERN))
+    return BADSIZE;
+  if(s_->desc->pattern == NULL)
+    return BADPTR;
+
+  err = svc_mem_unit_check(unit_,in_words_,offset_,len_);
+  if(err)
+    return err;
+  if(unit_->read[in_words_] == NULL)
+    return NOSUPPORT;
+
+  src = ((unit_->flags & SVC_MEM_UNIT_FLAG_CALLER) ? src_ : PHYS(unit_->base));
+  if(unit_->select != NULL)
+    {
+      err = unit_->select(&src);
+      if(err)
+        return err;
+    }
+
+  if(in_words_ && !aligned(src,s_->desc->pattern))
+    return BADPTR;
+
+  npos = (len_ - plen + 1);
+  if(npos <= 0)
+    return 0;
+
+  if(!(unit_->flags & (SVC_MEM_UNIT_FLAG_FAULTS|SVC_MEM_UNIT_FLAG_REGS)))
+    {
+      unit_search_buf(s_,shift,(const u8*)src + (offset_ << shift),npos,offset_,nhits_);
+      return 0;
+    }
+
+  win = (UNIT_BOUNCE_BYTES >> shift);
+  for(pos = 0; (pos < npos) && (*nhits_ < s_->max); pos += n)
+    {
+      n = (win - plen + 1);
+      if(n > (npos - pos))
+        n = (npos - pos);
+
+      err = unit_->read[in_words_](src,offset_ + pos,g_UNIT_BOUNCE,n + plen - 1);
+      if(err)
+        return err;
+
+      unit_search_buf(s_,shift,(const u8*)g_UNIT_BOUNCE,n,offset_ + pos,nhits_);
+    }
+
+  return 0;
+}
+
+/*
+  Searches the `len_` elements from `offset_` for `desc_`'s pattern,
+  appending matches to `hits_` until `*nhits_` reaches `max_`.
+*/
+Err
+svc_mem_unit_search(const u8                unit_,
+                    const i32               in_words_,
+                    const void             *src_,
+                    const i32               offset_,
+                    const i32               len_,
+                    const svc_mem_search_t *desc_,
+                    i32                    *hits_,
+                    const i32               max_,
+                    i32                    *nhits_)
+{
+  Err err;
+  unit_search_t s;
+#ifndef SVC_MEM_NO_STATS
+  u32 start;
+  u32 aborts;
+#endif
+
+  if(unit_ > SVC_MEM_UNIT_MAX)
+    return BADUNIT;
+
+  s.desc = desc_;
+  s.hits = hits_;
+  s.max  = max_;
+
+  SVC_MEM_STATS(start  = SVC_MEM_CLOCK_NOW());
+  SVC_MEM_STATS(aborts = g_UNIT_ABORTS);
+
+  err = unit_search(&g_SVC_MEM_UNITS[unit_],in_words_,src_,offset_,len_,&s,nhits_);
+
+  SVC_MEM_STATS(g_SVC_MEM_STATS.units[unit_].aborts += (g_UNIT_ABORTS - aborts));
+  SVC_MEM_STATS(svc_mem_stats_xfer(unit_,0,(u32)len_ << (in_words_ ? 2 : 0),err,
+                                   SVC_MEM_CLOCK_DIFF(start,SVC_MEM_CLOCK_NOW())));
+
+  return err;
+}
+
+/*
+  Index of the first element from `i_` that differs. Unchanged
+  stretches of bytes are skipped a word at a time when both sides
+  share their alignment.
+*/
+static
+i32
+unit_diff_skip(const u8  *a_,
+               const u8  *b_,
+               i32        i_,
+               const i32  len_,
+               const i32  shift_)
+{
+  if(shift_)
+    {
+      while((i_ < len_) && (((const u32*)a_)[i_] == ((const u32*)b_)[i_]))
+        i_++;
+      return i_;
+    }
+
+  if(!(((u32)a_ ^ (u32)b_) & 0x3))
+    {
+      for(; (i_ < len_) && ((u32)&a_[i_] & 0x3); i_++)
+        {
+          if(a_[i_] != b_[i_])
+            return i_;
+        }
+      while(((i_ + 4) <= len_) && (*(const u32*)&a_[i_] == *(const u32*)&b_[i_]))
+        i_ += 4;
+    }
+
+  while((i_ < len_) && (a_[i_] == b_[i_]))
+    i_++;
+
+  return i_;
+}
+
+/*
+  Index of the first element from `i_` that is unchanged.
+*/
+static
+i32
+unit_diff_end(const u8  *a_,
+              const u8  *b_,
+              i32        i_,
+              const i32  len_,
+              const i32  shift_)
+{
+  if(shift_)
+    {
+      while((i_ < len_) && (((const u32*)a_)[i_] != ((const u32*)b_)[i_]))
+        i_++;
+      return i_;
+    }
+
+  while((i_ < len_) && (a_[i_] != b_[i_]))
+    i_++;
+
+  return i_;
+}
+
+/*
+  Returns non-zero once the run array has overflowed.
+*/
+static
+i32
+unit_diff_add(svc_mem_diff_t     *desc_,
+              svc_mem_diff_run_t *runs_,
+              const i32           max_,
+              const i32           offset_,
+              const i32           len_)
+{
+  svc_mem_diff_run_t *last;
+
+  if(desc_->runs > 0)
+    {
+      last = &runs_[desc_->runs - 1];
+      if((last->offset + last->len) == offset_)
+        {
+          last->len += len_;
+          return 0;
+        }
+    }
+
+  if(desc_->runs >= max_)
+    {
+      desc_->overflow = 1;
+      return 1;
+    }
+
+  runs_[desc_->runs].offset = offset_;
+  runs_[desc_->runs].len    = len_;
+  desc_->runs++;
+
+  return 0;
+}
+
+static
+void
+unit_diff_buf(const u8           *a_,
+              const u8           *b_,
+              const i32           len_,
+              const i32           shift_,
+              const i32           base_,
+              svc_mem_diff_t     *desc_,
+              svc_mem_diff_run_t *runs_,
+              const i32           max_)
+{
+  i32 i;
+  i32 end;
+
+  i = 0;
+  while(!desc_->overflow)
+    {
+      i = unit_diff_skip(a_,b_,i,len_,shift_);
+      if(i >= len_)
+        return;
+
+      end = unit_diff_end(a_,b_,i,len_,shift_);
+      unit_diff_add(desc_,runs_,max_,base_ + i,end - i);
+      i = end;
+    }
+}
+
+static
+Err
+unit_diff(const svc_mem_unit_t *unit_,
+          const i32             in_words_,
+          const void           *src_,
+          const i32             offset_,
+          const i32             len_,
+          const void           *ref_,
+          svc_mem_diff_t       *desc_,
+          svc_mem_diff_run_t   *runs_,
+          const i32             max_)
+{
+  Err err;
+  i32 n;
+  i32 pos;
+  i32 shift;
+  const u8 *ref;
+  const void *src;
+
+  err = svc_mem_unit_check(unit_,in_words_,offset_,len_);
+  if(err)
+    return err;
+  if(unit_->read[in_words_] == NULL)
+    return NOSUPPORT;
+  if(ref_ == NULL)
+    return BADPTR;
+
+  src = ((unit_->flags & SVC_MEM_UNIT_FLAG_CALLER) ? src_ : PHYS(unit_->base));
+  if(unit_->select != NULL)
+    {
+      err = unit_->select(&src);
+      if(err)
+        return err;
+    }
+
+  if(in_words_ && !aligned(src,ref_))
+    return BADPTR;
+
+  shift = (in_words_ ? 2 : 0);
+  ref   = (const u8*)ref_;
+  if(!(unit_->flags & (SVC_MEM_UNIT_FLAG_FAULTS|SVC_MEM_UNIT_FLAG_REGS)))
+    {
+      unit_diff_buf((const u8*)src + (offset_ << shift),ref,len_,shift,offset_,desc_,runs_,max_);
+      return 0;
+    }
+
+  for(pos = 0; (pos < len_) && !desc_->overflow; pos += n)
+    {
+      n = (UNIT_BOUNCE_BYTES >> shift);
+      if(n > (len_ - pos))
+        n = (len_ - pos);
+
+      err = unit_->read[in_words_](src,offset_ + pos,g_UNIT_BOUNCE,n);
+      if(err)
+        return err;
+
+      unit_diff_buf((const u8*)g_UNIT_BOUNCE,&ref[pos << shift],n,shift,offset_ + pos,desc_,runs_,max_);
+    }
+
+  return 0;
+}
+
+/*
+  Compares the `len_` elements from `offset_` with `ref_`, adding the
+  runs that differ to `runs_` and `desc_->runs`.
+*/
+Err
+svc_mem_unit_diff(const u8            unit_,
+                  const i32           in_words_,
+                  const void         *src_,
+                  const i32           offset_,
+                  const i32           len_,
+                  const void         *ref_,
+                  svc_mem_diff_t     *desc_,
+                  svc_mem_diff_run_t *runs_,
+                  const i32           max_)
+{
+  Err err;
+#ifndef SVC_MEM_NO_STATS
+  u32 start;
+  u32 aborts;
+#endif
+
+  if(unit_ > SVC_MEM_UNIT_MAX)
+    return BADUNIT;
+  if(desc_->overflow)
+    return 0;
+
+  SVC_MEM_STATS(start  = SVC_MEM_CLOCK_NOW());
+  SVC_MEM_STATS(aborts = g_UNIT_ABORTS);
+
+  err = unit_diff(&g_SVC_MEM_UNITS[unit_],in_words_,src_,offset_,len_,ref_,desc_,runs_,max_);
+
+  SVC_MEM_STATS(g_SVC_MEM_STATS.units[unit_].aborts += (g_UNIT_ABORTS - aborts));
+  SVC_MEM_STATS(svc_mem_stats_xfer(unit_,0,(u32)len_ << (in_words_ ? 2 : 0),err,
+                                   SVC_MEM_CLOCK_DIFF(start,SVC_MEM_CLOCK_NOW())));
+
+  return err;
+}
+
+/*
+  Writes the changed runs of one span, bridging gaps of up to
+  SVC_MEM_DELTA_GAP unchanged words. Returns the words written.
+*/
+static
+i32
+unit_delta_span(u32       *dst_,
+                const u32 *next_,
+                const u32 *prev_,
+                const i32  len_)
+{
+  i32 i;
+  i32 end;
+  i32 nxt;
+  i32 written;
+  const u8 *n = (const u8*)next_;
+  const u8 *p = (const u8*)prev_;
+
+  if(prev_ == NULL)
+    {
+      svc_mem_kern_copy_u32(dst_,next_,len_);
+      return len_;
+    }
+
+  written = 0;
+  i = unit_diff_skip(n,p,0,len_,2);
+  while(i < len_)
+    {
+      end = unit_diff_end(n,p,i,len_,2);
+      nxt = unit_diff_skip(n,p,end,len_,2);
+      while((nxt < len_) && ((nxt - end) <= SVC_MEM_DELTA_GAP))
+        {
+          end = unit_diff_end(n,p,nxt,len_,2);
+          nxt = unit_diff_skip(n,p,end,len_,2);
+        }
+
+      svc_mem_kern_copy_u32(&dst_[i],&next_[i],end - i);
+      written += (end - i);
+      i = nxt;
+    }
+
+  return written;
+}
+
+static
+Err
+unit_delta_rect_check(const svc_mem_rect_t *rect_,
+                      const i32             len_)
+{
+  u32 last;
+
+  if((rect_->offset < 0) || (rect_->row_len < 0) ||
+     (rect_->stride < 0) || (rect_->rows < 0))
+    return BADPTR;
+  if(rect_->rows == 0)
+    return 0;
+  if((rect_->rows > 1) &&
+     ((u32)rect_->stride > ((u32)len_ / (u32)(rect_->rows - 1))))
+    return BADPTR;
+
+  last = ((u32)rect_->offset + ((u32)rect_->stride * (rect_->rows - 1)));
+  if((last > (u32)len_) || ((u32)rect_->row_len > ((u32)len_ - last)))
+    return BADPTR;
+
+  return 0;
+}
+
+/*
+  Handles the words of the frame from `start_` to `start_ + len_`,
+  the rows of the rectangles clipped to them, adding what it writes
+  to `written`.
+*/
+static
+Err
+unit_delta(const svc_mem_unit_t *unit_,
+           void                 *dst_,
+           const i32             offset_,
+           svc_mem_delta_t      *desc_,
+           const i32             start_,
+           const i32             len_)
+{
+  Err err;
+  i32 i;
+  i32 r;
+  i32 lo;
+  i32 hi;
+  i32 off;
+  i32 end;
+  u32 *dst;
+  const svc_mem_rect_t *rect;
+
+  if((start_ < 0) || (len_ < 0) || (len_ > (desc_->len - start_)))
+    return BADSIZE;
+
+  err = svc_mem_unit_check(unit_,1,offset_,desc_->len);
+  if(err)
+    return err;
+  if(unit_->flags & (SVC_MEM_UNIT_FLAG_FAULTS|SVC_MEM_UNIT_FLAG_REGS))
+    return NOSUPPORT;
+  if(unit_->write[1] == NULL)
+    return NOSUPPORT;
+  if((desc_->next == NULL) || ((desc_->rects == NULL) && (desc_->nrects > 0)))
+    return BADPTR;
+
+  dst = (u32*)((unit_->flags & SVC_MEM_UNIT_FLAG_CALLER) ? dst_ : PHYS(unit_->base));
+  dst = &dst[offset_];
+  if(!aligned(dst,desc_->next) || !aligned(desc_->prev,NULL))
+    return BADPTR;
+
+  end = (start_ + len_);
+  if(desc_->rects == NULL)
+    {
+      desc_->written += unit_delta_span(&dst[start_],
+                                        &desc_->next[start_],
+                                        (desc_->prev ? &desc_->prev[start_] : NULL),
+                                        len_);
+      return 0;
+    }
+
+  for(i = 0; i < desc_->nrects; i++)
+    {
+      err = unit_delta_rect_check(&desc_->rects[i],desc_->len);
+      if(err)
+        return err;
+    }
+
+  for(i = 0; i < desc_->nrects; i++)
+    {
+      rect = &desc_->rects[i];
+      off  = rect->offset;
+      for(r = 0; (r < rect->rows) && (off < end); r++, off += rect->stride)
+        {
+          lo = ((off > start_) ? off : start_);
+          hi = (((off + rect->row_len) < end) ? (off + rect->row_len) : end);
+          if(lo >= hi)
+            continue;
+
+          desc_->written += unit_delta_span(&dst[lo],
+                                            &desc_->next[lo],
+                                            (desc_->prev ? &desc_->prev[lo] : NULL),
+                                            hi - lo);
+        }
+    }
+
+  return 0;
+}
+
+Err
+svc_mem_unit_delta(const u8         unit_,
+                   void            *dst_,
+                   const i32        offset_,
+                   svc_mem_delta_t *desc_,
+                   const i32        start_,
+                   const i32        len_)
+{
+  i32 written;
+  Err err;
+#ifndef SVC_MEM_NO_STATS
+  u32 start;
+#endif
+
+  if(unit_ > SVC_MEM_UNIT_MAX)
+    return BADUNIT;
+
+  SVC_MEM_STATS(start = SVC_MEM_CLOCK_NOW());
+
+  written = desc_->written;
+  err     = unit_delta(&g_SVC_MEM_UNITS[unit_],dst_,offset_,desc_,start_,len_);
+
+  SVC_MEM_STATS(svc_mem_stats_xfer(unit_,1,(desc_->written - written) << 2,err,
+                                   SVC_MEM_CLOCK_DIFF(start,SVC_MEM_CLOCK_NOW())));
+
+  return err;
+}
+
+/*
+  Converts words [done_, done_ + len_) of a width_ x height_ line
+  paired bitmap at `offset_` into the linear image `dst_`. Word k is
+  pixel (k % width) of line pair (k / width).
+*/
+static
+Err
+unit_capture(const svc_mem_unit_t *unit_,
+             const void           *src_,
+             const i32             offset_,
+             const i32             width_,
+             const i32             height_,
+             i32                   done_,
+             const i32             len_,
+             u16                  *dst_,
+             const u32             flags_)
+{
+  Err err;
+  i32 n;
+  i32 x;
+  i32 end;
+  i32 pair;
+  u16 *hi;
+  u32 mask;
+  const u32 *src;
+
+  if((width_ <= 0) || (height_ <= 0))
+    return BADSIZE;
+  if((done_ < 0) || (len_ < 0) || (len_ > (SVC_MEM_CAPTURE_WORDS(width_,height_) - done_)))
+    return BADSIZE;
+
+  err = svc_mem_unit_check(unit_,1,offset_,SVC_MEM_CAPTURE_WORDS(width_,height_));
+  if(err)
+    return err;
+  if(unit_->flags & (SVC_MEM_UNIT_FLAG_FAULTS|SVC_MEM_UNIT_FLAG_REGS))
+    return NOSUPPORT;
+
+  src = (const u32*)((unit_->flags & SVC_MEM_UNIT_FLAG_CALLER) ? src_ : PHYS(unit_->base));
+  if(!aligned(src,NULL) || ((u32)dst_ & 0x1))
+    return BADPTR;
+
+  src  = &src[offset_];
+  mask = ((flags_ & SVC_MEM_CMD_FLAG_RGB15) ? 0x7FFF : 0xFFFF);
+  for(end = (done_ + len_); done_ < end; done_ += n)
+    {
+      pair = (done_ / width_);
+      x    = (done_ - (pair * width_));
+      n    = (width_ - x);
+      if(n > (end - done_))
+        n = (end - done_);
+
+      hi = &dst_[(pair * 2 * width_) + x];
+      svc_mem_kern_split_u16(hi,
+                             ((((pair * 2) + 1) < height_) ? (hi + width_) : NULL),
+                             &src[done_],
+                             n,
+                             mask,
+                             !!(flags_ & SVC_MEM_CMD_FLAG_SWAP));
+    }
+
+  return 0;
+}
+
+Err
+svc_mem_unit_capture(const u8    unit_,
+                     const void *src_,
+                     const i32   offset_,
+                     const i32   width_,
+                     const i32   height_,
+                     const i32   done_,
+                     const i32   len_,
+                     u16        *dst_,
+                     const u32   flags_)
+{
+  Err err;
+#ifndef SVC_MEM_NO_STATS
+  u32 start;
+#endif
+
+  if(unit_ > SVC_MEM_UNIT_MAX)
+    return BADUNIT;
+
+  SVC_MEM_STATS(start = SVC_MEM_CLOCK_NOW());
+
+  err = unit_capture(&g_SVC_MEM_UNITS[unit_],src_,offset_,width_,height_,
+                     done_,len_,dst_,flags_);
+
+  SVC_MEM_STATS(svc_mem_stats_xfer(unit_,0,(u32)len_ << 2,err,
+                                   SVC_MEM_CLOCK_DIFF(start,SVC_MEM_CLOCK_NOW())));
+
+  return err;
+}
+
+static
+Err
+unit_sport_check(const i32 offset_,
+                 const i32 pages_)
+{
+  if((offset_ < 0) || (pages_ < 0))
+    return BADPTR;
+  if(offset_ & (SVC_MEM_SPORT_PAGE_SIZE - 1))
+    return BADPTR;
+  if(((u32)offset_ > VRAM_SIZE) ||
+     ((u32)pages_ > ((VRAM_SIZE - (u32)offset_) / SVC_MEM_SPORT_PAGE_SIZE)))
+    return BADPTR;
+
+  return 0;
+}
+
+/*
+  The whole request, checked before it is queued for a vertical
+  blank.
+*/
+Err
+svc_mem_unit_sport_check(const u8  op_,
+                         const i32 offset_,
+                         const u32 arg_,
+                         const i32 pages_)
+{
+  Err err;
+
+  if(op_ > SVC_MEM_SPORT_OP_MAX)
+    return NOSUPPORT;
+
+  err = unit_sport_check(offset_,pages_);
+  if(err)
+    return err;
+  if(op_ == SVC_MEM_SPORT_OP_COPY)
+    return unit_sport_check((i32)arg_,pages_);
+
+  return 0;
+}
+
+/*
+  `offset_` and `arg_` as with SVC_MEM_CMD_SPORT. A copy to higher
+  pages it overlaps goes from the last page back.
+*/
+static
+Err
+unit_sport(const u8  op_,
+           const i32 offset_,
+           const u32 arg_,
+           const i32 pages_,
+           const i32 cpu_)
+{
+  Err err;
+  i32 i;
+  i32 step;
+  u32 *dst;
+  const u32 *src;
+
+  err = unit_sport_check(offset_,pages_);
+  if(err)
+    return err;
+
+  dst = ((u32*)PHYS(VRAM_START_ADDR) + (offset_ >> 2));
+  switch(op_)
+    {
+    case SVC_MEM_SPORT_OP_FLASH:
+      if(cpu_)
+        {
+          svc_mem_kern_fill_u32(dst,arg_,pages_ * SPORT_PAGE_WORDS);
+          return 0;
+        }
+
+      SPORT_WR(SPORT_ADDR(SPORT_OP_COLOUR,0),arg_);
+      for(i = 0; i < pages_; i++)
+        SPORT_WR(SPORT_ADDR(SPORT_OP_FLASH,offset_ + (i * SVC_MEM_SPORT_PAGE_SIZE)),0xFFFFFFFF);
+      return 0;
+    case SVC_MEM_SPORT_OP_COPY:
+      err = unit_sport_check((i32)arg_,pages_);
+      if(err)
+        return err;
+
+      src = ((const u32*)PHYS(VRAM_START_ADDR) + (arg_ >> 2));
+      if(cpu_)
+        {
+          if(dst > src)
+            svc_mem_kern_copy_u32_rev(dst,src,pages_ * SPORT_PAGE_WORDS);
+          else
+            svc_mem_kern_copy_u32(dst,src,pages_ * SPORT_PAGE_WORDS);
+          return 0;
+        }
+
+      i    = ((dst > src) ? (pages_ - 1) : 0);
+      step = ((dst > src) ? -1 : 1);
+      for(; (i >= 0) && (i < pages_); i += step)
+        {
+          SPORT_WR(SPORT_ADDR(SPORT_OP_LOAD,arg_ + (i * SVC_MEM_SPORT_PAGE_SIZE)),0);
+          SPORT_WR(SPORT_ADDR(SPORT_OP_STORE,offset_ + (i * SVC_MEM_SPORT_PAGE_SIZE)),0xFFFFFFFF);
+        }
+      return 0;
+    }
+
+  return NOSUPPORT;
+}
+
+Err
+svc_mem_unit_sport(const u8  op_,
+                   const i32 offset_,
+                   const u32 arg_,
+                   const i32 pages_,
+                   const i32 cpu_)
+{
+  Err err;
+#ifndef SVC_MEM_NO_STATS
+  u32 start;
+#endif
+
+  SVC_MEM_STATS(start = SVC_MEM_CLOCK_NOW());
+
+  err = unit_sport(op_,offset_,arg_,pages_,cpu_);
+
+  SVC_MEM_STATS(svc_mem_stats_xfer(SVC_MEM_UNIT_VRAM,1,(u32)pages_ * SVC_MEM_SPORT_PAGE_SIZE,err,
+                                   SVC_MEM_CLOCK_DIFF(start,SVC_MEM_CLOCK_NOW())));
+
+  return err;
+}
+
+/*
+  Single word accesses to word units other than those that may data
+  abort. SPORT writes start transfers so only reads are allowed.
+*/
+static
+Err
+unit_word_check(const svc_mem_unit_t *unit_,
+                const i32             offset_,
+                const i32             write_)
+{
+  if(unit_->flags & (SVC_MEM_UNIT_FLAG_CALLER|SVC_MEM_UNIT_FLAG_FAULTS))
+    return NOSUPPORT;
+  if((unit_->read[1] == NULL) || (write_ && (unit_->write[1] == NULL)))
+    return NOSUPPORT;
+  if(write_ && (unit_->base == SPORT_START_ADDR))
+    return NOSUPPORT;
+
+  return svc_mem_unit_check(unit_,1,offset_,1);
+}
+
+static
+Err
+unit_rmw_check(const svc_mem_unit_t *unit_,
+               const svc_mem_rmw_t  *ent_)
+{
+  if(ent_->op > SVC_MEM_RMW_OP_MAX)
+    return NOSUPPORT;
+
+  return unit_word_check(unit_,ent_->offset,1);
+}
+
+static
+Err
+unit_rmw(const svc_mem_unit_t *unit_,
+         const svc_mem_rmw_t  *ent_,
+         u32                  *old_)
+{
+  Err err;
+  u32 w;
+  u32 old;
+  void *base;
+
+  err = unit_rmw_check(unit_,ent_);
+  if(err)
+    return err;
+
+  base = PHYS(unit_->base);
+  unit_->read[1](base,ent_->offset,&old,1);
+  *old_ = old;
+
+  switch(ent_->op)
+    {
+    case SVC_MEM_RMW_OP_AND:
+      w = (old & ent_->value);
+      break;
+    case SVC_MEM_RMW_OP_OR:
+      w = (old | ent_->value);
+      break;
+    case SVC_MEM_RMW_OP_XOR:
+      w = (old ^ ent_->value);
+      break;
+    case SVC_MEM_RMW_OP_INSERT:
+      w = ((old & ~ent_->mask) | (ent_->value & ent_->mask));
+      break;
+    default:
+      if(old != ent_->mask)
+        return 0;
+      w = ent_->value;
+      break;
+    }
+
+  return unit_->write[1](&w,1,base,ent_->offset);
+}
+
+Err
+svc_mem_unit_rmw_check(const svc_mem_rmw_t *ent_)
+{
+  if(ent_->unit > SVC_MEM_UNIT_MAX)
+    return BADUNIT;
+
+  return unit_rmw_check(&g_SVC_MEM_UNITS[ent_->unit],ent_);
+}
+
+/*
+  The caller disables interrupts around it.
+*/
+Err
+svc_mem_unit_rmw(const svc_mem_rmw_t *ent_,
+                 u32                 *old_)
+{
+  Err err;
+#ifndef SVC_MEM_NO_STATS
+  u32 start;
+#endif
+
+  if(ent_->unit > SVC_MEM_UNIT_MAX)
+    return BADUNIT;
+
+  SVC_MEM_STATS(start = SVC_MEM_CLOCK_NOW());
+
+  err = unit_rmw(&g_SVC_MEM_UNITS[ent_->unit],ent_,old_);
+
+  // a CAS that didn't match only read the word
+  SVC_MEM_STATS(svc_mem_stats_xfer(ent_->unit,
+                                   !(!err && (ent_->op == SVC_MEM_RMW_OP_CAS) && (*old_ != ent_->mask)),
+                                   sizeof(u32),err,
+                                   SVC_MEM_CLOCK_DIFF(start,SVC_MEM_CLOCK_NOW())));
+
+  return err;
+}
+
+/*
+  Reads of single words for polling and sampling. They are frequent
+  and left out of the statistics.
+*/
+Err
+svc_mem_unit_word(const u8   unit_,
+                  const i32  offset_,
+                  u32       *word_)
+{
+  Err err;
+  const svc_mem_unit_t *unit;
+
+  if(unit_ > SVC_MEM_UNIT_MAX)
+    return BADUNIT;
+
+  unit = &g_SVC_MEM_UNITS[unit_];
+  err  = unit_word_check(unit,offset_,0);
+  if(err)
+    return err;
+
+  return unit->read[1](PHYS(unit->base),offset_,word_,1);
+}
+
+/*
+  Returns 1 once (word & mask) == expected, 0 while not.
+*/
+Err
+svc_mem_unit_poll(const u8        unit_,
+                  const i32       offset_,
+                  svc_mem_wait_t *desc_)
+{
+  Err err;
+
+  err = svc_mem_unit_word(unit_,offset_,&desc_->word);
+  if(err)
+    return err;
+
+  return ((desc_->word & desc_->mask) == desc_->expected);
+}
+
+/*
+  As svc_mem_unit_read but faulting elements are filled with
+  `pattern_` and, if `map_` is not NULL, bit (map_base_ + index) is set
+  in it. Returns the number of faulting elements in `faults_`.
+*/
+Err
+svc_mem_unit_read_faults(const u8    unit_,
+                         const i32   in_words_,
+                         const i32   offset_,
+                         void       *dst_,
+                         const i32   len_,
+                         const u32   pattern_,
+                         u32        *map_,
+                         const i32   map_base_,
+                         i32        *faults_)
+{
+  Err err;
+
+  g_FAULTS.pattern  = pattern_;
+  g_FAULTS.map      = map_;
+  g_FAULTS.map_base = map_base_;
+  g_FAULTS.count    = 0;
+
+  err = svc_mem_unit_read(unit_,in_words_,NULL,offset_,dst_,len_);
+
+  if(faults_ != NULL)
+    *faults_ = g_FAULTS.count;
+
+  g_FAULTS.pattern  = 0;
+  g_FAULTS.map      = NULL;
+  g_FAULTS.map_base = 0;
+
+  return err;
+}
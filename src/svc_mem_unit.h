@@ -0,0 +1,89 @@
+/*
+  ISC License
+
+  Copyright (c) 2024, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#pragma once
+
+#include "svc_mem_drv_opts.h"
+
+#include "types.h"
+
+#define SVC_MEM_UNIT_WIDTH_U8  (1 << 0)
+#define SVC_MEM_UNIT_WIDTH_U32 (1 << 1)
+
+// base comes from the caller rather than the table (NONE)
+#define SVC_MEM_UNIT_FLAG_CALLER (1 << 0)
+// reads may data abort and go through the abort catching readers
+#define SVC_MEM_UNIT_FLAG_FAULTS (1 << 1)
+// memory mapped registers, accessed a word at a time and never chunked
+#define SVC_MEM_UNIT_FLAG_REGS   (1 << 2)
+
+typedef Err (*svc_mem_unit_read_fn)(const void *src, i32 offset, void *dst, i32 len);
+typedef Err (*svc_mem_unit_write_fn)(const void *src, i32 len, void *dst, i32 offset);
+typedef Err (*svc_mem_unit_select_fn)(const void **base);
+
+/*
+  One entry per svc_mem_unit_e. `size` is in bytes. The read and write
+  kernels are indexed by in_words, NULL if unsupported. `select`, if
+  set, runs before access and may replace the base address.
+*/
+typedef struct svc_mem_unit_s svc_mem_unit_t;
+struct svc_mem_unit_s
+{
+  u32                    base;
+  u32                    size;
+  u8                     widths;
+  u8                     flags;
+  svc_mem_unit_select_fn select;
+  svc_mem_unit_read_fn   read[2];
+  svc_mem_unit_write_fn  write[2];
+};
+
+const svc_mem_unit_t *svc_mem_unit_get(u8 unit);
+
+Err svc_mem_unit_check(const svc_mem_unit_t *unit, i32 in_words, i32 offset, i32 len);
+i32 svc_mem_unit_chunkable(u8 unit);
+
+i32 svc_mem_unit_rom_bank_get(void);
+Err svc_mem_unit_rom_bank_set(i32 bank);
+
+Err svc_mem_unit_read(u8 unit, i32 in_words, const void *src, i32 offset, void *dst, i32 len);
+Err svc_mem_unit_read_faults(u8 unit, i32 in_words, i32 offset, void *dst, i32 len,
+                             u32 pattern, u32 *map, i32 map_base, i32 *faults);
+Err svc_mem_unit_write(u8 unit, i32 in_words, const void *src, i32 len, void *dst, i32 offset);
+Err svc_mem_unit_fill(u8 unit, i32 shift, void *dst, i32 offset, i32 len, u32 pattern);
+Err svc_mem_unit_copy(u8 dunit, void *dst, i32 doffset, u8 sunit, const void *src, i32 soffset,
+                      i32 in_words, i32 len);
+i32 svc_mem_unit_copy_backward(u8 dunit, const void *dst, i32 doffset, u8 sunit, const void *src,
+                               i32 soffset, i32 in_words, i32 len);
+Err svc_mem_unit_checksum(u8 unit, i32 in_words, const void *src, i32 offset, i32 len,
+                          u8 algo, u32 *digest);
+Err svc_mem_unit_search(u8 unit, i32 in_words, const void *src, i32 offset, i32 len,
+                        const svc_mem_search_t *desc, i32 *hits, i32 max, i32 *nhits);
+Err svc_mem_unit_diff(u8 unit, i32 in_words, const void *src, i32 offset, i32 len,
+                      const void *ref, svc_mem_diff_t *desc, svc_mem_diff_run_t *runs, i32 max);
+Err svc_mem_unit_delta(u8 unit, void *dst, i32 offset, svc_mem_delta_t *desc, i32 start,
+                       i32 len);
+Err svc_mem_unit_capture(u8 unit, const void *src, i32 offset, i32 width, i32 height,
+                         i32 done, i32 len, u16 *dst, u32 flags);
+Err svc_mem_unit_sport_check(u8 op, i32 offset, u32 arg, i32 pages);
+Err svc_mem_unit_sport(u8 op, i32 offset, u32 arg, i32 pages, i32 cpu);
+Err svc_mem_unit_rmw_check(const svc_mem_rmw_t *ent);
+Err svc_mem_unit_rmw(const svc_mem_rmw_t *ent, u32 *old);
+Err svc_mem_unit_hash(u8 unit, i32 offset, i32 len, u32 *digest);
+Err svc_mem_unit_word(u8 unit, i32 offset, u32 *word);
+Err svc_mem_unit_poll(u8 unit, i32 offset, svc_mem_wait_t *desc);